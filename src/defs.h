@@ -1,5 +1,6 @@
 #pragma once
 
+#include <cstdint>
 #include <iostream>
 #include <map>
 
@@ -17,11 +18,11 @@ static std::istream &operator>>(std::istream &is, T &enum_val) {
 }
 
 struct Rid {
-    int page_no;
+    int64_t page_no;
     int slot_no;
 
     Rid() = default;
-    Rid(int page_no_, int slot_no_) : page_no(page_no_), slot_no(slot_no_) {}
+    Rid(int64_t page_no_, int slot_no_) : page_no(page_no_), slot_no(slot_no_) {}
 
     friend bool operator==(const Rid &x, const Rid &y) { return x.page_no == y.page_no && x.slot_no == y.slot_no; }
     friend bool operator!=(const Rid &x, const Rid &y) { return !(x == y); }
@@ -1,6 +1,7 @@
 #pragma once
 
 #include <cerrno>
+#include <cstdint>
 #include <cstring>
 #include <string>
 
@@ -44,10 +45,39 @@ class FileNotFoundError : public RedBaseError {
     FileNotFoundError(const std::string &filename) : RedBaseError("File not found: " + filename) {}
 };
 
+class InvalidFileFormatError : public RedBaseError {
+  public:
+    InvalidFileFormatError(const std::string &filename) : RedBaseError("Invalid file format: " + filename) {}
+};
+
+class PagePinnedError : public RedBaseError {
+  public:
+    PagePinnedError(int fd, int64_t page_no)
+        : RedBaseError("Page is pinned: (" + std::to_string(fd) + "," + std::to_string(page_no) + ")") {}
+};
+
+class BufferPoolFullError : public RedBaseError {
+  public:
+    BufferPoolFullError() : RedBaseError("All pages in buffer pool are pinned") {}
+};
+
+class ReservedPoolFullError : public RedBaseError {
+  public:
+    ReservedPoolFullError(size_t num_pages, size_t num_free)
+        : RedBaseError("Reserved buffer pool region is too small: " + std::to_string(num_pages) + " pages needed, " +
+                       std::to_string(num_free) + " free") {}
+};
+
+class InvalidPoolSizeError : public RedBaseError {
+  public:
+    InvalidPoolSizeError(size_t num_pages)
+        : RedBaseError("Invalid buffer pool size: " + std::to_string(num_pages) + " pages") {}
+};
+
 // RM errors
 class RecordNotFoundError : public RedBaseError {
   public:
-    RecordNotFoundError(int page_no, int slot_no)
+    RecordNotFoundError(int64_t page_no, int slot_no)
         : RedBaseError("Record not found: (" + std::to_string(page_no) + "," + std::to_string(slot_no) + ")") {}
 };
 
@@ -17,12 +17,16 @@ class Interp {
                    "  DROP TABLE table_name\n"
                    "  CREATE INDEX table_name (column_name)\n"
                    "  DROP INDEX table_name (column_name)\n"
+                   "  ALTER TABLE table_name {CACHE | NOCACHE}\n"
+                   "  {PIN | UNPIN} INDEX table_name (column_name)\n"
                    "  INSERT INTO table_name VALUES (value [, value ...])\n"
                    "  DELETE FROM table_name [WHERE where_clause]\n"
                    "  UPDATE table_name SET column_name = value [, column_name = value ...] [WHERE where_clause]\n"
                    "  SELECT selector FROM table_name [WHERE where_clause]\n"
+                   "  SHOW {STATUS | BUFFERPOOL}\n"
+                   "  RESET STATUS\n"
                    "type:\n"
-                   "  {INT | FLOAT | CHAR(n)}\n"
+                   "  {INT | FLOAT | CHAR(n) | VARCHAR(n)}\n"
                    "where_clause:\n"
                    "  condition [AND condition ...]\n"
                    "condition:\n"
@@ -35,14 +39,21 @@ class Interp {
                    "  {* | column [, column ...]}\n";
         } else if (auto x = std::dynamic_pointer_cast<ast::ShowTables>(root)) {
             SmManager::show_tables();
+        } else if (auto x = std::dynamic_pointer_cast<ast::ShowStatus>(root)) {
+            SmManager::show_status();
+        } else if (auto x = std::dynamic_pointer_cast<ast::ShowBufferPool>(root)) {
+            SmManager::show_bufferpool();
+        } else if (auto x = std::dynamic_pointer_cast<ast::ResetStatus>(root)) {
+            SmManager::reset_status();
         } else if (auto x = std::dynamic_pointer_cast<ast::DescTable>(root)) {
             SmManager::desc_table(x->tab_name);
         } else if (auto x = std::dynamic_pointer_cast<ast::CreateTable>(root)) {
             std::vector<ColDef> col_defs;
             for (auto &field : x->fields) {
                 if (auto sv_col_def = std::dynamic_pointer_cast<ast::ColDef>(field)) {
-                    ColDef col_def(sv_col_def->col_name, interp_sv_type(sv_col_def->type_len->type),
-                                   sv_col_def->type_len->len);
+                    auto &type_len = sv_col_def->type_len;
+                    ColDef col_def(sv_col_def->col_name, interp_sv_type(type_len->type), type_len->len,
+                                   type_len->type == ast::SV_TYPE_VARCHAR);
                     col_defs.push_back(col_def);
                 } else {
                     throw InternalError("Unexpected field type");
@@ -55,6 +66,10 @@ class Interp {
             SmManager::create_index(x->tab_name, x->col_name);
         } else if (auto x = std::dynamic_pointer_cast<ast::DropIndex>(root)) {
             SmManager::drop_index(x->tab_name, x->col_name);
+        } else if (auto x = std::dynamic_pointer_cast<ast::CacheTable>(root)) {
+            SmManager::cache_table(x->tab_name, x->enable);
+        } else if (auto x = std::dynamic_pointer_cast<ast::PinIndex>(root)) {
+            SmManager::pin_index(x->tab_name, x->col_name, x->enable);
         } else if (auto x = std::dynamic_pointer_cast<ast::InsertStmt>(root)) {
             std::vector<Value> values;
             for (auto &sv_val : x->vals) {
@@ -88,7 +103,11 @@ class Interp {
   private:
     static ColType interp_sv_type(ast::SvType sv_type) {
         static std::map<ast::SvType, ColType> m = {
-            {ast::SV_TYPE_INT, TYPE_INT}, {ast::SV_TYPE_FLOAT, TYPE_FLOAT}, {ast::SV_TYPE_STRING, TYPE_STRING}};
+            {ast::SV_TYPE_INT, TYPE_INT},
+            {ast::SV_TYPE_FLOAT, TYPE_FLOAT},
+            {ast::SV_TYPE_STRING, TYPE_STRING},
+            {ast::SV_TYPE_VARCHAR, TYPE_STRING}, // stored packed, see ColMeta::varchar
+        };
         return m.at(sv_type);
     }
 
@@ -0,0 +1,73 @@
+#include "ix/ix.h"
+#include <chrono>
+#include <cinttypes>
+#include <random>
+
+// Cost of random index probes over a B+tree that is cached in a large buffer pool.
+// Each probe descends from the root to a leaf, touching one frame per level at random places of the pool, so with
+// 4 KiB pages nearly every frame access misses the TLB. Besides whole probes, the frame accesses are timed alone.
+// Run it once per backing to compare:
+//   ix_bench off; ix_bench thp; ix_bench hugetlb
+
+static constexpr int NUM_KEYS = 4 * 1000 * 1000;
+static constexpr int NUM_PROBES = 5 * 1000 * 1000;
+static constexpr int POOL_PAGES = 256 * 1024; // 1 GiB, enough to cache the whole index
+
+int main(int argc, char **argv) {
+    PfHugePages huge_pages = HUGE_PAGES_THP;
+    if (argc > 1) {
+        std::string arg = argv[1];
+        for (PfHugePages h : {HUGE_PAGES_OFF, HUGE_PAGES_THP, HUGE_PAGES_HUGETLB}) {
+            if (arg == huge_pages2str(h)) {
+                huge_pages = h;
+            }
+        }
+    }
+    PfManager::pager.set_huge_pages(huge_pages);
+    PfManager::pager.resize(POOL_PAGES);
+    printf("%s\n", PfManager::pager.memory_report().c_str());
+
+    std::string filename = "ix_bench";
+    if (IxManager::exists(filename, 0)) {
+        IxManager::destroy_index(filename, 0);
+    }
+    IxManager::create_index(filename, 0, TYPE_INT, sizeof(int));
+    auto ih = IxManager::open_index(filename, 0);
+    for (int key = 0; key < NUM_KEYS; key++) {
+        ih->insert_entry((const uint8_t *)&key, Rid(key / 100, key % 100));
+    }
+    printf("%d keys in %zu cached pages\n", NUM_KEYS, PfManager::pager.num_file_pages(ih->fd));
+
+    std::mt19937 rng(0);
+    std::vector<int> probes(NUM_PROBES);
+    for (auto &key : probes) {
+        key = rng() % NUM_KEYS;
+    }
+    // Warm up the TLB and caches as far as they go
+    size_t hits = 0;
+    for (int i = 0; i < NUM_PROBES / 10; i++) {
+        hits += ih->get_rid(ih->lower_bound((const uint8_t *)&probes[i])).slot_no == probes[i] % 100;
+    }
+    auto start = std::chrono::steady_clock::now();
+    for (int key : probes) {
+        hits += ih->get_rid(ih->lower_bound((const uint8_t *)&key)).slot_no == key % 100;
+    }
+    auto end = std::chrono::steady_clock::now();
+    double ns = std::chrono::duration<double, std::nano>(end - start).count() / NUM_PROBES;
+    // The frame accesses alone, without searching the nodes: a random word of a random cached page
+    int64_t num_pages = ih->hdr.num_pages;
+    uint64_t sum = 0;
+    start = std::chrono::steady_clock::now();
+    for (int key : probes) {
+        PageGuard page = PfManager::pager.fetch_page(ih->fd, 1 + key % (num_pages - 1));
+        sum += page->buf[key % PAGE_SIZE];
+    }
+    end = std::chrono::steady_clock::now();
+    double fetch_ns = std::chrono::duration<double, std::nano>(end - start).count() / NUM_PROBES;
+    printf("huge pages %-8s probe %7.1f ns  fetch %6.1f ns  hits %zu  sum %" PRIu64 "\n",
+           huge_pages2str(huge_pages).c_str(), ns, fetch_ns, hits, sum);
+
+    IxManager::close_index(ih.get());
+    IxManager::destroy_index(filename, 0);
+    return 0;
+}
@@ -1,6 +1,8 @@
 #include "ix/ix_index_handle.h"
 #include "ix/ix_scan.h"
+#include <algorithm>
 #include <cassert>
+#include <vector>
 
 int ix_compare(const uint8_t *a, const uint8_t *b, ColType type, int col_len) {
     switch (type) {
@@ -21,9 +23,9 @@ int ix_compare(const uint8_t *a, const uint8_t *b, ColType type, int col_len) {
     }
 }
 
-IxNodeHandle::IxNodeHandle(const IxFileHdr *ihdr_, Page *page_) {
+IxNodeHandle::IxNodeHandle(const IxFileHdr *ihdr_, PageGuard page_) {
     ihdr = ihdr_;
-    page = page_;
+    page = std::move(page_);
     hdr = (IxPageHdr *)page->buf;
     keys = page->buf + ihdr->key_offset;
     rids = (Rid *)(page->buf + ihdr->rid_offset);
@@ -154,6 +156,7 @@ void IxIndexHandle::insert_entry(const uint8_t *key, const Rid &rid) {
             node.hdr->parent = root.page->id.page_no;
             // update global root page
             hdr.root_page = root.page->id.page_no;
+            write_hdr();
         }
         // Allocate brother node
         IxNodeHandle bro = create_node();
@@ -199,9 +202,24 @@ void IxIndexHandle::insert_entry(const uint8_t *key, const Rid &rid) {
         // Update global last_leaf if needed
         if (hdr.last_leaf == node.page->id.page_no) {
             hdr.last_leaf = bro.page->id.page_no;
+            write_hdr();
         }
         // Go to its parent
-        node = parent;
+        node = std::move(parent);
+    }
+}
+
+void IxIndexHandle::insert_entries(const uint8_t *keys, size_t stride, const Rid *rids, size_t n) {
+    std::vector<size_t> order(n);
+    for (size_t i = 0; i < n; i++) {
+        order[i] = i;
+    }
+    // Stable, so that equal keys are inserted in the order given, as one at a time
+    std::stable_sort(order.begin(), order.end(), [&](size_t a, size_t b) {
+        return ix_compare(keys + a * stride, keys + b * stride, hdr.col_type, hdr.col_len) < 0;
+    });
+    for (size_t i : order) {
+        insert_entry(keys + i * stride, rids[i]);
     }
 }
 
@@ -228,13 +246,14 @@ void IxIndexHandle::delete_entry(const uint8_t *key, const Rid &rid) {
                 // If current node is root node, underflow is permitted
                 if (!node.hdr->is_leaf && node.hdr->num_key <= 1) {
                     // If root node is not leaf and it is empty, delete the root
-                    int new_root_page = node.get_rid(0)->page_no;
+                    int64_t new_root_page = node.get_rid(0)->page_no;
                     // Load new root and set its parent to NO_PAGE
                     IxNodeHandle new_root = fetch_node(new_root_page);
                     new_root.page->mark_dirty();
                     new_root.hdr->parent = IX_NO_PAGE;
                     // Update global root
                     hdr.root_page = new_root_page;
+                    write_hdr();
                     // Free current page
                     release_node(node);
                 }
@@ -332,7 +351,7 @@ void IxIndexHandle::delete_entry(const uint8_t *key, const Rid &rid) {
                 // Free right brother page
                 release_node(bro);
             }
-            node = parent;
+            node = std::move(parent);
         }
         return;
     }
@@ -393,30 +412,52 @@ Iid IxIndexHandle::leaf_begin() const {
 }
 
 IxNodeHandle IxIndexHandle::create_node() {
-    Page *page;
     IxNodeHandle node;
     if (hdr.first_free == IX_NO_PAGE) {
-        page = PfManager::pager.create_page(fd, hdr.num_pages);
+        hdr.num_alloc_pages = PfManager::allocate_pages(fd, hdr.num_pages + 1, hdr.num_alloc_pages);
+        node = IxNodeHandle(&hdr, PfManager::pager.create_page(fd, hdr.num_pages));
         hdr.num_pages++;
-        node = IxNodeHandle(&hdr, page);
     } else {
-        page = PfManager::pager.fetch_page(fd, hdr.first_free);
-        node = IxNodeHandle(&hdr, page);
+        node = IxNodeHandle(&hdr, PfManager::pager.fetch_page(fd, hdr.first_free));
         hdr.first_free = node.hdr->next_free;
     }
-    page->mark_dirty();
+    node.page->mark_dirty();
+    write_hdr();
     return node;
 }
 
-IxNodeHandle IxIndexHandle::fetch_node(int page_no) const {
+void IxIndexHandle::write_hdr() const {
+    PageGuard page = PfManager::pager.fetch_page(fd, IX_FILE_HDR_PAGE);
+    memcpy(page->buf, &hdr, sizeof(hdr));
+    page->mark_dirty();
+}
+
+IxNodeHandle IxIndexHandle::fetch_node(int64_t page_no) const {
     assert(page_no < hdr.num_pages);
-    Page *page = PfManager::pager.fetch_page(fd, page_no);
-    IxNodeHandle node(&hdr, page);
+    IxNodeHandle node(&hdr, PfManager::pager.fetch_page(fd, page_no));
     return node;
 }
 
+void IxIndexHandle::readahead_leaves(const IxNodeHandle &leaf, const Iid &end) const {
+    assert(leaf.hdr->is_leaf && leaf.hdr->parent != IX_NO_PAGE);
+    IxNodeHandle parent = fetch_node(leaf.hdr->parent);
+    std::vector<int64_t> page_nos;
+    for (int i = parent.find_child(leaf) + 1; i < parent.hdr->num_child; i++) {
+        int64_t page_no = parent.get_rid(i)->page_no;
+        if (page_no == end.page_no) {
+            // The scan stops before the first entry of this leaf, or somewhere in it
+            if (end.slot_no > 0) {
+                page_nos.push_back(page_no);
+            }
+            break;
+        }
+        page_nos.push_back(page_no);
+    }
+    PfManager::pager.prefetch_pages(fd, page_nos);
+}
+
 void IxIndexHandle::maintain_parent(const IxNodeHandle &node) {
-    IxNodeHandle curr = node;
+    IxNodeHandle curr = fetch_node(node.page->id.page_no);
     while (curr.hdr->parent != IX_NO_PAGE) {
         // Load its parent
         IxNodeHandle parent = fetch_node(curr.hdr->parent);
@@ -428,7 +469,7 @@ void IxIndexHandle::maintain_parent(const IxNodeHandle &node) {
         }
         parent.page->mark_dirty();
         memcpy(parent_key, child_max_key, hdr.col_len);
-        curr = parent;
+        curr = std::move(parent);
     }
 }
 
@@ -446,12 +487,13 @@ void IxIndexHandle::erase_leaf(IxNodeHandle &leaf) {
 void IxIndexHandle::release_node(IxNodeHandle &node) {
     node.hdr->next_free = hdr.first_free;
     hdr.first_free = node.page->id.page_no;
+    write_hdr();
 }
 
 void IxIndexHandle::maintain_child(IxNodeHandle &node, int child_idx) {
     if (!node.hdr->is_leaf) {
         // Current node is inner node, load its child and set its parent to current node
-        int child_page_no = node.get_rid(child_idx)->page_no;
+        int64_t child_page_no = node.get_rid(child_idx)->page_no;
         IxNodeHandle child = fetch_node(child_page_no);
         child.page->mark_dirty();
         child.hdr->parent = node.page->id.page_no;
@@ -6,16 +6,17 @@ static const bool binary_search = false;
 
 int ix_compare(const uint8_t *a, const uint8_t *b, ColType type, int col_len);
 
+// A B+tree node pinned in the buffer pool
 struct IxNodeHandle {
     IxPageHdr *hdr;
     uint8_t *keys;
     Rid *rids;
-    Page *page;
+    PageGuard page;
     const IxFileHdr *ihdr;
 
     IxNodeHandle() = default;
 
-    IxNodeHandle(const IxFileHdr *ihdr_, Page *page_);
+    IxNodeHandle(const IxFileHdr *ihdr_, PageGuard page_);
 
     uint8_t *get_key(int key_idx) const { return keys + key_idx * ihdr->col_len; }
 
@@ -47,6 +48,10 @@ class IxIndexHandle {
 
     void insert_entry(const uint8_t *key, const Rid &rid);
 
+    // Insert n entries, the key of rids[i] being at keys + i * stride, such as a column of records stored back to
+    // back. Entries are inserted in key order, so that consecutive inserts reach the same leaf while it is cached.
+    void insert_entries(const uint8_t *keys, size_t stride, const Rid *rids, size_t n);
+
     void delete_entry(const uint8_t *key, const Rid &rid);
 
     Rid get_rid(const Iid &iid) const;
@@ -59,8 +64,16 @@ class IxIndexHandle {
 
     Iid leaf_begin() const;
 
+    // Copy the file header into the header page in the buffer pool, where it is logged and written back
+    // together with the nodes.
+    void write_hdr() const;
+
   private:
-    IxNodeHandle fetch_node(int page_no) const;
+    IxNodeHandle fetch_node(int64_t page_no) const;
+
+    // Start reading the leaves after the given one under the same parent, up to the leaf holding the end of the scan.
+    // Leaves are linked in key order but scattered on disk, so the pager cannot detect them as a sequential run.
+    void readahead_leaves(const IxNodeHandle &leaf, const Iid &end) const;
 
     IxNodeHandle create_node();
 
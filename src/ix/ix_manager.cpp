@@ -28,7 +28,10 @@ void IxManager::create_index(const std::string &filename, int index_no, ColType
     IxFileHdr fhdr(IX_NO_PAGE, IX_INIT_NUM_PAGES, IX_INIT_ROOT_PAGE, col_type, col_len, btree_order, key_offset,
                    rid_offset, IX_INIT_ROOT_PAGE, IX_INIT_ROOT_PAGE);
     static uint8_t page_buf[PAGE_SIZE];
-    PfPager::write_page(fd, IX_FILE_HDR_PAGE, (const uint8_t *)&fhdr, sizeof(fhdr));
+    // Write a full page, since the header page is later cached and updated in the buffer pool
+    memset(page_buf, 0, PAGE_SIZE);
+    memcpy(page_buf, &fhdr, sizeof(fhdr));
+    PfPager::write_page(fd, IX_FILE_HDR_PAGE, page_buf, PAGE_SIZE);
     // Create leaf list header page and write to file
     {
         auto phdr = (IxPageHdr *)page_buf;
@@ -54,10 +57,24 @@ void IxManager::destroy_index(const std::string &filename, int index_no) {
 std::unique_ptr<IxIndexHandle> IxManager::open_index(const std::string &filename, int index_no) {
     std::string ix_name = get_index_name(filename, index_no);
     int fd = PfManager::open_file(ix_name);
-    return std::make_unique<IxIndexHandle>(fd);
+    auto ih = std::make_unique<IxIndexHandle>(fd);
+    if (ih->hdr.magic != IX_FILE_MAGIC || ih->hdr.version != IX_FILE_VERSION) {
+        PfManager::close_file(fd);
+        throw InvalidFileFormatError(ix_name);
+    }
+    return ih;
 }
 
 void IxManager::close_index(const IxIndexHandle *ih) {
-    PfPager::write_page(ih->fd, IX_FILE_HDR_PAGE, (const uint8_t *)&ih->hdr, sizeof(ih->hdr));
+    ih->write_hdr();
     PfManager::close_file(ih->fd);
 }
+
+bool IxManager::is_legacy_index(const std::string &filename, int index_no) {
+    std::string ix_name = get_index_name(filename, index_no);
+    int fd = PfManager::open_file(ix_name);
+    IxFileHdr hdr{};
+    PfPager::read_page(fd, IX_FILE_HDR_PAGE, (uint8_t *)&hdr, sizeof(hdr));
+    PfManager::close_file(fd);
+    return hdr.magic != IX_FILE_MAGIC;
+}
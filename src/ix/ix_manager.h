@@ -20,4 +20,8 @@ class IxManager {
     static std::unique_ptr<IxIndexHandle> open_index(const std::string &filename, int index_no);
 
     static void close_index(const IxIndexHandle *ih);
+
+    // Whether the index is of version 1, which has 32-bit page numbers and no magic number.
+    // Legacy indexes cannot be upgraded in place and have to be rebuilt from their table.
+    static bool is_legacy_index(const std::string &filename, int index_no);
 };
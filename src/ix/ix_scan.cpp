@@ -7,6 +7,11 @@ void IxScan::next() {
     IxNodeHandle node = _ih->fetch_node(_iid.page_no);
     assert(node.hdr->is_leaf);
     assert(_iid.slot_no < node.hdr->num_key);
+    // Nothing is read ahead for a scan ending in this leaf, such as an equality lookup
+    if (node.hdr->parent != IX_NO_PAGE && node.hdr->parent != _readahead_parent && _iid.page_no != _end.page_no) {
+        _ih->readahead_leaves(node, _end);
+        _readahead_parent = node.hdr->parent;
+    }
     // increment slot no
     _iid.slot_no++;
     if (_iid.page_no != _ih->hdr.last_leaf && _iid.slot_no == node.hdr->num_key) {
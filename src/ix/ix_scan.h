@@ -20,4 +20,5 @@ class IxScan : public RecScan {
     const IxIndexHandle *_ih;
     Iid _iid;
     Iid _end;
+    int64_t _readahead_parent = IX_NO_PAGE; // parent whose remaining leaves have been prefetched
 };
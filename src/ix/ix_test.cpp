@@ -1,9 +1,10 @@
 #include "ix/ix.h"
+#include <set>
 #include <gtest/gtest.h>
 
 class IxTest : public ::testing::Test {
   public:
-    void check_tree(const IxIndexHandle *ih, int root_page) {
+    void check_tree(const IxIndexHandle *ih, int64_t root_page) {
         IxNodeHandle node = ih->fetch_node(root_page);
         if (node.hdr->is_leaf) {
             return;
@@ -20,7 +21,7 @@ class IxTest : public ::testing::Test {
 
     void check_leaf(const IxIndexHandle *ih) {
         // check leaf list
-        int leaf_no = ih->hdr.first_leaf;
+        int64_t leaf_no = ih->hdr.first_leaf;
         while (leaf_no != IX_LEAF_HEADER_PAGE) {
             IxNodeHandle curr = ih->fetch_node(leaf_no);
             IxNodeHandle prev = ih->fetch_node(curr.hdr->prev_leaf);
@@ -70,7 +71,7 @@ class IxTest : public ::testing::Test {
         EXPECT_EQ(it, mock.end());
     }
 
-    void print_btree(IxIndexHandle &ih, int root_page, int offset) {
+    void print_btree(IxIndexHandle &ih, int64_t root_page, int offset) {
         IxNodeHandle node = ih.fetch_node(root_page);
         for (int i = node.hdr->num_child - 1; i > -1; i--) {
             // print key
@@ -124,6 +125,36 @@ class IxTest : public ::testing::Test {
         IxManager::destroy_index(filename, index_no);
     }
 
+    void test_ix_insert_entries(int order, int round) {
+        std::string filename = "abc";
+        int index_no = 0;
+        if (IxManager::exists(filename, index_no)) {
+            IxManager::destroy_index(filename, index_no);
+        }
+        IxManager::create_index(filename, index_no, TYPE_INT, sizeof(int));
+        auto ih = IxManager::open_index(filename, index_no);
+        if (order > 2 && order <= ih->hdr.btree_order) {
+            ih->hdr.btree_order = order;
+        }
+        std::multimap<int, Rid> mock;
+        // Keys in records of two ints, inserted in batches into a growing tree
+        for (int batch = 0; batch < 4; batch++) {
+            int num_entries = rand() % round;
+            std::vector<int> records(2 * num_entries);
+            std::vector<Rid> rids;
+            for (int i = 0; i < num_entries; i++) {
+                records[2 * i] = rand() % round;
+                records[2 * i + 1] = rand();
+                rids.emplace_back(rand(), rand());
+                mock.insert(std::make_pair(records[2 * i], rids.back()));
+            }
+            ih->insert_entries((const uint8_t *)records.data(), 2 * sizeof(int), rids.data(), rids.size());
+            check_equal(ih.get(), mock);
+        }
+        IxManager::close_index(ih.get());
+        IxManager::destroy_index(filename, index_no);
+    }
+
     void test_ix(int order, int round) {
         std::string filename = "abc";
         int index_no = 0;
@@ -198,3 +229,57 @@ TEST_F(IxTest, basic) {
     test_ix(4, 1000);
     test_ix(-1, 100000);
 }
+
+TEST_F(IxTest, insert_entries) {
+    srand((unsigned)time(nullptr));
+    test_ix_insert_entries(3, 1000);
+    test_ix_insert_entries(-1, 100000);
+}
+
+TEST_F(IxTest, scan_readahead) {
+    std::string filename = "abc";
+    int index_no = 0;
+    if (IxManager::exists(filename, index_no)) {
+        IxManager::destroy_index(filename, index_no);
+    }
+    IxManager::create_index(filename, index_no, TYPE_INT, sizeof(int));
+    auto ih = IxManager::open_index(filename, index_no);
+    constexpr int num_keys = 20000;
+    std::vector<int> keys(num_keys);
+    std::vector<Rid> rids;
+    for (int i = 0; i < num_keys; i++) {
+        keys[i] = i;
+        rids.emplace_back(i, 0);
+    }
+    ih->insert_entries((const uint8_t *)keys.data(), sizeof(int), rids.data(), rids.size());
+    IxManager::close_index(ih.get());
+    ih = IxManager::open_index(filename, index_no);
+    int fd = ih->fd;
+
+    // The leaves are consecutive on disk, so keep the pager from reading them ahead as a sequential run
+    PfManager::pager.set_readahead(0);
+    // An equality lookup reads no leaf ahead
+    int key = num_keys / 2;
+    PfManager::pager.reset_stats();
+    size_t num_found = 0;
+    for (IxScan scan(ih.get(), ih->lower_bound((const uint8_t *)&key), ih->upper_bound((const uint8_t *)&key));
+         !scan.is_end(); scan.next()) {
+        EXPECT_EQ(scan.rid(), Rid(key, 0));
+        num_found++;
+    }
+    EXPECT_EQ(num_found, 1u);
+    EXPECT_EQ(PfManager::pager.file_stats(fd).prefetches, 0u);
+    // A range scan reads ahead the leaves up to its end only
+    int lower = 0;
+    int upper = ih->hdr.btree_order * 3;
+    std::set<int64_t> leaves;
+    for (IxScan scan(ih.get(), ih->lower_bound((const uint8_t *)&lower), ih->upper_bound((const uint8_t *)&upper));
+         !scan.is_end(); scan.next()) {
+        leaves.insert(scan.iid().page_no);
+    }
+    EXPECT_GT(PfManager::pager.file_stats(fd).prefetches, 0u);
+    EXPECT_LE(PfManager::pager.file_stats(fd).prefetches, leaves.size());
+    PfManager::pager.set_readahead(PF_READAHEAD_MAX_PAGES);
+    IxManager::close_index(ih.get());
+    IxManager::destroy_index(filename, index_no);
+}
@@ -0,0 +1,332 @@
+#pragma once
+
+#include "pf/pf.h"
+#include <cstdlib>
+#include <iostream>
+#include <string>
+#include <unistd.h>
+
+// Startup options shared by the redbase shell and rawcli.
+// Every option can be given either as a command line flag or as an environment variable; flags take precedence.
+struct Options {
+    std::string db_name;
+    PfPolicy policy = POLICY_LRU;                     // --policy=lru|2q, REDBASE_POLICY
+    size_t pool_size = NUM_CACHE_PAGES;               // --pool-size=SIZE, REDBASE_POOL_SIZE (in pages)
+    size_t reserved_size = PF_RESERVED_PAGES;         // --reserved-size=SIZE, REDBASE_RESERVED_SIZE (in pages)
+    PfIoEngineKind io_engine = IO_ENGINE_URING;       // --io-engine=uring|threads, REDBASE_IO_ENGINE
+    PfDurability durability = DURABILITY_SYNC;        // --durability=sync|async|off, REDBASE_DURABILITY
+    int sync_interval_ms = PF_WAL_SYNC_INTERVAL_MS;   // --sync-interval=MS, REDBASE_SYNC_INTERVAL
+    int64_t checkpoint_size = PF_CHECKPOINT_LOG_SIZE; // --checkpoint-size=SIZE, REDBASE_CHECKPOINT_SIZE (in bytes)
+    bool direct_io = false;                           // --direct-io=on|off, REDBASE_DIRECT_IO
+    PfHugePages huge_pages = HUGE_PAGES_THP;          // --huge-pages=off|thp|hugetlb, REDBASE_HUGE_PAGES
+    PfBackend backend = BACKEND_POOL;                 // --backend=pool|mmap, REDBASE_BACKEND
+    int64_t extent_size = PF_EXTENT_PAGES;            // --extent-size=SIZE, REDBASE_EXTENT_SIZE (in pages)
+    std::string trace_path;                           // --trace=PATH, REDBASE_TRACE
+
+    static void print_usage(const char *prog) {
+        std::cerr << "Usage: " << prog << " [options] <database>\n"
+                  << "Options:\n"
+                  << "  --policy=lru|2q    buffer pool replacement policy (env REDBASE_POLICY, default lru)\n"
+                  << "  --pool-size=SIZE   buffer pool size in bytes, with optional K/M/G suffix, or N% of\n"
+                  << "                     physical memory (env REDBASE_POOL_SIZE, default 256M)\n"
+                  << "  --reserved-size=SIZE\n"
+                  << "                     budget of the pool region holding cached tables and pinned\n"
+                  << "                     indexes (env REDBASE_RESERVED_SIZE, default 32M)\n"
+                  << "  --io-engine=uring|threads\n"
+                  << "                     backend of asynchronous page reads, uring falls back to threads\n"
+                  << "                     if unsupported (env REDBASE_IO_ENGINE, default uring)\n"
+                  << "  --durability=sync|async|off\n"
+                  << "                     sync waits for the log on every statement, async syncs the log\n"
+                  << "                     periodically, off disables the log (env REDBASE_DURABILITY,\n"
+                  << "                     default sync)\n"
+                  << "  --sync-interval=MS log sync period in async mode (env REDBASE_SYNC_INTERVAL,\n"
+                  << "                     default 100)\n"
+                  << "  --checkpoint-size=SIZE\n"
+                  << "                     log size since the last checkpoint that starts a background\n"
+                  << "                     checkpoint, 0 disables them (env REDBASE_CHECKPOINT_SIZE, default 64M)\n"
+                  << "  --direct-io=on|off bypass the kernel page cache, so that pages are cached only in\n"
+                  << "                     the buffer pool (env REDBASE_DIRECT_IO, default off)\n"
+                  << "  --huge-pages=off|thp|hugetlb\n"
+                  << "                     back the buffer pool with transparent or reserved huge pages,\n"
+                  << "                     falling back to normal pages (env REDBASE_HUGE_PAGES, default thp)\n"
+                  << "  --backend=pool|mmap\n"
+                  << "                     read pages of the database into the buffer pool, or use them in\n"
+                  << "                     place from mappings of its files (env REDBASE_BACKEND, default pool)\n"
+                  << "  --extent-size=SIZE preallocate table and index files in extents of SIZE as they grow,\n"
+                  << "                     0 disables it (env REDBASE_EXTENT_SIZE, default 1M)\n"
+                  << "  --trace=PATH       record every page access of the buffer pool to PATH, for replay by\n"
+                  << "                     pfsim (env REDBASE_TRACE, default none)\n";
+    }
+
+    // Parse the command line. Return false if the arguments are invalid.
+    bool parse(int argc, char **argv) {
+        if (const char *env = getenv("REDBASE_POLICY")) {
+            if (!parse_policy(env)) {
+                return false;
+            }
+        }
+        if (const char *env = getenv("REDBASE_POOL_SIZE")) {
+            if (!parse_pool_size(env)) {
+                return false;
+            }
+        }
+        if (const char *env = getenv("REDBASE_RESERVED_SIZE")) {
+            if (!parse_reserved_size(env)) {
+                return false;
+            }
+        }
+        if (const char *env = getenv("REDBASE_IO_ENGINE")) {
+            if (!parse_io_engine(env)) {
+                return false;
+            }
+        }
+        if (const char *env = getenv("REDBASE_DURABILITY")) {
+            if (!parse_durability(env)) {
+                return false;
+            }
+        }
+        if (const char *env = getenv("REDBASE_SYNC_INTERVAL")) {
+            if (!parse_sync_interval(env)) {
+                return false;
+            }
+        }
+        if (const char *env = getenv("REDBASE_CHECKPOINT_SIZE")) {
+            if (!parse_checkpoint_size(env)) {
+                return false;
+            }
+        }
+        if (const char *env = getenv("REDBASE_DIRECT_IO")) {
+            if (!parse_direct_io(env)) {
+                return false;
+            }
+        }
+        if (const char *env = getenv("REDBASE_HUGE_PAGES")) {
+            if (!parse_huge_pages(env)) {
+                return false;
+            }
+        }
+        if (const char *env = getenv("REDBASE_BACKEND")) {
+            if (!parse_backend(env)) {
+                return false;
+            }
+        }
+        if (const char *env = getenv("REDBASE_EXTENT_SIZE")) {
+            if (!parse_extent_size(env)) {
+                return false;
+            }
+        }
+        if (const char *env = getenv("REDBASE_TRACE")) {
+            trace_path = env;
+        }
+        for (int i = 1; i < argc; i++) {
+            std::string arg = argv[i];
+            if (arg.compare(0, 9, "--policy=") == 0) {
+                if (!parse_policy(arg.substr(9))) {
+                    return false;
+                }
+            } else if (arg.compare(0, 12, "--pool-size=") == 0) {
+                if (!parse_pool_size(arg.substr(12))) {
+                    return false;
+                }
+            } else if (arg.compare(0, 16, "--reserved-size=") == 0) {
+                if (!parse_reserved_size(arg.substr(16))) {
+                    return false;
+                }
+            } else if (arg.compare(0, 12, "--io-engine=") == 0) {
+                if (!parse_io_engine(arg.substr(12))) {
+                    return false;
+                }
+            } else if (arg.compare(0, 13, "--durability=") == 0) {
+                if (!parse_durability(arg.substr(13))) {
+                    return false;
+                }
+            } else if (arg.compare(0, 16, "--sync-interval=") == 0) {
+                if (!parse_sync_interval(arg.substr(16))) {
+                    return false;
+                }
+            } else if (arg.compare(0, 18, "--checkpoint-size=") == 0) {
+                if (!parse_checkpoint_size(arg.substr(18))) {
+                    return false;
+                }
+            } else if (arg.compare(0, 12, "--direct-io=") == 0) {
+                if (!parse_direct_io(arg.substr(12))) {
+                    return false;
+                }
+            } else if (arg.compare(0, 13, "--huge-pages=") == 0) {
+                if (!parse_huge_pages(arg.substr(13))) {
+                    return false;
+                }
+            } else if (arg.compare(0, 10, "--backend=") == 0) {
+                if (!parse_backend(arg.substr(10))) {
+                    return false;
+                }
+            } else if (arg.compare(0, 14, "--extent-size=") == 0) {
+                if (!parse_extent_size(arg.substr(14))) {
+                    return false;
+                }
+            } else if (arg.compare(0, 8, "--trace=") == 0) {
+                trace_path = arg.substr(8);
+            } else if (arg.compare(0, 2, "--") == 0 || !db_name.empty()) {
+                return false;
+            } else {
+                db_name = arg;
+            }
+        }
+        return !db_name.empty();
+    }
+
+    // Configure the storage engine. Must be called before opening the database.
+    void apply() const {
+        PfManager::pager.set_huge_pages(huge_pages);
+        PfManager::pager.resize(pool_size);
+        PfManager::pager.set_reserved_capacity(reserved_size);
+        PfManager::pager.set_policy(policy);
+        PfManager::pager.set_io_engine(io_engine);
+        PfManager::wal.set_durability(durability, sync_interval_ms);
+        PfManager::pager.set_checkpoint_interval(checkpoint_size);
+        PfManager::set_direct_io(direct_io);
+        PfManager::set_backend(backend);
+        PfManager::set_extent_pages(extent_size);
+        if (!trace_path.empty()) {
+            PfManager::start_trace(trace_path);
+        }
+    }
+
+    // Parse a size in bytes with an optional K/M/G suffix
+    static bool parse_bytes(const std::string &str, unsigned long long &bytes) {
+        char *end;
+        bytes = strtoull(str.c_str(), &end, 10);
+        if (end == str.c_str()) {
+            return false;
+        }
+        std::string unit = end;
+        if (unit == "K" || unit == "k") {
+            bytes <<= 10;
+        } else if (unit == "M" || unit == "m") {
+            bytes <<= 20;
+        } else if (unit == "G" || unit == "g") {
+            bytes <<= 30;
+        } else if (!unit.empty()) {
+            return false;
+        }
+        return true;
+    }
+
+  private:
+    bool parse_pool_size(const std::string &str) {
+        unsigned long long bytes;
+        if (!str.empty() && str.back() == '%') {
+            // A share of physical memory. With direct I/O, most of it can go to the pool.
+            char *end;
+            double percent = strtod(str.c_str(), &end);
+            long phys_pages = sysconf(_SC_PHYS_PAGES);
+            long os_page_size = sysconf(_SC_PAGESIZE);
+            if (end != &str.back() || percent <= 0 || percent > 100 || phys_pages <= 0 || os_page_size <= 0) {
+                return false;
+            }
+            bytes = (unsigned long long)((double)phys_pages * os_page_size * percent / 100);
+        } else if (!parse_bytes(str, bytes)) {
+            return false;
+        }
+        pool_size = bytes / PAGE_SIZE;
+        return pool_size >= PF_MIN_CACHE_PAGES;
+    }
+
+    bool parse_reserved_size(const std::string &str) {
+        unsigned long long bytes;
+        if (!parse_bytes(str, bytes)) {
+            return false;
+        }
+        reserved_size = bytes / PAGE_SIZE;
+        return true;
+    }
+
+    bool parse_extent_size(const std::string &str) {
+        unsigned long long bytes;
+        if (!parse_bytes(str, bytes)) {
+            return false;
+        }
+        extent_size = bytes / PAGE_SIZE;
+        return true;
+    }
+
+    bool parse_huge_pages(const std::string &str) {
+        for (PfHugePages h : {HUGE_PAGES_OFF, HUGE_PAGES_THP, HUGE_PAGES_HUGETLB}) {
+            if (str == huge_pages2str(h)) {
+                huge_pages = h;
+                return true;
+            }
+        }
+        return false;
+    }
+
+    bool parse_backend(const std::string &str) {
+        for (PfBackend b : {BACKEND_POOL, BACKEND_MMAP}) {
+            if (str == backend2str(b)) {
+                backend = b;
+                return true;
+            }
+        }
+        return false;
+    }
+
+    bool parse_direct_io(const std::string &str) {
+        if (str == "on") {
+            direct_io = true;
+        } else if (str == "off") {
+            direct_io = false;
+        } else {
+            return false;
+        }
+        return true;
+    }
+
+    bool parse_checkpoint_size(const std::string &str) {
+        unsigned long long bytes;
+        if (!parse_bytes(str, bytes)) {
+            return false;
+        }
+        checkpoint_size = (int64_t)bytes;
+        return true;
+    }
+
+    bool parse_policy(const std::string &str) {
+        for (PfPolicy p : {POLICY_LRU, POLICY_2Q}) {
+            if (str == policy2str(p)) {
+                policy = p;
+                return true;
+            }
+        }
+        return false;
+    }
+
+    bool parse_durability(const std::string &str) {
+        for (PfDurability d : {DURABILITY_SYNC, DURABILITY_ASYNC, DURABILITY_OFF}) {
+            if (str == durability2str(d)) {
+                durability = d;
+                return true;
+            }
+        }
+        return false;
+    }
+
+    bool parse_sync_interval(const std::string &str) {
+        char *end;
+        long ms = strtol(str.c_str(), &end, 10);
+        if (end == str.c_str() || *end != '\0' || ms <= 0) {
+            return false;
+        }
+        sync_interval_ms = (int)ms;
+        return true;
+    }
+
+    bool parse_io_engine(const std::string &str) {
+        for (PfIoEngineKind kind : {IO_ENGINE_URING, IO_ENGINE_THREADS}) {
+            if (str == io_engine2str(kind)) {
+                io_engine = kind;
+                return true;
+            }
+        }
+        return false;
+    }
+};
@@ -6,7 +6,7 @@
 
 namespace ast {
 
-enum SvType { SV_TYPE_INT, SV_TYPE_FLOAT, SV_TYPE_STRING };
+enum SvType { SV_TYPE_INT, SV_TYPE_FLOAT, SV_TYPE_STRING, SV_TYPE_VARCHAR };
 
 enum SvCompOp { SV_OP_EQ, SV_OP_NE, SV_OP_LT, SV_OP_GT, SV_OP_LE, SV_OP_GE };
 
@@ -19,6 +19,12 @@ struct Help : public TreeNode {};
 
 struct ShowTables : public TreeNode {};
 
+struct ShowStatus : public TreeNode {};
+
+struct ShowBufferPool : public TreeNode {};
+
+struct ResetStatus : public TreeNode {};
+
 struct TypeLen : public TreeNode {
     SvType type;
     int len;
@@ -72,6 +78,22 @@ struct DropIndex : public TreeNode {
         : tab_name(std::move(tab_name_)), col_name(std::move(col_name_)) {}
 };
 
+struct CacheTable : public TreeNode {
+    std::string tab_name;
+    bool enable;
+
+    CacheTable(std::string tab_name_, bool enable_) : tab_name(std::move(tab_name_)), enable(enable_) {}
+};
+
+struct PinIndex : public TreeNode {
+    std::string tab_name;
+    std::string col_name;
+    bool enable;
+
+    PinIndex(std::string tab_name_, std::string col_name_, bool enable_)
+        : tab_name(std::move(tab_name_)), col_name(std::move(col_name_)), enable(enable_) {}
+};
+
 struct Expr : public TreeNode {};
 
 struct Value : public Expr {};
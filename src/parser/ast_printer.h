@@ -33,6 +33,7 @@ class TreePrinter {
             {SV_TYPE_INT, "INT"},
             {SV_TYPE_FLOAT, "FLOAT"},
             {SV_TYPE_STRING, "STRING"},
+            {SV_TYPE_VARCHAR, "VARCHAR"},
         };
         return m.at(type);
     }
@@ -61,6 +62,12 @@ class TreePrinter {
             std::cout << "HELP\n";
         } else if (auto x = std::dynamic_pointer_cast<ShowTables>(node)) {
             std::cout << "SHOW_TABLES\n";
+        } else if (auto x = std::dynamic_pointer_cast<ShowStatus>(node)) {
+            std::cout << "SHOW_STATUS\n";
+        } else if (auto x = std::dynamic_pointer_cast<ShowBufferPool>(node)) {
+            std::cout << "SHOW_BUFFERPOOL\n";
+        } else if (auto x = std::dynamic_pointer_cast<ResetStatus>(node)) {
+            std::cout << "RESET_STATUS\n";
         } else if (auto x = std::dynamic_pointer_cast<CreateTable>(node)) {
             std::cout << "CREATE_TABLE\n";
             print_val(x->tab_name, offset);
@@ -79,6 +86,13 @@ class TreePrinter {
             std::cout << "DROP_INDEX\n";
             print_val(x->tab_name, offset);
             print_val(x->col_name, offset);
+        } else if (auto x = std::dynamic_pointer_cast<CacheTable>(node)) {
+            std::cout << (x->enable ? "CACHE_TABLE\n" : "NOCACHE_TABLE\n");
+            print_val(x->tab_name, offset);
+        } else if (auto x = std::dynamic_pointer_cast<PinIndex>(node)) {
+            std::cout << (x->enable ? "PIN_INDEX\n" : "UNPIN_INDEX\n");
+            print_val(x->tab_name, offset);
+            print_val(x->col_name, offset);
         } else if (auto x = std::dynamic_pointer_cast<ColDef>(node)) {
             std::cout << "COL_DEF\n";
             print_val(x->col_name, offset);
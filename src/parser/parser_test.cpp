@@ -4,11 +4,19 @@
 TEST(parser, basic) {
     std::vector<std::string> sqls = {
         "show tables;",
+        "show status;",
+        "show bufferpool;",
+        "reset status;",
         "desc tb;",
         "create table tb (a int, b float, c char(4));",
+        "create table tb (a int, b varchar(255), c char(4));",
         "drop table tb;",
         "create index tb(a);",
         "drop index tb(b);",
+        "alter table tb cache;",
+        "alter table tb nocache;",
+        "pin index tb(a);",
+        "unpin index tb(a);",
         "insert into tb values (1, 3.14, 'pi');",
         "delete from tb where a = 1;",
         "update tb set a = 1, b = 2.2, c = 'xyz' where x = 2 and y < 1.1 and z > 'abc';",
@@ -21,8 +21,8 @@ using namespace ast;
 %define parse.error verbose
 
 // keywords
-%token SHOW TABLES CREATE TABLE DROP DESC INSERT INTO VALUES DELETE FROM
-WHERE UPDATE SET SELECT INT CHAR FLOAT INDEX AND EXIT HELP
+%token SHOW TABLES STATUS BUFFERPOOL RESET CREATE TABLE DROP DESC INSERT INTO VALUES DELETE FROM
+WHERE UPDATE SET SELECT INT CHAR VARCHAR FLOAT INDEX AND EXIT HELP ALTER CACHE NOCACHE PIN UNPIN
 // non-keywords
 %token LEQ NEQ GEQ T_EOF
 
@@ -84,6 +84,18 @@ dbStmt:
     {
         $$ = std::make_shared<ShowTables>();
     }
+    |   SHOW STATUS
+    {
+        $$ = std::make_shared<ShowStatus>();
+    }
+    |   SHOW BUFFERPOOL
+    {
+        $$ = std::make_shared<ShowBufferPool>();
+    }
+    |   RESET STATUS
+    {
+        $$ = std::make_shared<ResetStatus>();
+    }
     ;
 
 ddl:
@@ -107,6 +119,22 @@ ddl:
     {
         $$ = std::make_shared<DropIndex>($3, $5);
     }
+    |   ALTER TABLE tbName CACHE
+    {
+        $$ = std::make_shared<CacheTable>($3, true);
+    }
+    |   ALTER TABLE tbName NOCACHE
+    {
+        $$ = std::make_shared<CacheTable>($3, false);
+    }
+    |   PIN INDEX tbName '(' colName ')'
+    {
+        $$ = std::make_shared<PinIndex>($3, $5, true);
+    }
+    |   UNPIN INDEX tbName '(' colName ')'
+    {
+        $$ = std::make_shared<PinIndex>($3, $5, false);
+    }
     ;
 
 dml:
@@ -155,6 +183,10 @@ type:
     {
         $$ = std::make_shared<TypeLen>(SV_TYPE_STRING, $3);
     }
+    |   VARCHAR '(' VALUE_INT ')'
+    {
+        $$ = std::make_shared<TypeLen>(SV_TYPE_VARCHAR, $3);
+    }
     |   FLOAT
     {
         $$ = std::make_shared<TypeLen>(SV_TYPE_FLOAT, sizeof(float));
@@ -1,5 +1,11 @@
 #pragma once
 
 #include "pf/pf_defs.h"
+#include "pf/pf_flusher.h"
+#include "pf/pf_io.h"
 #include "pf/pf_manager.h"
+#include "pf/pf_page_table.h"
 #include "pf/pf_pager.h"
+#include "pf/pf_replacer.h"
+#include "pf/pf_trace.h"
+#include "pf/pf_wal.h"
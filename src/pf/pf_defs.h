@@ -3,16 +3,112 @@
 #include "defs.h"
 #include <cinttypes>
 #include <cstdlib>
+#include <list>
+#include <memory>
+#include <new>
 
 static constexpr int PAGE_SIZE = 4096;
-static constexpr int NUM_CACHE_PAGES = 65536;
+static constexpr int PF_IO_ALIGN = 4096;           // alignment of buffers, offsets and sizes of direct I/O
+static constexpr int NUM_CACHE_PAGES = 65536;      // default buffer pool size (256 MiB)
+static constexpr int PF_MIN_CACHE_PAGES = 16;      // enough for the pages pinned by a B+tree split
+static constexpr int PF_RESERVED_PAGES = 8192;     // default budget of the reserved region of the pool (32 MiB)
+static constexpr int PF_CHUNK_PAGES = 512;         // frames are allocated on demand in chunks of 2 MiB
+static constexpr int PF_HUGE_PAGE_SIZE = 2 << 20;  // a chunk fits one huge page exactly
+static constexpr int PF_IO_QUEUE_DEPTH = 256;      // max reads submitted to io_uring at once
+static constexpr int PF_IO_THREADS = 8;            // worker threads of the fallback async I/O engine
+static constexpr int PF_READAHEAD_MIN_PAGES = 8;   // initial readahead window of a sequential reader
+static constexpr int PF_READAHEAD_MAX_PAGES = 128; // readahead window stops growing at 512 KiB
+static constexpr int PF_CLEAN_TAIL_RATIO = 8;      // the flusher keeps 1/8 of the pool next to be evicted clean
+static constexpr int PF_FLUSH_MAX_PAGES = 1024;    // max pages being written by the flusher at a time (4 MiB)
+static constexpr int PF_VICTIM_SEARCH_PAGES = 32;  // eviction looks this far for a clean page
+static constexpr int PF_WARMUP_BATCH_PAGES = 256;  // warm-up reads saved pages in sorted batches of 1 MiB
+static constexpr int PF_EXTENT_PAGES = 256;        // files grow in preallocated extents of 1 MiB
+static constexpr int PF_WAL_BUFFER_SIZE = 1 << 20;  // log records are buffered in memory up to 1 MiB
+static constexpr int PF_WAL_SYNC_INTERVAL_MS = 100; // default period of log syncs in async durability mode
+static constexpr int PF_WAL_SEGMENT_SIZE = 16 << 20;    // the log is split into files of 16 MiB
+static constexpr int PF_CHECKPOINT_LOG_SIZE = 64 << 20; // checkpoint after 64 MiB of log since the redo point
+static constexpr int PF_CHECKPOINT_MIN_PAGES = 16;      // min pages written per commit by a running checkpoint
+static constexpr int64_t PF_MAP_SEGMENT_SIZE = 1 << 30; // mapped files are mapped in pieces of 1 GiB
+static constexpr int PF_TRACE_BUFFER_SIZE = 1 << 20;    // traced page accesses are buffered in memory up to 1 MiB
+
+// Page replacement policy of the buffer pool
+enum PfPolicy { POLICY_LRU, POLICY_2Q };
+
+static inline std::string policy2str(PfPolicy policy) {
+    static std::map<PfPolicy, std::string> m = {{POLICY_LRU, "lru"}, {POLICY_2Q, "2q"}};
+    return m.at(policy);
+}
+
+// Backing of the frame memory. With thp, frames are mapped at huge page boundaries and the kernel is advised to
+// back them with transparent huge pages. With hugetlb, frames take reserved huge pages from the kernel pool, and
+// fall back to thp when the pool is exhausted. Huge pages cut the TLB misses of random accesses to a large pool.
+enum PfHugePages { HUGE_PAGES_OFF, HUGE_PAGES_THP, HUGE_PAGES_HUGETLB };
+
+static inline std::string huge_pages2str(PfHugePages huge_pages) {
+    static std::map<PfHugePages, std::string> m = {
+        {HUGE_PAGES_OFF, "off"}, {HUGE_PAGES_THP, "thp"}, {HUGE_PAGES_HUGETLB, "hugetlb"}};
+    return m.at(huge_pages);
+}
+
+// Where the pages of a file live while in use. With pool, pages are read into frames of the buffer pool. With mmap,
+// the file is mapped and pages are used in place in the kernel page cache, without copying, while changed pages
+// are still logged and written back by the pager.
+enum PfBackend { BACKEND_POOL, BACKEND_MMAP };
+
+static inline std::string backend2str(PfBackend backend) {
+    static std::map<PfBackend, std::string> m = {{BACKEND_POOL, "pool"}, {BACKEND_MMAP, "mmap"}};
+    return m.at(backend);
+}
+
+// Backend of asynchronous page reads
+enum PfIoEngineKind { IO_ENGINE_THREADS, IO_ENGINE_URING };
+
+static inline std::string io_engine2str(PfIoEngineKind kind) {
+    static std::map<PfIoEngineKind, std::string> m = {{IO_ENGINE_THREADS, "threads"}, {IO_ENGINE_URING, "uring"}};
+    return m.at(kind);
+}
+
+// When a statement becomes durable. With sync, a statement returns after its changes reach the log on disk.
+// With async, the log is synced in the background periodically. With off, nothing is logged, and changes
+// survive a crash only after the database is closed.
+enum PfDurability { DURABILITY_SYNC, DURABILITY_ASYNC, DURABILITY_OFF };
+
+static inline std::string durability2str(PfDurability durability) {
+    static std::map<PfDurability, std::string> m = {
+        {DURABILITY_SYNC, "sync"}, {DURABILITY_ASYNC, "async"}, {DURABILITY_OFF, "off"}};
+    return m.at(durability);
+}
+
+// A heap buffer aligned for direct I/O
+struct PfAlignedDeleter {
+    void operator()(uint8_t *buf) const { free(buf); }
+};
+using PfAlignedBuf = std::unique_ptr<uint8_t[], PfAlignedDeleter>;
+
+static inline PfAlignedBuf alloc_aligned(size_t size) {
+    void *buf;
+    if (posix_memalign(&buf, PF_IO_ALIGN, size) != 0) {
+        throw std::bad_alloc();
+    }
+    return PfAlignedBuf((uint8_t *)buf);
+}
+
+// Counters of buffer pool activity, kept for the whole pool and for each open file
+struct PfStats {
+    uint64_t hits = 0;        // fetches of pages found in memory, including mapped pages and pages read ahead
+    uint64_t misses = 0;      // fetches that had to read the page from the file
+    uint64_t prefetches = 0;  // pages read ahead asynchronously
+    uint64_t evictions = 0;   // pages evicted to make room for others
+    uint64_t write_backs = 0; // dirty pages written to the file
+    uint64_t flush_waits = 0; // evictions that waited for a background write of the victim
+};
 
 struct PageId {
     int fd;
-    int page_no;
+    int64_t page_no;
 
     PageId() = default;
-    PageId(int fd_, int page_no_) : fd(fd_), page_no(page_no_) {}
+    PageId(int fd_, int64_t page_no_) : fd(fd_), page_no(page_no_) {}
 
     friend bool operator==(const PageId &x, const PageId &y) { return x.fd == y.fd && x.page_no == y.page_no; }
     friend bool operator!=(const PageId &x, const PageId &y) { return !(x == y); }
@@ -25,7 +121,18 @@ struct PageId {
 namespace std {
 template <>
 struct hash<PageId> {
-    size_t operator()(const PageId &pid) const noexcept { return (pid.fd << 16) | pid.page_no; }
+    // Pack (fd, page_no) into 64 bits and mix it with the MurmurHash3 finalizer. Both steps are bijective for
+    // fd < 2^16 and page_no < 2^48, so distinct page ids never share a hash value in practice, and the high bits
+    // depend on every input bit.
+    size_t operator()(const PageId &pid) const noexcept {
+        uint64_t h = ((uint64_t)(uint32_t)pid.fd << 48) ^ (uint64_t)pid.page_no;
+        h ^= h >> 33;
+        h *= 0xff51afd7ed558ccdULL;
+        h ^= h >> 33;
+        h *= 0xc4ceb9fe1a85ec53ULL;
+        h ^= h >> 33;
+        return h;
+    }
 };
 } // namespace std
 
@@ -33,6 +140,25 @@ struct Page {
     PageId id;
     uint8_t *buf;
     bool is_dirty;
+    int pin_count;   // number of guards referencing this page, a pinned page is never evicted
+    bool io_pending; // an asynchronous read into this page has not completed yet, which holds one pin
+    bool is_modified; // changed since its image was last written to the log
+    bool log_queued;  // the frame is queued to be logged at the next commit
+    int64_t lsn;      // end of the last log record of this page, the log must be durable up to here before
+                      // the page is written back
+    int64_t rec_lsn;  // LSN before the first record of this page since it was last written back, -1 if none.
+                      // Recovery must replay the log from here to restore the page.
+    bool is_mapped;   // buf points into a mapping of the file rather than a frame of the pool
+    bool reserved;    // held in the reserved region of the pool, out of the replacer and never evicted
 
-    void mark_dirty() { is_dirty = true; }
+    // Position of this page in the replacer queues
+    std::list<Page *>::iterator pos;
+    int queue;
+    // Position of this page in the resident list of its file
+    std::list<Page *>::iterator file_pos;
+
+    void mark_dirty() {
+        is_dirty = true;
+        is_modified = true;
+    }
 };
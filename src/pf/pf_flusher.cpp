@@ -0,0 +1,143 @@
+#include "pf/pf_flusher.h"
+#include "pf/pf_pager.h"
+#include <algorithm>
+#include <cassert>
+#include <cerrno>
+#include <cstring>
+
+PfFlusher::~PfFlusher() {
+    if (_worker.joinable()) {
+        submit();
+        {
+            std::lock_guard<std::mutex> lock(_mutex);
+            _stop = true;
+        }
+        _submit_cv.notify_one();
+        _worker.join();
+    }
+}
+
+void PfFlusher::write_async(Page *page) {
+    assert(_pending.count(page->id) == 0);
+    Job job;
+    job.id = page->id;
+    job.page = page;
+    job.rec_lsn = page->rec_lsn;
+    job.error = 0;
+    if (!_spare.empty()) {
+        job.buf = std::move(_spare.back());
+        _spare.pop_back();
+    } else {
+        job.buf = alloc_aligned(PAGE_SIZE);
+    }
+    memcpy(job.buf.get(), page->buf, PAGE_SIZE);
+    _queued.emplace_back(std::move(job));
+    _pending.insert(page->id);
+}
+
+void PfFlusher::submit() {
+    if (_queued.empty()) {
+        return;
+    }
+    if (!_worker.joinable()) {
+        _worker = std::thread(&PfFlusher::worker, this);
+    }
+    {
+        std::lock_guard<std::mutex> lock(_mutex);
+        for (auto &job : _queued) {
+            _submitted.emplace_back(std::move(job));
+        }
+    }
+    _queued.clear();
+    _submit_cv.notify_one();
+}
+
+void PfFlusher::wait(const PageId &page_id) {
+    submit();
+    while (_pending.count(page_id) > 0) {
+        reap(true);
+    }
+}
+
+void PfFlusher::wait() {
+    submit();
+    while (!_pending.empty()) {
+        reap(true);
+    }
+}
+
+void PfFlusher::reap(bool wait) {
+    std::vector<Job> done;
+    {
+        std::unique_lock<std::mutex> lock(_mutex);
+        if (wait) {
+            _complete_cv.wait(lock, [this] { return !_completed.empty(); });
+        }
+        done.swap(_completed);
+    }
+    int error = 0;
+    for (auto &job : done) {
+        _pending.erase(job.id);
+        _spare.emplace_back(std::move(job.buf));
+        if (job.error != 0) {
+            // The change is only in the frame, which a later write-back must write again. Recovery must still
+            // replay the log from where the change began.
+            Page *page = job.page;
+            page->is_dirty = true;
+            if (job.rec_lsn >= 0 && (page->rec_lsn < 0 || job.rec_lsn < page->rec_lsn)) {
+                page->rec_lsn = job.rec_lsn;
+            }
+            error = error != 0 ? error : job.error;
+        }
+    }
+    if (error != 0) {
+        errno = error;
+        throw UnixError();
+    }
+}
+
+void PfFlusher::worker() {
+    std::unique_lock<std::mutex> lock(_mutex);
+    while (true) {
+        _submit_cv.wait(lock, [this] { return _stop || !_submitted.empty(); });
+        if (_submitted.empty()) {
+            return;
+        }
+        std::vector<Job> jobs;
+        jobs.swap(_submitted);
+        lock.unlock();
+        // Write the batch in disk order, coalescing consecutive pages
+        std::sort(jobs.begin(), jobs.end(), [](const Job &a, const Job &b) {
+            return a.id.fd < b.id.fd || (a.id.fd == b.id.fd && a.id.page_no < b.id.page_no);
+        });
+        std::vector<const uint8_t *> bufs;
+        size_t begin = 0;
+        while (begin < jobs.size()) {
+            size_t end = begin + 1;
+            while (end < jobs.size() && jobs[end].id.fd == jobs[begin].id.fd &&
+                   jobs[end].id.page_no == jobs[end - 1].id.page_no + 1) {
+                end++;
+            }
+            bufs.clear();
+            for (size_t i = begin; i < end; i++) {
+                bufs.push_back(jobs[i].buf.get());
+            }
+            try {
+                PfPager::write_pages(jobs[begin].id.fd, jobs[begin].id.page_no, bufs.data(), (int)bufs.size());
+            } catch (UnixError &) {
+                for (size_t i = begin; i < end; i++) {
+                    jobs[i].error = errno;
+                }
+            }
+            // Report each write once it finishes, so that a page is not held back by the rest of the batch
+            lock.lock();
+            for (size_t i = begin; i < end; i++) {
+                _completed.emplace_back(std::move(jobs[i]));
+            }
+            lock.unlock();
+            _complete_cv.notify_one();
+            begin = end;
+        }
+        lock.lock();
+    }
+}
@@ -0,0 +1,72 @@
+#pragma once
+
+#include "error.h"
+#include "pf/pf_defs.h"
+#include <condition_variable>
+#include <memory>
+#include <mutex>
+#include <thread>
+#include <unordered_set>
+#include <vector>
+
+// Background writer of dirty pages. The pager copies a dirty page into a staging buffer of the flusher and marks
+// the frame clean, so the frame can be evicted at once while the copy is written to disk by the flusher thread.
+// A page is not evicted before its pending write completes, so if the write fails, the frame is still cached and is
+// marked dirty again. All methods are called from the thread driving the pager.
+class PfFlusher {
+  public:
+    PfFlusher() = default;
+    ~PfFlusher();
+
+    PfFlusher(const PfFlusher &other) = delete;
+    PfFlusher &operator=(const PfFlusher &other) = delete;
+
+    // Queue a copy of the page for writing. The page must not have a pending write already.
+    void write_async(Page *page);
+
+    // Hand the queued pages to the flusher thread.
+    void submit();
+
+    // Whether a write of the page is queued or in progress, or has finished since the last poll.
+    bool is_pending(const PageId &page_id) const { return _pending.count(page_id) > 0; }
+
+    // Collect the finished writes without blocking.
+    void poll() { reap(false); }
+
+    // Number of pages queued or being written
+    size_t num_pending() const { return _pending.size(); }
+
+    // Block until the pending write of the page completes.
+    void wait(const PageId &page_id);
+    // Block until all pending writes complete.
+    void wait();
+
+  private:
+    // A page copy waiting to be written
+    struct Job {
+        PageId id;
+        Page *page;
+        int64_t rec_lsn;  // of the page when it was queued
+        PfAlignedBuf buf; // aligned, since the file may be open for direct I/O
+        int error;        // errno of the write, 0 if it succeeded
+    };
+
+    void worker();
+
+    // Collect finished writes. If wait is true, block until at least one write completes.
+    // Throws UnixError if a background write failed, after marking the pages it failed to write dirty again.
+    void reap(bool wait);
+
+  private:
+    std::thread _worker;
+    std::vector<Job> _queued;                       // not submitted yet
+    std::unordered_set<PageId> _pending;            // pages queued or being written
+    std::vector<PfAlignedBuf> _spare;               // recycled staging buffers
+
+    std::mutex _mutex;
+    std::condition_variable _submit_cv;
+    std::condition_variable _complete_cv;
+    std::vector<Job> _submitted;
+    std::vector<Job> _completed;
+    bool _stop = false;
+};
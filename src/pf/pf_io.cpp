@@ -0,0 +1,158 @@
+#include "pf/pf_io.h"
+#include <cerrno>
+#include <unistd.h>
+
+std::unique_ptr<PfIoEngine> PfIoEngine::create(PfIoEngineKind kind) {
+#ifdef REDBASE_HAVE_LIBURING
+    if (kind == IO_ENGINE_URING) {
+        try {
+            return std::make_unique<UringIoEngine>();
+        } catch (UnixError &) {
+            // io_uring may be disabled by the kernel or a seccomp policy
+        }
+    }
+#endif
+    return std::make_unique<ThreadPoolIoEngine>();
+}
+
+ThreadPoolIoEngine::~ThreadPoolIoEngine() {
+    {
+        std::lock_guard<std::mutex> lock(_mutex);
+        _stop = true;
+    }
+    _submit_cv.notify_all();
+    for (auto &worker : _workers) {
+        worker.join();
+    }
+}
+
+void ThreadPoolIoEngine::read_async(Page *page) {
+    _queued.push_back(page);
+    _num_inflight++;
+}
+
+void ThreadPoolIoEngine::submit() {
+    if (_queued.empty()) {
+        return;
+    }
+    if (_workers.empty()) {
+        for (int i = 0; i < _num_threads; i++) {
+            _workers.emplace_back(&ThreadPoolIoEngine::worker, this);
+        }
+    }
+    {
+        std::lock_guard<std::mutex> lock(_mutex);
+        _submitted.insert(_submitted.end(), _queued.begin(), _queued.end());
+    }
+    _queued.clear();
+    _submit_cv.notify_all();
+}
+
+void ThreadPoolIoEngine::reap(std::vector<PfIoCompletion> &done, bool wait) {
+    if (wait) {
+        submit();
+    }
+    std::unique_lock<std::mutex> lock(_mutex);
+    if (wait && _num_inflight > 0) {
+        _complete_cv.wait(lock, [this] { return !_completed.empty(); });
+    }
+    _num_inflight -= _completed.size();
+    done.insert(done.end(), _completed.begin(), _completed.end());
+    _completed.clear();
+}
+
+void ThreadPoolIoEngine::worker() {
+    std::unique_lock<std::mutex> lock(_mutex);
+    while (true) {
+        _submit_cv.wait(lock, [this] { return _stop || !_submitted.empty(); });
+        if (_stop) {
+            return;
+        }
+        Page *page = _submitted.front();
+        _submitted.pop_front();
+        lock.unlock();
+        ssize_t bytes_read = pread(page->id.fd, page->buf, PAGE_SIZE, (off_t)page->id.page_no * PAGE_SIZE);
+        lock.lock();
+        _completed.push_back({page, bytes_read == PAGE_SIZE});
+        _complete_cv.notify_one();
+    }
+}
+
+#ifdef REDBASE_HAVE_LIBURING
+UringIoEngine::UringIoEngine() {
+    int ret = io_uring_queue_init(PF_IO_QUEUE_DEPTH, &_ring, 0);
+    if (ret < 0) {
+        errno = -ret;
+        throw UnixError();
+    }
+}
+
+UringIoEngine::~UringIoEngine() {
+    // Never leave the kernel writing into buffers that may be unmapped
+    std::vector<PfIoCompletion> done;
+    while (_num_inflight > 0) {
+        reap(done, true);
+    }
+    io_uring_queue_exit(&_ring);
+}
+
+void UringIoEngine::read_async(Page *page) {
+    if (_num_inflight >= PF_IO_QUEUE_DEPTH) {
+        // Do not overflow the completion queue. Wait for an earlier read and keep its result for the next reap.
+        submit();
+        io_uring_cqe *cqe;
+        int ret;
+        while ((ret = io_uring_wait_cqe(&_ring, &cqe)) == -EINTR) {
+        }
+        if (ret < 0) {
+            errno = -ret;
+            throw UnixError();
+        }
+        consume(cqe, _stashed);
+    }
+    io_uring_sqe *sqe = io_uring_get_sqe(&_ring);
+    if (sqe == nullptr) {
+        submit();
+        sqe = io_uring_get_sqe(&_ring);
+    }
+    io_uring_prep_read(sqe, page->id.fd, page->buf, PAGE_SIZE, (off_t)page->id.page_no * PAGE_SIZE);
+    io_uring_sqe_set_data(sqe, page);
+    _num_inflight++;
+}
+
+void UringIoEngine::submit() {
+    int ret = io_uring_submit(&_ring);
+    if (ret < 0) {
+        errno = -ret;
+        throw UnixError();
+    }
+}
+
+void UringIoEngine::reap(std::vector<PfIoCompletion> &done, bool wait) {
+    bool found = !_stashed.empty();
+    done.insert(done.end(), _stashed.begin(), _stashed.end());
+    _stashed.clear();
+    io_uring_cqe *cqe;
+    if (wait && !found && _num_inflight > 0) {
+        submit();
+        int ret;
+        while ((ret = io_uring_wait_cqe(&_ring, &cqe)) == -EINTR) {
+        }
+        if (ret < 0) {
+            errno = -ret;
+            throw UnixError();
+        }
+        consume(cqe, done);
+    }
+    while (io_uring_peek_cqe(&_ring, &cqe) == 0) {
+        consume(cqe, done);
+    }
+}
+
+void UringIoEngine::consume(io_uring_cqe *cqe, std::vector<PfIoCompletion> &done) {
+    Page *page = (Page *)io_uring_cqe_get_data(cqe);
+    done.push_back({page, cqe->res == PAGE_SIZE});
+    io_uring_cqe_seen(&_ring, cqe);
+    _num_inflight--;
+}
+#endif
@@ -0,0 +1,95 @@
+#pragma once
+
+#include "error.h"
+#include "pf/pf_defs.h"
+#include <condition_variable>
+#include <deque>
+#include <memory>
+#include <mutex>
+#include <thread>
+#include <vector>
+
+#ifdef REDBASE_HAVE_LIBURING
+#include <liburing.h>
+#endif
+
+// Result of an asynchronous page read
+struct PfIoCompletion {
+    Page *page;
+    bool ok; // false if the read failed or reached the end of file
+};
+
+// An engine reads pages asynchronously. Reads are queued by read_async(), handed to the backend in one batch by
+// submit(), and collected by reap() once they complete. An engine is driven by a single thread.
+class PfIoEngine {
+  public:
+    virtual ~PfIoEngine() = default;
+
+    virtual PfIoEngineKind kind() const = 0;
+
+    // Queue a read of the disk page page->id into page->buf. The page must stay alive until the read is reaped.
+    virtual void read_async(Page *page) = 0;
+
+    // Start all queued reads.
+    virtual void submit() = 0;
+
+    // Append completed reads to done. If wait is true, block until at least one read completes.
+    virtual void reap(std::vector<PfIoCompletion> &done, bool wait) = 0;
+
+    // Number of reads queued or submitted but not reaped yet
+    size_t num_inflight() const { return _num_inflight; }
+
+    // Create an engine of the given kind. Falls back to the thread pool if io_uring is unavailable.
+    static std::unique_ptr<PfIoEngine> create(PfIoEngineKind kind);
+
+  protected:
+    size_t _num_inflight = 0;
+};
+
+// Portable engine issuing blocking preads from a pool of worker threads. Workers are started on first use.
+class ThreadPoolIoEngine : public PfIoEngine {
+  public:
+    explicit ThreadPoolIoEngine(int num_threads = PF_IO_THREADS) : _num_threads(num_threads) {}
+    ~ThreadPoolIoEngine() override;
+
+    PfIoEngineKind kind() const override { return IO_ENGINE_THREADS; }
+    void read_async(Page *page) override;
+    void submit() override;
+    void reap(std::vector<PfIoCompletion> &done, bool wait) override;
+
+  private:
+    void worker();
+
+  private:
+    int _num_threads;
+    std::vector<std::thread> _workers;
+    std::vector<Page *> _queued; // not submitted yet, owned by the driving thread
+
+    std::mutex _mutex;
+    std::condition_variable _submit_cv;
+    std::condition_variable _complete_cv;
+    std::deque<Page *> _submitted;
+    std::vector<PfIoCompletion> _completed;
+    bool _stop = false;
+};
+
+#ifdef REDBASE_HAVE_LIBURING
+// Linux io_uring engine. A whole batch of reads is submitted with a single syscall.
+class UringIoEngine : public PfIoEngine {
+  public:
+    UringIoEngine();
+    ~UringIoEngine() override;
+
+    PfIoEngineKind kind() const override { return IO_ENGINE_URING; }
+    void read_async(Page *page) override;
+    void submit() override;
+    void reap(std::vector<PfIoCompletion> &done, bool wait) override;
+
+  private:
+    void consume(io_uring_cqe *cqe, std::vector<PfIoCompletion> &done);
+
+  private:
+    io_uring _ring;
+    std::vector<PfIoCompletion> _stashed; // reaped early to make room in the completion queue
+};
+#endif
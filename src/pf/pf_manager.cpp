@@ -1,7 +1,14 @@
 #include "pf/pf_manager.h"
+#include <fstream>
 
 std::unordered_map<std::string, int> PfManager::_path2fd;
 std::unordered_map<int, std::string> PfManager::_fd2path;
+bool PfManager::_direct_io = false;
+std::unordered_set<int> PfManager::_direct_fds;
+PfBackend PfManager::_backend = BACKEND_POOL;
+int64_t PfManager::_extent_pages = PF_EXTENT_PAGES;
+PfWal PfManager::wal;
+PfTrace PfManager::trace;
 PfPager PfManager::pager;
 
 bool PfManager::is_file(const std::string &path) {
@@ -36,6 +43,40 @@ void PfManager::destroy_file(const std::string &path) {
     }
 }
 
+void PfManager::rename_file(const std::string &from, const std::string &to) {
+    if (!is_file(from)) {
+        throw FileNotFoundError(from);
+    }
+    if (_path2fd.count(from)) {
+        throw FileNotClosedError(from);
+    }
+    if (_path2fd.count(to)) {
+        throw FileNotClosedError(to);
+    }
+    // The content must be on disk before the new name is, or a crash may leave a torn file under it
+    int fd = open(from.c_str(), O_RDONLY);
+    if (fd < 0) {
+        throw UnixError();
+    }
+    int ret = fsync(fd);
+    close(fd);
+    if (ret != 0 || rename(from.c_str(), to.c_str()) != 0) {
+        throw UnixError();
+    }
+    // Make the rename itself durable
+    size_t pos = to.rfind('/');
+    std::string dir = pos == std::string::npos ? "." : pos == 0 ? "/" : to.substr(0, pos);
+    int dir_fd = open(dir.c_str(), O_RDONLY | O_DIRECTORY);
+    if (dir_fd < 0) {
+        throw UnixError();
+    }
+    ret = fsync(dir_fd);
+    close(dir_fd);
+    if (ret != 0) {
+        throw UnixError();
+    }
+}
+
 int PfManager::open_file(const std::string &path) {
     if (!is_file(path)) {
         throw FileNotFoundError(path);
@@ -45,13 +86,28 @@ int PfManager::open_file(const std::string &path) {
         throw FileNotClosedError(path);
     }
     // Open file and return the file descriptor
-    int fd = open(path.c_str(), O_RDWR);
+    bool mapped = _backend == BACKEND_MMAP;
+    int fd = _direct_io && !mapped ? open_direct(path) : -1;
+    bool direct = fd >= 0;
+    if (!direct) {
+        fd = open(path.c_str(), O_RDWR);
+    }
     if (fd < 0) {
         throw UnixError();
     }
     // Memorize the opened unix file descriptor
     _path2fd[path] = fd;
     _fd2path[fd] = path;
+    if (direct) {
+        _direct_fds.insert(fd);
+    }
+    if (mapped) {
+        pager.map_file(fd);
+    }
+    wal.add_file(fd, path);
+    if (trace.is_open()) {
+        trace.add_file(fd, path);
+    }
     return fd;
 }
 
@@ -61,10 +117,105 @@ void PfManager::close_file(int fd) {
         throw FileNotOpenError(fd);
     }
     pager.flush_file(fd);
+    wal.remove_file(fd);
+    if (trace.is_open()) {
+        trace.remove_file(fd);
+    }
     const std::string &filename = pos->second;
     _path2fd.erase(filename);
     _fd2path.erase(pos);
+    _direct_fds.erase(fd);
     if (close(fd) != 0) {
         throw UnixError();
     }
 }
+
+int64_t PfManager::allocate_pages(int fd, int64_t num_pages, int64_t num_alloc_pages) {
+    if (num_pages <= num_alloc_pages) {
+        return num_alloc_pages;
+    }
+    if (_extent_pages <= 1) {
+        return num_pages;
+    }
+    // Extents are aligned, and files written before preallocation was tracked start at their current end
+    int64_t begin = std::max(num_alloc_pages, num_pages - 1);
+    int64_t end = (num_pages + _extent_pages - 1) / _extent_pages * _extent_pages;
+    // The size of the file is kept, so that it still ends after the last page in use, and reads past that page
+    // (e.g. by readahead) fail instead of returning preallocated zeros
+    if (fallocate(fd, FALLOC_FL_KEEP_SIZE, (off_t)begin * PAGE_SIZE, (off_t)(end - begin) * PAGE_SIZE) != 0) {
+        if (errno == EOPNOTSUPP || errno == ENOSYS) {
+            // The filesystem cannot preallocate, so the file grows as pages are written back
+            return num_pages;
+        }
+        throw UnixError();
+    }
+    return end;
+}
+
+void PfManager::dump_pool(const std::string &path) {
+    std::ofstream ofs(path);
+    for (const PageId &page_id : pager.hot_pages()) {
+        auto it = _fd2path.find(page_id.fd);
+        if (it != _fd2path.end()) {
+            ofs << it->second << ' ' << page_id.page_no << '\n';
+        }
+    }
+    if (!ofs) {
+        throw UnixError();
+    }
+}
+
+size_t PfManager::load_pool(const std::string &path) {
+    std::ifstream ifs(path);
+    std::vector<PageId> page_ids;
+    std::string file_path;
+    int64_t page_no;
+    // A missing or truncated dump only makes the warm-up shorter
+    while (ifs >> file_path >> page_no) {
+        auto it = _path2fd.find(file_path);
+        if (it != _path2fd.end()) {
+            page_ids.emplace_back(it->second, page_no);
+        }
+    }
+    pager.warm_up(page_ids);
+    return page_ids.size();
+}
+
+void PfManager::start_trace(const std::string &path) {
+    trace.open(path);
+    for (auto &entry : _fd2path) {
+        trace.add_file(entry.first, entry.second);
+    }
+    pager.set_trace(&trace);
+}
+
+void PfManager::stop_trace() {
+    pager.set_trace(nullptr);
+    trace.close();
+}
+
+int PfManager::open_direct(const std::string &path) {
+#ifdef O_DIRECT
+    int fd = open(path.c_str(), O_RDWR | O_DIRECT);
+    if (fd < 0) {
+        if (errno == EINVAL) {
+            return -1;
+        }
+        throw UnixError();
+    }
+    // Some filesystems accept the flag but fail every transfer, so probe with an aligned read of the first page
+    PfAlignedBuf buf = alloc_aligned(PAGE_SIZE);
+    if (pread(fd, buf.get(), PAGE_SIZE, 0) < 0) {
+        int err = errno;
+        close(fd);
+        if (err == EINVAL) {
+            return -1;
+        }
+        errno = err;
+        throw UnixError();
+    }
+    return fd;
+#else
+    return -1;
+#endif
+}
@@ -7,9 +7,12 @@
 #include <sys/stat.h>
 #include <unistd.h>
 #include <unordered_map>
+#include <unordered_set>
 
 class PfManager {
   public:
+    static PfWal wal;
+    static PfTrace trace;
     static PfPager pager;
 
     static bool is_file(const std::string &path);
@@ -18,11 +21,55 @@ class PfManager {
 
     static void destroy_file(const std::string &path);
 
+    // Replace the file at to by the one at from, durably: after a crash, to is either the old file or the whole
+    // new one. Neither file may be open.
+    static void rename_file(const std::string &from, const std::string &to);
+
     static int open_file(const std::string &path);
 
     static void close_file(int fd);
 
+    // Open files for direct I/O, bypassing the kernel page cache so that pages are cached once, in the pool.
+    // Takes effect on files opened afterwards. A file on a filesystem refusing direct I/O is opened buffered.
+    static void set_direct_io(bool enable) { _direct_io = enable; }
+    static bool direct_io() { return _direct_io; }
+
+    // Whether the open file actually uses direct I/O
+    static bool is_direct(int fd) { return _direct_fds.count(fd) > 0; }
+
+    // Serve the pages of files opened afterwards from the buffer pool or from mappings of the files. Mapped files
+    // never use direct I/O.
+    static void set_backend(PfBackend backend) { _backend = backend; }
+    static PfBackend backend() { return _backend; }
+
+    // Grow files in extents of the given number of pages. Zero or one grows them a page at a time.
+    static void set_extent_pages(int64_t num_pages) { _extent_pages = num_pages; }
+    static int64_t extent_pages() { return _extent_pages; }
+
+    // The file is about to grow to num_pages, of which num_alloc_pages are allocated on disk already. If it grows
+    // beyond them, allocate the extent holding the new last page and those before it, so that later write-backs land
+    // in contiguous preallocated space. The size of the file is left as it is. Return the new number of allocated
+    // pages, to be kept in the file header.
+    static int64_t allocate_pages(int fd, int64_t num_pages, int64_t num_alloc_pages);
+
+    // Save the pages cached in the pool to a file, hottest first, naming the files by path.
+    static void dump_pool(const std::string &path);
+    // Start warming up the pool with the saved pages of the open files. Return the number of pages to read.
+    static size_t load_pool(const std::string &path);
+
+    // Trace the page accesses of the pager to a file, naming the files by path. See PfTrace.
+    static void start_trace(const std::string &path);
+    static void stop_trace();
+
+  private:
+    // Open the file for direct I/O. Return -1 if the filesystem does not support it.
+    static int open_direct(const std::string &path);
+
   private:
     static std::unordered_map<std::string, int> _path2fd;
     static std::unordered_map<int, std::string> _fd2path;
+    static bool _direct_io;
+    static std::unordered_set<int> _direct_fds;
+    static PfBackend _backend;
+    static int64_t _extent_pages;
 };
@@ -0,0 +1,80 @@
+#include "pf/pf_page_table.h"
+#include <cassert>
+
+void PfPageTable::insert(Page *page) {
+    assert(find(page->id) == nullptr);
+    if ((_size + 1) * 2 > _slots.size()) {
+        rehash(_slots.size() * 2);
+    }
+    place(page->id, page);
+}
+
+bool PfPageTable::erase(const PageId &page_id) {
+    size_t i = home(page_id);
+    while (true) {
+        if (_slots[i].page == nullptr) {
+            return false;
+        }
+        if (_slots[i].key == page_id) {
+            break;
+        }
+        i = (i + 1) & _mask;
+    }
+    // Backward shift: move each following entry of the cluster into the hole, unless its home slot lies
+    // cyclically in (hole, entry], in which case moving it would make it unreachable.
+    size_t j = i;
+    while (true) {
+        j = (j + 1) & _mask;
+        if (_slots[j].page == nullptr) {
+            break;
+        }
+        size_t k = home(_slots[j].key);
+        bool stays = (i <= j) ? (i < k && k <= j) : (i < k || k <= j);
+        if (!stays) {
+            _slots[i] = _slots[j];
+            i = j;
+        }
+    }
+    _slots[i].page = nullptr;
+    _size--;
+    return true;
+}
+
+std::vector<Page *> PfPageTable::pages() const {
+    std::vector<Page *> pages;
+    pages.reserve(_size);
+    for (auto &slot : _slots) {
+        if (slot.page != nullptr) {
+            pages.push_back(slot.page);
+        }
+    }
+    return pages;
+}
+
+void PfPageTable::clear() {
+    _slots.assign(MIN_SLOTS, Slot{PageId(), nullptr});
+    _mask = MIN_SLOTS - 1;
+    _size = 0;
+}
+
+void PfPageTable::place(const PageId &page_id, Page *page) {
+    size_t i = home(page_id);
+    while (_slots[i].page != nullptr) {
+        i = (i + 1) & _mask;
+    }
+    _slots[i].key = page_id;
+    _slots[i].page = page;
+    _size++;
+}
+
+void PfPageTable::rehash(size_t num_slots) {
+    std::vector<Slot> old_slots(num_slots, Slot{PageId(), nullptr});
+    old_slots.swap(_slots);
+    _mask = num_slots - 1;
+    _size = 0;
+    for (auto &slot : old_slots) {
+        if (slot.page != nullptr) {
+            place(slot.key, slot.page);
+        }
+    }
+}
@@ -0,0 +1,60 @@
+#pragma once
+
+#include "pf/pf_defs.h"
+#include <vector>
+
+// Maps the page ids of resident pages to their frames.
+// It is a flat open addressing hash table with linear probing. Deletion shifts the following entries backward
+// instead of leaving tombstones, so probe sequences stay short under heavy eviction. Entries are stored inline
+// and no memory is allocated per entry.
+class PfPageTable {
+  public:
+    PfPageTable() { clear(); }
+
+    size_t size() const { return _size; }
+
+    size_t num_slots() const { return _slots.size(); }
+
+    Page *find(const PageId &page_id) const {
+        for (size_t i = home(page_id);; i = (i + 1) & _mask) {
+            const Slot &slot = _slots[i];
+            if (slot.page == nullptr) {
+                return nullptr;
+            }
+            if (slot.key == page_id) {
+                return slot.page;
+            }
+        }
+    }
+
+    // Insert a page keyed by its id. The id must not be in the table.
+    void insert(Page *page);
+
+    // Erase a page id. Return false if it is not in the table.
+    bool erase(const PageId &page_id);
+
+    // Get all pages in the table
+    std::vector<Page *> pages() const;
+
+    void clear();
+
+  private:
+    struct Slot {
+        PageId key;
+        Page *page;
+    };
+
+    // Load factor is kept under 1/2
+    static constexpr size_t MIN_SLOTS = 64;
+
+    size_t home(const PageId &page_id) const { return std::hash<PageId>()(page_id) & _mask; }
+
+    // Put an entry into the first empty slot of its probe sequence
+    void place(const PageId &page_id, Page *page);
+
+    void rehash(size_t num_slots);
+
+    std::vector<Slot> _slots;
+    size_t _mask;
+    size_t _size;
+};
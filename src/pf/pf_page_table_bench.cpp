@@ -0,0 +1,118 @@
+#include "pf/pf.h"
+#include <chrono>
+#include <random>
+#include <unordered_map>
+
+// Page lookup cost of the buffer pool page table for tables of several GB.
+// A pool of 1M frames (4 GiB) caches random pages of 16 files of 8 GiB each. We compare the flat page table against
+// the former std::unordered_map keyed by (fd << 16) | page_no, under which page ids of different files collide
+// once a file grows beyond 65536 pages.
+
+struct LegacyPageIdHash {
+    size_t operator()(const PageId &pid) const noexcept { return (pid.fd << 16) | pid.page_no; }
+};
+
+static constexpr int NUM_FILES = 16;
+static constexpr int NUM_FILE_PAGES = 2 * 1024 * 1024; // 8 GiB per file
+static constexpr int NUM_RESIDENT = 1024 * 1024;       // 4 GiB pool
+static constexpr int NUM_LOOKUPS = 10 * 1000 * 1000;
+
+template <typename F>
+static double time_ns_per_op(F &&f, int num_ops) {
+    auto start = std::chrono::steady_clock::now();
+    f();
+    auto end = std::chrono::steady_clock::now();
+    return std::chrono::duration<double, std::nano>(end - start).count() / num_ops;
+}
+
+template <typename Map>
+static void bench_map(const char *name, const std::vector<Page *> &resident, const std::vector<PageId> &probes) {
+    Map map;
+    map.reserve(resident.size());
+    double insert_ns = time_ns_per_op(
+        [&] {
+            for (Page *page : resident) {
+                map.emplace(page->id, page);
+            }
+        },
+        resident.size());
+    size_t hits = 0;
+    double lookup_ns = time_ns_per_op(
+        [&] {
+            for (auto &pid : probes) {
+                auto it = map.find(pid);
+                hits += it != map.end() && it->second->id == pid;
+            }
+        },
+        probes.size());
+    size_t max_bucket = 0;
+    for (size_t i = 0; i < map.bucket_count(); i++) {
+        max_bucket = std::max(max_bucket, map.bucket_size(i));
+    }
+    printf("%-28s insert %7.1f ns  lookup %7.1f ns  hits %zu  max chain %zu\n", name, insert_ns, lookup_ns, hits,
+           max_bucket);
+}
+
+static void bench_page_table(const std::vector<Page *> &resident, const std::vector<PageId> &probes) {
+    PfPageTable table;
+    double insert_ns = time_ns_per_op(
+        [&] {
+            for (Page *page : resident) {
+                table.insert(page);
+            }
+        },
+        resident.size());
+    size_t hits = 0;
+    double lookup_ns = time_ns_per_op(
+        [&] {
+            for (auto &pid : probes) {
+                Page *page = table.find(pid);
+                hits += page != nullptr && page->id == pid;
+            }
+        },
+        probes.size());
+    double erase_ns = time_ns_per_op(
+        [&] {
+            for (Page *page : resident) {
+                table.erase(page->id);
+            }
+        },
+        resident.size());
+    printf("%-28s insert %7.1f ns  lookup %7.1f ns  hits %zu  erase %.1f ns\n", "PfPageTable", insert_ns, lookup_ns,
+           hits, erase_ns);
+}
+
+int main() {
+    std::mt19937 rng(0);
+    std::uniform_int_distribution<int> fd_dist(0, NUM_FILES - 1);
+    std::uniform_int_distribution<int> page_dist(0, NUM_FILE_PAGES - 1);
+
+    std::vector<Page> frames(NUM_RESIDENT);
+    std::vector<Page *> resident;
+    std::unordered_map<PageId, bool> seen;
+    for (auto &frame : frames) {
+        PageId pid;
+        do {
+            pid = PageId(fd_dist(rng), page_dist(rng));
+        } while (!seen.emplace(pid, true).second);
+        frame.id = pid;
+        resident.push_back(&frame);
+    }
+    // Half of the lookups hit the pool
+    std::vector<PageId> probes;
+    probes.reserve(NUM_LOOKUPS);
+    for (int i = 0; i < NUM_LOOKUPS; i++) {
+        if (i % 2 == 0) {
+            probes.push_back(resident[rng() % resident.size()]->id);
+        } else {
+            probes.emplace_back(fd_dist(rng), page_dist(rng));
+        }
+    }
+
+    printf("%d resident pages of %d files x %d MiB, %d lookups\n", NUM_RESIDENT, NUM_FILES,
+           NUM_FILE_PAGES / 1024 * PAGE_SIZE / 1024, NUM_LOOKUPS);
+    bench_map<std::unordered_map<PageId, Page *, LegacyPageIdHash>>("unordered_map (legacy hash)", resident, probes);
+    bench_map<std::unordered_map<PageId, Page *>>("unordered_map (new hash)", resident, probes);
+    bench_page_table(resident, probes);
+    return 0;
+}
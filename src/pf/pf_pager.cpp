@@ -1,114 +1,1136 @@
 #include "pf/pf_pager.h"
+#include <algorithm>
 #include <cassert>
+#include <cinttypes>
+#include <climits>
+#include <cstring>
+#include <fcntl.h>
+#include <fstream>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <sys/uio.h>
 #include <unistd.h>
 
-PfPager::PfPager() {
-    for (size_t i = 0; i < NUM_CACHE_PAGES; i++) {
-        _pages[i].buf = _cache + i * PAGE_SIZE;
-        _pages[i].is_dirty = false;
-        _free_pages.push_back(&_pages[i]);
+void PageGuard::release() {
+    if (_page != nullptr) {
+        _pager->unpin_page(_page);
+        _page = nullptr;
     }
 }
 
+PfPager::PfPager(size_t capacity, PfPolicy policy)
+    : _capacity(capacity), _policy(policy), _replacer(PfReplacer::create(policy, capacity)),
+      _io(PfIoEngine::create(IO_ENGINE_URING)) {}
+
 PfPager::~PfPager() {
+    wait_io();
     flush_all();
-    assert(_free_pages.size() == NUM_CACHE_PAGES);
+    assert(_free_pages.size() == _num_frames);
+    for (auto &chunk : _chunks) {
+        munmap(chunk.buf, chunk.num_pages * PAGE_SIZE);
+    }
+    for (auto &entry : _mapped_files) {
+        for (uint8_t *segment : entry.second.segments) {
+            if (segment != nullptr) {
+                munmap(segment, PF_MAP_SEGMENT_SIZE);
+            }
+        }
+    }
 }
 
-void PfPager::read_page(int fd, int page_no, uint8_t *buf, int num_bytes) {
-    lseek(fd, page_no * PAGE_SIZE, SEEK_SET);
-    ssize_t bytes_read = read(fd, buf, num_bytes);
+// Whether a transfer of the buffer must be staged through an aligned one, since the file is open for direct I/O
+static bool needs_bounce(int fd, const uint8_t *buf, int num_bytes) {
+    if ((uintptr_t)buf % PF_IO_ALIGN == 0 && num_bytes % PF_IO_ALIGN == 0) {
+        return false;
+    }
+#ifdef O_DIRECT
+    int flags = fcntl(fd, F_GETFL);
+    return flags >= 0 && (flags & O_DIRECT) != 0;
+#else
+    return false;
+#endif
+}
+
+void PfPager::read_page(int fd, int64_t page_no, uint8_t *buf, int num_bytes) {
+    if (needs_bounce(fd, buf, num_bytes)) {
+        // Read the whole pages covering the range
+        int size = (num_bytes + PF_IO_ALIGN - 1) / PF_IO_ALIGN * PF_IO_ALIGN;
+        PfAlignedBuf bounce = alloc_aligned(size);
+        if (pread(fd, bounce.get(), size, (off_t)page_no * PAGE_SIZE) < num_bytes) {
+            throw UnixError();
+        }
+        memcpy(buf, bounce.get(), num_bytes);
+        return;
+    }
+    ssize_t bytes_read = pread(fd, buf, num_bytes, (off_t)page_no * PAGE_SIZE);
     if (bytes_read != num_bytes) {
         throw UnixError();
     }
 }
 
-void PfPager::write_page(int fd, int page_no, const uint8_t *buf, int num_bytes) {
-    lseek(fd, page_no * PAGE_SIZE, SEEK_SET);
-    ssize_t bytes_write = write(fd, buf, num_bytes);
+void PfPager::write_page(int fd, int64_t page_no, const uint8_t *buf, int num_bytes) {
+    if (needs_bounce(fd, buf, num_bytes)) {
+        // Write the whole pages covering the range, keeping the bytes after it
+        int size = (num_bytes + PF_IO_ALIGN - 1) / PF_IO_ALIGN * PF_IO_ALIGN;
+        PfAlignedBuf bounce = alloc_aligned(size);
+        if (size != num_bytes) {
+            memset(bounce.get(), 0, size);
+            if (pread(fd, bounce.get(), size, (off_t)page_no * PAGE_SIZE) < 0) {
+                throw UnixError();
+            }
+        }
+        memcpy(bounce.get(), buf, num_bytes);
+        if (pwrite(fd, bounce.get(), size, (off_t)page_no * PAGE_SIZE) != size) {
+            throw UnixError();
+        }
+        return;
+    }
+    ssize_t bytes_write = pwrite(fd, buf, num_bytes, (off_t)page_no * PAGE_SIZE);
     if (bytes_write != num_bytes) {
         throw UnixError();
     }
 }
 
-Page *PfPager::create_page(int fd, int page_no) {
+void PfPager::sync_file(int fd) {
+    if (fdatasync(fd) != 0) {
+        throw UnixError();
+    }
+}
+
+void PfPager::write_pages(int fd, int64_t page_no, const uint8_t *const *bufs, int num_pages) {
+    std::vector<iovec> iov(num_pages);
+    for (int i = 0; i < num_pages; i++) {
+        iov[i].iov_base = const_cast<uint8_t *>(bufs[i]);
+        iov[i].iov_len = PAGE_SIZE;
+    }
+    off_t offset = (off_t)page_no * PAGE_SIZE;
+    iovec *cur = iov.data();
+    int num_iov = num_pages;
+    while (num_iov > 0) {
+        ssize_t bytes_write = pwritev(fd, cur, std::min(num_iov, IOV_MAX), offset);
+        if (bytes_write <= 0) {
+            throw UnixError();
+        }
+        offset += bytes_write;
+        // Skip the buffers already written and resume from the middle of a partially written one
+        while (num_iov > 0 && (size_t)bytes_write >= cur->iov_len) {
+            bytes_write -= cur->iov_len;
+            cur++;
+            num_iov--;
+        }
+        if (num_iov > 0) {
+            cur->iov_base = (uint8_t *)cur->iov_base + bytes_write;
+            cur->iov_len -= bytes_write;
+        }
+    }
+}
+
+PageGuard PfPager::create_page(int fd, int64_t page_no) {
     Page *page = get_page<false>(fd, page_no);
     page->mark_dirty();
-    return page;
+    return PageGuard(this, page);
 }
 
-Page *PfPager::fetch_page(int fd, int page_no) { return get_page<true>(fd, page_no); }
+PageGuard PfPager::fetch_page(int fd, int64_t page_no) {
+    if (!_warmup.empty()) {
+        warm_up_step();
+    }
+    readahead(fd, page_no);
+    return PageGuard(this, get_page<true>(fd, page_no));
+}
+
+std::vector<PageGuard> PfPager::fetch_pages(int fd, const std::vector<int64_t> &page_nos) {
+    prefetch_pages(fd, page_nos);
+    std::vector<PageGuard> pages;
+    pages.reserve(page_nos.size());
+    for (int64_t page_no : page_nos) {
+        pages.emplace_back(fetch_page(fd, page_no));
+    }
+    return pages;
+}
+
+void PfPager::prefetch_pages(int fd, const std::vector<int64_t> &page_nos) {
+    auto mapped = _mapped_files.find(fd);
+    if (mapped != _mapped_files.end()) {
+        // The kernel reads the pages into its cache in the background. Advise runs of consecutive pages at once.
+        MappedFile &file = mapped->second;
+        size_t begin = 0;
+        while (begin < page_nos.size()) {
+            size_t end = begin + 1;
+            while (end < page_nos.size() && page_nos[end] == page_nos[end - 1] + 1 &&
+                   page_nos[end] % (PF_MAP_SEGMENT_SIZE / PAGE_SIZE) != 0) {
+                end++;
+            }
+            if (page_nos[begin] >= 0 && page_nos[end - 1] < file.num_pages) {
+                madvise(mapped_addr(file, fd, page_nos[begin]), (end - begin) * PAGE_SIZE, MADV_WILLNEED);
+            }
+            begin = end;
+        }
+        return;
+    }
+    for (int64_t page_no : page_nos) {
+        PageId page_id(fd, page_no);
+        if (_page_table.find(page_id) != nullptr || _flusher.is_pending(page_id)) {
+            continue;
+        }
+        if (_free_pages.empty() && _num_frames >= _capacity && _replacer->victim() == nullptr) {
+            // No frame can be taken without waiting
+            break;
+        }
+        Page *page = alloc_frame();
+        _free_pages.pop_front();
+        page->id = page_id;
+        page->is_dirty = false;
+        page->is_modified = false;
+        page->rec_lsn = -1;
+        // The pending read holds a pin so that the frame is not evicted before the data arrives
+        page->pin_count = 1;
+        page->io_pending = true;
+        admit(page);
+        _io->read_async(page);
+        count(fd, &PfStats::prefetches);
+    }
+    _io->submit();
+}
+
+std::vector<PageId> PfPager::hot_pages() const {
+    std::vector<PageId> page_ids;
+    // Reserved pages are never evicted, so they go first
+    for (Page *page : _page_table.pages()) {
+        if (page->reserved) {
+            page_ids.push_back(page->id);
+        }
+    }
+    std::vector<Page *> pages = _replacer->eviction_order(_page_table.size());
+    for (auto it = pages.rbegin(); it != pages.rend(); ++it) {
+        page_ids.push_back((*it)->id);
+    }
+    return page_ids;
+}
+
+void PfPager::warm_up(const std::vector<PageId> &page_ids) {
+    _warmup.assign(page_ids.begin(), page_ids.end());
+    warm_up_step();
+}
+
+void PfPager::warm_up_step() {
+    // Keep a single batch in flight, so that the reads of fetched pages do not queue behind warm-up
+    reap_io(false);
+    if (_io->num_inflight() > 0) {
+        return;
+    }
+    size_t num_free = _free_pages.size() + (_capacity - std::min(_capacity, _num_frames));
+    size_t max_pages = std::min<size_t>(PF_WARMUP_BATCH_PAGES, num_free);
+    std::vector<PageId> batch;
+    while (!_warmup.empty() && batch.size() < max_pages) {
+        // Pages fetched meanwhile are cached already
+        if (_page_table.find(_warmup.front()) == nullptr) {
+            batch.push_back(_warmup.front());
+        }
+        _warmup.pop_front();
+    }
+    if (batch.size() == num_free) {
+        // The pool is full
+        _warmup.clear();
+    }
+    std::sort(batch.begin(), batch.end(), [](const PageId &a, const PageId &b) {
+        return a.fd < b.fd || (a.fd == b.fd && a.page_no < b.page_no);
+    });
+    size_t begin = 0;
+    while (begin < batch.size()) {
+        std::vector<int64_t> page_nos;
+        size_t end = begin;
+        while (end < batch.size() && batch[end].fd == batch[begin].fd) {
+            page_nos.push_back(batch[end++].page_no);
+        }
+        prefetch_pages(batch[begin].fd, page_nos);
+        begin = end;
+    }
+}
+
+void PfPager::readahead(int fd, int64_t page_no) {
+    if (_max_readahead == 0) {
+        return;
+    }
+    Readahead &ra = _readahead[fd];
+    if (page_no == ra.last_page_no) {
+        return;
+    }
+    if (page_no != ra.last_page_no + 1) {
+        // Random access
+        ra = Readahead();
+        ra.last_page_no = page_no;
+        return;
+    }
+    ra.last_page_no = page_no;
+    // Wait for three pages in a row before reading ahead
+    if (++ra.num_seq < 2) {
+        return;
+    }
+    // Request the next window once the reader enters the second half of the current one
+    if (ra.end - page_no > ra.window / 2) {
+        return;
+    }
+    int max_window = (int)std::min<size_t>(_max_readahead, std::max<size_t>(_capacity / 4, 1));
+    ra.window = std::min(ra.window == 0 ? PF_READAHEAD_MIN_PAGES : ra.window * 2, max_window);
+    int64_t begin = std::max(ra.end, page_no);
+    ra.end = page_no + ra.window;
+    if (ra.end > ra.num_pages) {
+        // The window stops at the end of file. Pages beyond it are either cached or do not exist, since a page is
+        // written back before it is evicted.
+        struct stat st;
+        if (fstat(fd, &st) != 0) {
+            return;
+        }
+        ra.num_pages = st.st_size / PAGE_SIZE;
+        ra.end = std::min(ra.end, std::max(ra.num_pages, begin));
+    }
+    std::vector<int64_t> page_nos;
+    for (int64_t i = begin; i < ra.end; i++) {
+        page_nos.push_back(i);
+    }
+    prefetch_pages(fd, page_nos);
+}
 
 void PfPager::flush_file(int fd) {
-    auto it_page = _busy_pages.begin();
-    while (it_page != _busy_pages.end()) {
-        auto prev_page = it_page;
-        it_page++;
-        if ((*prev_page)->id.fd == fd) {
-            flush_page(*prev_page);
+    wait_io();
+    _readahead.erase(fd);
+    _warmup.erase(std::remove_if(_warmup.begin(), _warmup.end(), [fd](const PageId &id) { return id.fd == fd; }),
+                  _warmup.end());
+    _reserved_fds.erase(fd);
+    auto it = _file_pages.find(fd);
+    if (it != _file_pages.end()) {
+        flush_pages(std::vector<Page *>(it->second.begin(), it->second.end()));
+    }
+    if (is_mapped(fd)) {
+        unmap_file(fd);
+    }
+    // The file is about to be closed, so a later checkpoint cannot sync it
+    if (_unsynced_fds.erase(fd) > 0) {
+        sync_file(fd);
+    }
+    // The descriptor may be reused by another file
+    if ((size_t)fd < _file_stats.size()) {
+        _file_stats[fd] = PfStats();
+    }
+    for (auto it = _undo_pages.begin(); it != _undo_pages.end();) {
+        it = it->fd == fd ? _undo_pages.erase(it) : std::next(it);
+    }
+}
+
+void PfPager::log_page(Page *page) {
+    if (page->is_modified) {
+        if (_wal != nullptr) {
+            if (page->rec_lsn < 0) {
+                page->rec_lsn = _wal->end_lsn();
+            }
+            page->lsn = _wal->log_page(page);
         }
+        page->is_modified = false;
+    }
+}
+
+void PfPager::log_undo(Page *page) {
+    // The disk image is committed unless the open statement has written the page already
+    if (_wal == nullptr || !(page->is_modified || page->lsn > _commit_lsn) || !_undo_pages.insert(page->id).second) {
+        return;
+    }
+    PfAlignedBuf image = alloc_aligned(PAGE_SIZE);
+    ssize_t bytes_read = pread(page->id.fd, image.get(), PAGE_SIZE, (off_t)page->id.page_no * PAGE_SIZE);
+    if (bytes_read < 0) {
+        throw UnixError();
+    }
+    // A page beyond the end of the file has no image to put back
+    if (bytes_read == PAGE_SIZE) {
+        page->lsn = std::max(page->lsn, _wal->log_undo(page->id, image.get()));
+    }
+}
+
+// Once a mapped page is written back, the file holds its image, so the private copy made by the changes is
+// dropped and the page is shared with the kernel page cache again.
+static void drop_private_copy(Page *page) {
+    if (page->is_mapped) {
+        madvise(page->buf, PAGE_SIZE, MADV_DONTNEED);
     }
 }
 
 void PfPager::force_page(Page *page) {
+    // An older copy being written in the background must not overwrite this one
+    _flusher.wait(page->id);
     if (page->is_dirty) {
+        // Write-ahead: the log must reach disk before the page does, and so must the last commit, since the page
+        // may hold its changes
+        log_undo(page);
+        log_page(page);
+        if (_wal != nullptr) {
+            _wal->flush(std::max(page->lsn, _commit_lsn));
+        }
         write_page(page->id.fd, page->id.page_no, page->buf, PAGE_SIZE);
-        page->is_dirty = false;
+        mark_written(page);
+        drop_private_copy(page);
+    }
+}
+
+void PfPager::force_pages(std::vector<Page *> pages) {
+    _flusher.wait();
+    pages.erase(std::remove_if(pages.begin(), pages.end(), [](const Page *page) { return !page->is_dirty; }),
+                pages.end());
+    if (_wal != nullptr && !pages.empty()) {
+        int64_t lsn = _commit_lsn;
+        for (Page *page : pages) {
+            log_undo(page);
+            log_page(page);
+            lsn = std::max(lsn, page->lsn);
+        }
+        _wal->flush(lsn);
+    }
+    std::sort(pages.begin(), pages.end(), [](const Page *a, const Page *b) {
+        return a->id.fd < b->id.fd || (a->id.fd == b->id.fd && a->id.page_no < b->id.page_no);
+    });
+    std::vector<const uint8_t *> bufs;
+    size_t begin = 0;
+    while (begin < pages.size()) {
+        // Find the run of consecutive pages in the same file
+        size_t end = begin + 1;
+        while (end < pages.size() && pages[end]->id.fd == pages[begin]->id.fd &&
+               pages[end]->id.page_no == pages[end - 1]->id.page_no + 1) {
+            end++;
+        }
+        bufs.clear();
+        for (size_t i = begin; i < end; i++) {
+            bufs.push_back(pages[i]->buf);
+        }
+        write_pages(pages[begin]->id.fd, pages[begin]->id.page_no, bufs.data(), (int)bufs.size());
+        for (size_t i = begin; i < end; i++) {
+            mark_written(pages[i]);
+            drop_private_copy(pages[i]);
+        }
+        begin = end;
     }
 }
 
 template <bool EXISTS>
-Page *PfPager::get_page(int fd, int page_no) {
-    Page *page;
+Page *PfPager::get_page(int fd, int64_t page_no) {
+    if (_trace != nullptr) {
+        _trace->record(fd, page_no, !EXISTS);
+    }
+    if (!_mapped_files.empty()) {
+        auto mapped = _mapped_files.find(fd);
+        if (mapped != _mapped_files.end()) {
+            return get_mapped_page(mapped->second, fd, page_no, EXISTS);
+        }
+    }
     PageId page_id(fd, page_no);
-    auto map_it = _busy_map.find(page_id);
-    if (map_it == _busy_map.end()) {
+    Page *page = _page_table.find(page_id);
+    if (page != nullptr && page->io_pending) {
+        wait_io(page);
+        // The page is dropped if the read failed
+        page = _page_table.find(page_id);
+    }
+    if (page == nullptr) {
         // Page is not in memory (i.e. on disk). Allocate new cache page for it.
-        if (_free_pages.empty()) {
-            // Cache is full. Need to flush a page to disk.
-            assert(!_busy_pages.empty());
-            force_page(_busy_pages.back());
-            _busy_map.erase(_busy_pages.back()->id);
-            _busy_pages.splice(_busy_pages.begin(), _busy_pages, --_busy_pages.end());
-        } else {
-            // Cache is not full. Allocate from free pages.
-            _busy_pages.splice(_busy_pages.begin(), _free_pages, _free_pages.begin());
-        }
-        _busy_map[page_id] = _busy_pages.begin();
-        page = _busy_pages.front();
-        page->id = page_id;
-        page->is_dirty = false;
+        page = alloc_frame();
         if (EXISTS) {
+            // Disk is stale until the background write of the page completes
+            _flusher.wait(page_id);
             read_page(fd, page_no, page->buf, PAGE_SIZE);
+            count(fd, &PfStats::misses);
         }
+        _free_pages.pop_front();
+        page->id = page_id;
+        page->is_dirty = false;
+        page->is_modified = false;
+        page->rec_lsn = -1;
+        admit(page);
     } else {
         // Page is in memory
-        page = *map_it->second;
-        access(page);
+        if (!page->reserved) {
+            _replacer->access(page);
+        }
+        count(fd, &PfStats::hits);
     }
+    page->pin_count++;
     return page;
 }
 
-void PfPager::access(Page *page) {
-    assert(in_cache(page->id));
-    _busy_pages.splice(_busy_pages.begin(), _busy_pages, _busy_map[page->id]);
+Page *PfPager::alloc_frame() {
+    if (!_free_pages.empty()) {
+        return _free_pages.front();
+    }
+    if (_num_frames < _capacity) {
+        // Pool is not full yet. Bring more frames into service.
+        if (!_retired_pages.empty()) {
+            _free_pages.splice(_free_pages.begin(), _retired_pages, _retired_pages.begin());
+            _num_frames++;
+        } else {
+            size_t num_pages = std::min<size_t>(PF_CHUNK_PAGES, _capacity - _num_frames);
+            Chunk chunk = alloc_chunk(num_pages);
+            for (size_t i = 0; i < num_pages; i++) {
+                Page *page = &chunk.pages[i];
+                page->buf = chunk.buf + i * PAGE_SIZE;
+                page->is_dirty = false;
+                page->pin_count = 0;
+                page->io_pending = false;
+                page->is_modified = false;
+                page->log_queued = false;
+                page->lsn = 0;
+                page->rec_lsn = -1;
+                page->is_mapped = false;
+                page->reserved = false;
+                _free_pages.push_back(page);
+            }
+            _num_backed[chunk.backing] += num_pages;
+            _chunks.emplace_back(std::move(chunk));
+            _num_frames += num_pages;
+        }
+    } else {
+        // Pool is full. Need to flush an unpinned page to disk.
+        reap_io(false);
+        _flusher.poll();
+        if (_background_flush) {
+            clean_tail();
+        }
+        Page *victim = pick_victim();
+        while (victim == nullptr && _io->num_inflight() > 0) {
+            // Frames held by pending reads become available once the reads complete
+            reap_io(true);
+            victim = pick_victim();
+        }
+        if (victim == nullptr) {
+            throw BufferPoolFullError();
+        }
+        if (_flusher.is_pending(victim->id)) {
+            count(victim->id.fd, &PfStats::flush_waits);
+        }
+        force_page(victim);
+        evict(victim, true);
+        count(victim->id.fd, &PfStats::evictions);
+    }
+    return _free_pages.front();
+}
+
+PfPager::Chunk PfPager::alloc_chunk(size_t num_pages) {
+    // Anonymous mapping is page aligned, and physical memory is committed on first touch.
+    size_t size = num_pages * PAGE_SIZE;
+    int prot = PROT_READ | PROT_WRITE;
+    void *buf = MAP_FAILED;
+    PfHugePages backing = HUGE_PAGES_OFF;
+    // A partial chunk at the end of the pool cannot fill a huge page
+    bool huge = size % PF_HUGE_PAGE_SIZE == 0;
+#ifdef MAP_HUGETLB
+    if (_huge_pages == HUGE_PAGES_HUGETLB && huge) {
+        // Fails if the kernel pool has no free huge page left
+        buf = mmap(nullptr, size, prot, MAP_PRIVATE | MAP_ANONYMOUS | MAP_HUGETLB, -1, 0);
+        if (buf != MAP_FAILED) {
+            backing = HUGE_PAGES_HUGETLB;
+        }
+    }
+#endif
+#ifdef MADV_HUGEPAGE
+    if (buf == MAP_FAILED && _huge_pages != HUGE_PAGES_OFF && huge) {
+        // A transparent huge page needs an aligned range. Map one huge page more and trim both ends.
+        size_t mapped_size = size + PF_HUGE_PAGE_SIZE;
+        auto mapped = (uint8_t *)mmap(nullptr, mapped_size, prot, MAP_PRIVATE | MAP_ANONYMOUS, -1, 0);
+        if (mapped == MAP_FAILED) {
+            throw UnixError();
+        }
+        auto aligned = (uint8_t *)(((uintptr_t)mapped + PF_HUGE_PAGE_SIZE - 1) & ~(uintptr_t)(PF_HUGE_PAGE_SIZE - 1));
+        if (aligned > mapped) {
+            munmap(mapped, aligned - mapped);
+        }
+        munmap(aligned + size, mapped + mapped_size - (aligned + size));
+        buf = aligned;
+        // Refused if transparent huge pages are disabled, in which case normal pages back the range
+        if (madvise(buf, size, MADV_HUGEPAGE) == 0) {
+            backing = HUGE_PAGES_THP;
+        }
+    }
+#endif
+    if (buf == MAP_FAILED) {
+        buf = mmap(nullptr, size, prot, MAP_PRIVATE | MAP_ANONYMOUS, -1, 0);
+        if (buf == MAP_FAILED) {
+            throw UnixError();
+        }
+    }
+    return Chunk{(uint8_t *)buf, num_pages, std::unique_ptr<Page[]>(new Page[num_pages]), backing};
+}
+
+// Amount of memory backed by transparent huge pages in the mapping holding the address, according to
+// /proc/self/smaps. Return -1 if unknown.
+static long thp_backed_kb(const void *addr) {
+    std::ifstream smaps("/proc/self/smaps");
+    std::string line;
+    bool in_mapping = false;
+    while (std::getline(smaps, line)) {
+        uintptr_t begin, end;
+        if (sscanf(line.c_str(), "%" SCNxPTR "-%" SCNxPTR " ", &begin, &end) == 2) {
+            in_mapping = begin <= (uintptr_t)addr && (uintptr_t)addr < end;
+            continue;
+        }
+        long kb;
+        if (in_mapping && sscanf(line.c_str(), "AnonHugePages: %ld kB", &kb) == 1) {
+            return kb;
+        }
+    }
+    return -1;
+}
+
+std::string PfPager::memory_report() {
+    if (_chunks.empty()) {
+        alloc_frame();
+    }
+    const Chunk &chunk = _chunks.front();
+    // Touch a free frame, so that the kernel decides how to back it
+    *(volatile uint8_t *)chunk.buf = 0;
+    std::string backing;
+    if (chunk.backing == HUGE_PAGES_HUGETLB) {
+        backing = "reserved huge pages";
+    } else if (chunk.backing == HUGE_PAGES_THP) {
+        long kb = thp_backed_kb(chunk.buf);
+        backing = kb > 0    ? "transparent huge pages"
+                  : kb == 0 ? "normal pages, transparent huge pages advised but not granted"
+                            : "transparent huge pages if granted by the kernel";
+    } else if (_huge_pages != HUGE_PAGES_OFF) {
+        backing = "normal pages, huge pages unavailable";
+    } else {
+        backing = "normal pages";
+    }
+    return "Buffer pool: " + std::to_string(_capacity * PAGE_SIZE >> 20) + " MiB, backed by " + backing +
+           " (huge pages: " + huge_pages2str(_huge_pages) + ")";
+}
+
+Page *PfPager::pick_victim() const {
+    if (_background_flush || _flusher.num_pending() > 0) {
+        // A page being written by the flusher is evicted only after its write completes, so look past those for a
+        // clean page, or else for a dirty one to write at once
+        Page *dirty = nullptr;
+        for (Page *page : _replacer->eviction_order(PF_VICTIM_SEARCH_PAGES + _flusher.num_pending())) {
+            if (_flusher.is_pending(page->id)) {
+                continue;
+            }
+            if (!page->is_dirty) {
+                return page;
+            }
+            if (dirty == nullptr) {
+                dirty = page;
+            }
+        }
+        if (dirty != nullptr) {
+            return dirty;
+        }
+    }
+    return _replacer->victim();
+}
+
+void PfPager::clean_tail() {
+    size_t target = std::max<size_t>(_capacity / PF_CLEAN_TAIL_RATIO, 1);
+    // Walking the tail is amortized over a number of misses. Each miss shifts the tail by one page, so walk that
+    // much further to keep the whole target clean until the next walk.
+    size_t interval = target / 8;
+    if (++_misses_since_clean < interval) {
+        return;
+    }
+    _misses_since_clean = 0;
+    int64_t lsn = 0;
+    for (Page *page : _replacer->eviction_order(target + interval)) {
+        if (_flusher.num_pending() >= PF_FLUSH_MAX_PAGES) {
+            break;
+        }
+        if (page->is_dirty && !_flusher.is_pending(page->id)) {
+            // The frame is clean once copied, the flusher writes the copy
+            log_undo(page);
+            log_page(page);
+            lsn = std::max({lsn, page->lsn, _commit_lsn});
+            _flusher.write_async(page);
+            mark_written(page);
+        }
+    }
+    if (_wal != nullptr) {
+        _wal->flush(lsn);
+    }
+    _flusher.submit();
+}
+
+void PfPager::mark_written(Page *page) {
+    page->is_dirty = false;
+    page->rec_lsn = -1;
+    count(page->id.fd, &PfStats::write_backs);
+    if (_wal != nullptr) {
+        _unsynced_fds.insert(page->id.fd);
+    }
+}
+
+void PfPager::unpin_page(Page *page) {
+    assert(page->pin_count > 0);
+    page->pin_count--;
+    // Pages are changed only while pinned, so a changed page is seen here at least once
+    if (_wal != nullptr && page->is_modified && !page->log_queued) {
+        page->log_queued = true;
+        _log_queue.push_back(page);
+    }
+}
+
+void PfPager::admit(Page *page) {
+    _page_table.insert(page);
+    page->reserved =
+        !_reserved_fds.empty() && _reserved_fds.count(page->id.fd) > 0 && _num_reserved < reserved_capacity();
+    if (page->reserved) {
+        _num_reserved++;
+    } else {
+        _replacer->insert(page);
+    }
+    std::list<Page *> &file_pages = _file_pages[page->id.fd];
+    file_pages.push_front(page);
+    page->file_pos = file_pages.begin();
+}
+
+void PfPager::evict(Page *page, bool is_victim) {
+    assert(in_cache(page->id) && page->pin_count == 0);
+    // The flusher marks the frame dirty again if the write fails
+    assert(!_flusher.is_pending(page->id));
+    if (page->reserved) {
+        page->reserved = false;
+        _num_reserved--;
+    } else if (is_victim) {
+        _replacer->evict(page);
+    } else {
+        _replacer->erase(page);
+    }
+    _page_table.erase(page->id);
+    auto it = _file_pages.find(page->id.fd);
+    it->second.erase(page->file_pos);
+    if (it->second.empty()) {
+        _file_pages.erase(it);
+    }
+    _free_pages.push_front(page);
+}
+
+void PfPager::reap_io(bool wait) {
+    std::vector<PfIoCompletion> done;
+    _io->reap(done, wait);
+    for (auto &io : done) {
+        Page *page = io.page;
+        page->io_pending = false;
+        page->pin_count--;
+        if (!io.ok) {
+            evict(page);
+        }
+    }
+}
+
+void PfPager::wait_io(Page *page) {
+    while (page->io_pending) {
+        reap_io(true);
+    }
+}
+
+void PfPager::wait_io() {
+    while (_io->num_inflight() > 0) {
+        reap_io(true);
+    }
 }
 
 void PfPager::flush_page(Page *page) {
-    assert(in_cache(page->id));
-    auto map_it = _busy_map.find(page->id);
-    auto busy_it = map_it->second;
+    if (page->pin_count > 0) {
+        throw PagePinnedError(page->id.fd, page->id.page_no);
+    }
     force_page(page);
-    _free_pages.splice(_free_pages.begin(), _busy_pages, busy_it);
-    _busy_map.erase(map_it);
+    evict(page);
     assert(!in_cache(page->id));
 }
 
+void PfPager::flush_pages(const std::vector<Page *> &pages) {
+    for (Page *page : pages) {
+        if (page->pin_count > 0) {
+            throw PagePinnedError(page->id.fd, page->id.page_no);
+        }
+    }
+    force_pages(pages);
+    for (Page *page : pages) {
+        // A mapped page takes no frame
+        if (!page->is_mapped) {
+            evict(page);
+        }
+    }
+}
+
 void PfPager::flush_all() {
-    for (Page *page : _busy_pages) {
-        force_page(page);
+    wait_io();
+    _readahead.clear();
+    std::vector<Page *> pages = _page_table.pages();
+    std::vector<Page *> mapped = mapped_pages();
+    pages.insert(pages.end(), mapped.begin(), mapped.end());
+    flush_pages(pages);
+}
+
+void PfPager::write_back() {
+    wait_io();
+    std::vector<Page *> pages = _page_table.pages();
+    std::vector<Page *> mapped = mapped_pages();
+    pages.insert(pages.end(), mapped.begin(), mapped.end());
+    force_pages(pages);
+}
+
+void PfPager::set_wal(PfWal *wal) {
+    for (Page *page : _log_queue) {
+        page->log_queued = false;
+    }
+    _log_queue.clear();
+    _ckpt_pages.clear();
+    _ckpt_begin_lsn = -1;
+    _unsynced_fds.clear();
+    _undo_pages.clear();
+    _commit_lsn = wal != nullptr ? wal->end_lsn() : 0;
+    _wal = wal;
+}
+
+void PfPager::commit() {
+    if (_wal == nullptr) {
+        return;
+    }
+    for (Page *page : _log_queue) {
+        // The frame may have been written back or reused since it was queued
+        log_page(page);
+        page->log_queued = false;
+    }
+    _log_queue.clear();
+    _wal->commit();
+    _commit_lsn = _wal->end_lsn();
+    _undo_pages.clear();
+    checkpoint_step();
+    if (!_warmup.empty()) {
+        warm_up_step();
+    }
+}
+
+void PfPager::checkpoint() {
+    write_back();
+    if (_wal != nullptr) {
+        finish_checkpoint();
+    }
+}
+
+void PfPager::checkpoint_step() {
+    if (_checkpoint_interval == 0) {
+        return;
+    }
+    int64_t end_lsn = _wal->end_lsn();
+    if (_ckpt_begin_lsn < 0) {
+        if (end_lsn - _wal->redo_lsn() < _checkpoint_interval) {
+            return;
+        }
+        // Begin a checkpoint. The pages dirty now are written back over the following commits.
+        _ckpt_begin_lsn = end_lsn;
+        _ckpt_pages.clear();
+        for (Page *page : _page_table.pages()) {
+            if (page->is_dirty) {
+                _ckpt_pages.push_back(page->id);
+            }
+        }
+        for (Page *page : mapped_pages()) {
+            if (page->is_dirty) {
+                _ckpt_pages.push_back(page->id);
+            }
+        }
+        std::sort(_ckpt_pages.begin(), _ckpt_pages.end(), [](const PageId &a, const PageId &b) {
+            return a.fd < b.fd || (a.fd == b.fd && a.page_no < b.page_no);
+        });
+        _ckpt_next = 0;
+    }
+    // Pace the writes to complete the checkpoint once half an interval of log has been appended since it began,
+    // so that it finishes well before the next one is due
+    double progress = std::min(1.0, 2.0 * (end_lsn - _ckpt_begin_lsn) / _checkpoint_interval);
+    size_t target = std::max((size_t)(progress * _ckpt_pages.size()), _ckpt_next + PF_CHECKPOINT_MIN_PAGES);
+    target = std::min(target, _ckpt_pages.size());
+    _flusher.poll();
+    int64_t lsn = 0;
+    std::vector<Page *> mapped;
+    while (_ckpt_next < target && _flusher.num_pending() < PF_FLUSH_MAX_PAGES) {
+        Page *page = find_page(_ckpt_pages[_ckpt_next++]);
+        // The page may have been written back or evicted since the checkpoint began
+        if (page != nullptr && page->is_mapped) {
+            // The flusher copies frames only, mapped pages are written in place below
+            mapped.push_back(page);
+        } else if (page != nullptr && page->is_dirty) {
+            _flusher.wait(page->id);
+            log_undo(page);
+            log_page(page);
+            lsn = std::max({lsn, page->lsn, _commit_lsn});
+            _flusher.write_async(page);
+            mark_written(page);
+        }
+    }
+    _wal->flush(lsn);
+    _flusher.submit();
+    if (!mapped.empty()) {
+        force_pages(mapped);
+    }
+    if (_ckpt_next == _ckpt_pages.size()) {
+        finish_checkpoint();
+    }
+}
+
+void PfPager::finish_checkpoint() {
+    // Background writes must reach the files before they are synced
+    _flusher.wait();
+    // Changes not logged yet are appended after the current end of the log. Recovery must also see the disk images
+    // logged by the open statement, to put them back if it does not commit.
+    int64_t redo_lsn = _undo_pages.empty() ? _wal->end_lsn() : _commit_lsn;
+    for (Page *page : _page_table.pages()) {
+        if (page->rec_lsn >= 0) {
+            redo_lsn = std::min(redo_lsn, page->rec_lsn);
+        }
+    }
+    for (Page *page : mapped_pages()) {
+        if (page->rec_lsn >= 0) {
+            redo_lsn = std::min(redo_lsn, page->rec_lsn);
+        }
+    }
+    for (int fd : _unsynced_fds) {
+        sync_file(fd);
+    }
+    _unsynced_fds.clear();
+    _wal->checkpoint(redo_lsn);
+    _ckpt_pages.clear();
+    _ckpt_begin_lsn = -1;
+    _num_checkpoints++;
+}
+
+void PfPager::map_file(int fd) {
+    assert(num_file_pages(fd) == 0 && !is_mapped(fd));
+    MappedFile &file = _mapped_files[fd];
+    struct stat st;
+    if (fstat(fd, &st) != 0) {
+        _mapped_files.erase(fd);
+        throw UnixError();
+    }
+    file.num_pages = st.st_size / PAGE_SIZE;
+}
+
+Page *PfPager::get_mapped_page(MappedFile &file, int fd, int64_t page_no, bool exists) {
+    size_t block_no = page_no / PF_CHUNK_PAGES;
+    if (block_no >= file.pages.size()) {
+        file.pages.resize(block_no + 1);
+    }
+    if (file.pages[block_no] == nullptr) {
+        file.pages[block_no].reset(new Page[PF_CHUNK_PAGES]());
+    }
+    Page *page = &file.pages[block_no][page_no % PF_CHUNK_PAGES];
+    if (page->buf == nullptr) {
+        // First access to the page
+        if (page_no >= file.num_pages) {
+            // The file may have been written past the known end through another path
+            struct stat st;
+            if (fstat(fd, &st) != 0) {
+                throw UnixError();
+            }
+            file.num_pages = std::max<int64_t>(file.num_pages, st.st_size / PAGE_SIZE);
+        }
+        if (page_no >= file.num_pages) {
+            if (exists) {
+                // Same as reading past the end of file
+                errno = EINVAL;
+                throw UnixError();
+            }
+            // Touching the mapping beyond the end of file faults, so extend the file first
+            if (ftruncate(fd, (off_t)(page_no + 1) * PAGE_SIZE) != 0) {
+                throw UnixError();
+            }
+            file.num_pages = page_no + 1;
+        }
+        page->id = PageId(fd, page_no);
+        page->buf = mapped_addr(file, fd, page_no);
+        page->rec_lsn = -1;
+        page->is_mapped = true;
+    }
+    count(fd, &PfStats::hits);
+    page->pin_count++;
+    return page;
+}
+
+uint8_t *PfPager::mapped_addr(MappedFile &file, int fd, int64_t page_no) {
+    int64_t offset = page_no * PAGE_SIZE;
+    size_t seg_no = offset / PF_MAP_SEGMENT_SIZE;
+    if (seg_no >= file.segments.size()) {
+        file.segments.resize(seg_no + 1, nullptr);
+    }
+    if (file.segments[seg_no] == nullptr) {
+        // A private mapping, so that changes reach the file only when the pager writes them back after logging
+        void *segment = mmap(nullptr, PF_MAP_SEGMENT_SIZE, PROT_READ | PROT_WRITE, MAP_PRIVATE, fd,
+                             (off_t)seg_no * PF_MAP_SEGMENT_SIZE);
+        if (segment == MAP_FAILED) {
+            throw UnixError();
+        }
+        file.segments[seg_no] = (uint8_t *)segment;
+    }
+    return file.segments[seg_no] + offset % PF_MAP_SEGMENT_SIZE;
+}
+
+std::vector<Page *> PfPager::mapped_pages() {
+    std::vector<Page *> pages;
+    for (auto &entry : _mapped_files) {
+        for (auto &block : entry.second.pages) {
+            for (int i = 0; block != nullptr && i < PF_CHUNK_PAGES; i++) {
+                if (block[i].buf != nullptr) {
+                    pages.push_back(&block[i]);
+                }
+            }
+        }
+    }
+    return pages;
+}
+
+void PfPager::unmap_file(int fd) {
+    MappedFile &file = _mapped_files.at(fd);
+    std::vector<Page *> pages;
+    for (auto &block : file.pages) {
+        for (int i = 0; block != nullptr && i < PF_CHUNK_PAGES; i++) {
+            if (block[i].buf != nullptr) {
+                pages.push_back(&block[i]);
+            }
+        }
+    }
+    flush_pages(pages);
+    // Pages of the file queued for logging were logged by the flush, and their descriptors are about to go
+    _log_queue.erase(std::remove_if(_log_queue.begin(), _log_queue.end(),
+                                    [fd](const Page *page) { return page->is_mapped && page->id.fd == fd; }),
+                     _log_queue.end());
+    for (uint8_t *segment : file.segments) {
+        if (segment != nullptr) {
+            munmap(segment, PF_MAP_SEGMENT_SIZE);
+        }
+    }
+    _mapped_files.erase(fd);
+}
+
+Page *PfPager::find_page(const PageId &page_id) {
+    Page *page = _page_table.find(page_id);
+    if (page == nullptr && !_mapped_files.empty()) {
+        auto mapped = _mapped_files.find(page_id.fd);
+        if (mapped != _mapped_files.end()) {
+            auto &blocks = mapped->second.pages;
+            size_t block_no = page_id.page_no / PF_CHUNK_PAGES;
+            if (block_no < blocks.size() && blocks[block_no] != nullptr) {
+                page = &blocks[block_no][page_id.page_no % PF_CHUNK_PAGES];
+                page = page->buf != nullptr ? page : nullptr;
+            }
+        }
+    }
+    return page;
+}
+
+void PfPager::reserve_file(int fd, int64_t num_pages) {
+    if (is_mapped(fd)) {
+        return;
+    }
+    size_t num_needed = 0;
+    for (int64_t page_no = 0; page_no < num_pages; page_no++) {
+        Page *page = _page_table.find(PageId(fd, page_no));
+        num_needed += page == nullptr || !page->reserved;
+    }
+    size_t num_free = reserved_capacity() - std::min(reserved_capacity(), _num_reserved);
+    if (num_needed > num_free) {
+        throw ReservedPoolFullError(num_needed, num_free);
+    }
+    _reserved_fds.insert(fd);
+    // Move the cached pages out of the replacer
+    auto it = _file_pages.find(fd);
+    if (it != _file_pages.end()) {
+        for (Page *page : it->second) {
+            if (!page->reserved) {
+                _replacer->erase(page);
+                page->reserved = true;
+                _num_reserved++;
+            }
+        }
+    }
+    // Read the others, which are admitted into the reserved region. Readahead is bypassed, since it could fill the
+    // region with pages past the requested ones.
+    std::vector<int64_t> page_nos;
+    for (int64_t page_no = 0; page_no < num_pages; page_no++) {
+        if (_page_table.find(PageId(fd, page_no)) == nullptr) {
+            page_nos.push_back(page_no);
+        }
+        if (page_nos.size() == PF_WARMUP_BATCH_PAGES || (page_no == num_pages - 1 && !page_nos.empty())) {
+            prefetch_pages(fd, page_nos);
+            for (int64_t n : page_nos) {
+                unpin_page(get_page<true>(fd, n));
+            }
+            page_nos.clear();
+        }
+    }
+}
+
+void PfPager::release_file(int fd) {
+    _reserved_fds.erase(fd);
+    auto it = _file_pages.find(fd);
+    if (it != _file_pages.end()) {
+        for (Page *page : it->second) {
+            if (page->reserved) {
+                page->reserved = false;
+                _num_reserved--;
+                _replacer->insert(page);
+            }
+        }
+    }
+}
+
+void PfPager::reset_stats() {
+    _stats = PfStats();
+    std::fill(_file_stats.begin(), _file_stats.end(), PfStats());
+}
+
+size_t PfPager::num_dirty_pages(int fd) {
+    size_t num_dirty = 0;
+    auto it = _file_pages.find(fd);
+    if (it != _file_pages.end()) {
+        for (Page *page : it->second) {
+            num_dirty += page->is_dirty;
+        }
+    }
+    auto mapped = _mapped_files.find(fd);
+    if (mapped != _mapped_files.end()) {
+        for (auto &block : mapped->second.pages) {
+            for (int i = 0; block != nullptr && i < PF_CHUNK_PAGES; i++) {
+                num_dirty += block[i].is_dirty;
+            }
+        }
+    }
+    return num_dirty;
+}
+
+void PfPager::set_policy(PfPolicy policy) {
+    flush_all();
+    _policy = policy;
+    _replacer = PfReplacer::create(policy, _capacity);
+}
+
+void PfPager::set_io_engine(PfIoEngineKind kind) {
+    wait_io();
+    _io = PfIoEngine::create(kind);
+}
+
+void PfPager::resize(size_t capacity) {
+    if (capacity < PF_MIN_CACHE_PAGES) {
+        throw InvalidPoolSizeError(capacity);
+    }
+    wait_io();
+    // Evict pages that do not fit in the new pool
+    while (_page_table.size() > capacity) {
+        Page *victim = _replacer->victim();
+        if (victim == nullptr) {
+            throw BufferPoolFullError();
+        }
+        flush_page(victim);
+    }
+    // Release the memory of spare frames
+    while (_num_frames > capacity) {
+        Page *page = _free_pages.back();
+        // Frames on reserved huge pages cannot be released one by one, and stay until the pool is destroyed
+        madvise(page->buf, PAGE_SIZE, MADV_DONTNEED);
+        _retired_pages.splice(_retired_pages.begin(), _free_pages, --_free_pages.end());
+        _num_frames--;
     }
-    _free_pages.insert(_free_pages.end(), _busy_pages.begin(), _busy_pages.end());
-    _busy_pages.clear();
-    _busy_map.clear();
+    _capacity = capacity;
+    _replacer->resize(capacity);
 }
@@ -2,47 +2,356 @@
 
 #include "error.h"
 #include "pf/pf_defs.h"
+#include "pf/pf_flusher.h"
+#include "pf/pf_io.h"
+#include "pf/pf_page_table.h"
+#include "pf/pf_replacer.h"
+#include "pf/pf_trace.h"
+#include "pf/pf_wal.h"
+#include <deque>
 #include <list>
+#include <memory>
+#include <string>
 #include <unordered_map>
+#include <unordered_set>
+#include <vector>
+
+class PfPager;
+
+// A move-only handle that keeps a page pinned in the buffer pool. The page is unpinned when the guard is destroyed
+// or released, after which the frame may be evicted and reused at any time.
+class PageGuard {
+  public:
+    PageGuard() = default;
+    PageGuard(PfPager *pager, Page *page) : _pager(pager), _page(page) {}
+
+    PageGuard(const PageGuard &other) = delete;
+    PageGuard &operator=(const PageGuard &other) = delete;
+
+    PageGuard(PageGuard &&other) noexcept : _pager(other._pager), _page(other._page) { other._page = nullptr; }
+
+    PageGuard &operator=(PageGuard &&other) noexcept {
+        if (this != &other) {
+            release();
+            _pager = other._pager;
+            _page = other._page;
+            other._page = nullptr;
+        }
+        return *this;
+    }
+
+    ~PageGuard() { release(); }
+
+    Page *get() const { return _page; }
+    Page *operator->() const { return _page; }
+    Page &operator*() const { return *_page; }
+    explicit operator bool() const { return _page != nullptr; }
+
+    // Unpin the page now
+    void release();
+
+  private:
+    PfPager *_pager = nullptr;
+    Page *_page = nullptr;
+};
 
 class PfPager {
+    friend class PageGuard;
+
   public:
-    PfPager();
+    // Memory of the pool is not allocated until pages are loaded.
+    PfPager(size_t capacity = NUM_CACHE_PAGES, PfPolicy policy = POLICY_LRU);
     ~PfPager();
 
     PfPager &operator=(const PfPager &other) = delete;
 
-    static void read_page(int fd, int page_no, uint8_t *buf, int num_bytes);
-    static void write_page(int fd, int page_no, const uint8_t *buf, int num_bytes);
+    // Read or write the first bytes of a page. Any buffer works on a file open for direct I/O, since an unaligned
+    // transfer is staged through an aligned buffer.
+    static void read_page(int fd, int64_t page_no, uint8_t *buf, int num_bytes);
+    static void write_page(int fd, int64_t page_no, const uint8_t *buf, int num_bytes);
+    // Write full pages starting at page_no from the given buffers with a single vectored write.
+    // The buffers must be aligned to PF_IO_ALIGN, as are the frames of the pool.
+    static void write_pages(int fd, int64_t page_no, const uint8_t *const *bufs, int num_pages);
+    // Make the written data of the file durable.
+    static void sync_file(int fd);
 
-    Page *create_page(int fd, int page_no);
+    PageGuard create_page(int fd, int64_t page_no);
 
-    Page *fetch_page(int fd, int page_no);
+    PageGuard fetch_page(int fd, int64_t page_no);
 
+    // Fetch and pin several pages of a file. Missing pages are read concurrently by the async I/O engine.
+    std::vector<PageGuard> fetch_pages(int fd, const std::vector<int64_t> &page_nos);
+
+    // Start asynchronous reads of the pages that are not cached, and return without waiting for them.
+    // A later fetch of such a page waits for its read. Pages that cannot be read (e.g. beyond the end of file)
+    // are silently dropped. Prefetching stops early if no frame is available.
+    void prefetch_pages(int fd, const std::vector<int64_t> &page_nos);
+
+    // Serve the pages of an open file from a mapping of it instead of the pool. Clean pages are used in place in
+    // the kernel page cache. A changed page gets a private copy, which is logged and written back like a frame
+    // and then dropped. Mapped pages take no frames and are never evicted. The file must have no cached pages.
+    void map_file(int fd);
+    bool is_mapped(int fd) const { return _mapped_files.count(fd) > 0; }
+
+    // Load the first pages of a file into the reserved region of the pool, where they are never evicted. Pages of the
+    // file loaded later are kept there too while the region has room. Throws if the region cannot hold the pages.
+    // Mapped files are left as they are, since their pages are never evicted anyway.
+    void reserve_file(int fd, int64_t num_pages);
+    // Return the pages of a file in the reserved region to the replacer.
+    void release_file(int fd);
+    bool is_reserved(int fd) const { return _reserved_fds.count(fd) > 0; }
+
+    // Set the budget of the reserved region in pages. The rest of the pool always keeps PF_MIN_CACHE_PAGES frames.
+    void set_reserved_capacity(size_t capacity) { _reserved_capacity = capacity; }
+    // Number of pages the reserved region can hold
+    size_t reserved_capacity() const {
+        return std::min(_reserved_capacity, _capacity - std::min<size_t>(_capacity, PF_MIN_CACHE_PAGES));
+    }
+    // Number of pages in the reserved region
+    size_t num_reserved() const { return _num_reserved; }
+
+    // Cached pages, hottest first
+    std::vector<PageId> hot_pages() const;
+    // Read the given pages into the pool in the background, hottest first, for a pool starting cold. A sorted batch
+    // at a time is read while pages are fetched, until the pool has no free frame left, so that warm-up never
+    // evicts a page. Pages fetched meanwhile are skipped.
+    void warm_up(const std::vector<PageId> &page_ids);
+    // Number of pages left to warm up
+    size_t num_warmup_pages() const { return _warmup.size(); }
+
+    // Write back and evict all pages of a file, and unmap it if mapped. None of them can be pinned.
     void flush_file(int fd);
+    // Write back and evict an unpinned page.
     void flush_page(Page *page);
+    // Write back and evict all pages. None of them can be pinned.
     void flush_all();
+    // Write back all dirty pages and keep them cached.
+    void write_back();
+
+    // Log changed pages to the write-ahead log before they are written back. Null disables logging.
+    void set_wal(PfWal *wal);
+    // Record every page access to the trace. Null stops tracing.
+    void set_trace(PfTrace *trace) { _trace = trace; }
+    // Log the images of the pages changed since the last commit, and commit them. Once enough log has been
+    // appended since the redo point, this also starts a fuzzy checkpoint, which writes the pages dirty at its start
+    // a few at a time over the following commits through the background flusher, and then moves the redo point.
+    void commit();
+
+    // Write back all dirty pages, sync them, and move the redo point of the log to its end.
+    void checkpoint();
+
+    // Set the amount of log since the redo point that starts a fuzzy checkpoint. Zero disables them.
+    void set_checkpoint_interval(int64_t log_size) { _checkpoint_interval = log_size; }
+
+    // Switch to another replacement policy. All cached pages are flushed to disk.
+    void set_policy(PfPolicy policy);
+
+    // Enable or disable writing back dirty pages near the eviction end in the background.
+    void set_background_flush(bool enable) { _background_flush = enable; }
+
+    // Set the maximum readahead window of sequential readers in pages. Zero disables readahead.
+    void set_readahead(int max_pages) { _max_readahead = max_pages; }
+
+    // Switch the backend of asynchronous reads after waiting for the pending ones.
+    // io_uring falls back to the thread pool if it is not supported.
+    void set_io_engine(PfIoEngineKind kind);
 
-    bool in_cache(const PageId &page_id) const { return _busy_map.find(page_id) != _busy_map.end(); }
+    // Back the frames allocated from now on with huge pages of the given kind, falling back to transparent huge
+    // pages and then to normal pages if the kernel refuses.
+    void set_huge_pages(PfHugePages huge_pages) { _huge_pages = huge_pages; }
 
-    const std::list<Page *> &busy_list() const { return _busy_pages; }
-    const std::unordered_map<PageId, std::list<Page *>::iterator> &busy_map() const { return _busy_map; }
+    // Allocate the first chunk of frames, touch it, and describe the memory backing obtained for it.
+    std::string memory_report();
+
+    // Grow or shrink the pool to the given number of pages. When shrinking, unpinned pages are evicted until the
+    // cached pages fit in the new size, and the memory of the released frames is returned to the OS.
+    void resize(size_t capacity);
+
+    PfPolicy policy() const { return _policy; }
+    PfIoEngineKind io_engine() const { return _io->kind(); }
+    int max_readahead() const { return _max_readahead; }
+    bool background_flush() const { return _background_flush; }
+    PfWal *wal() const { return _wal; }
+    PfHugePages huge_pages() const { return _huge_pages; }
+    // Number of frames allocated with the given backing, counting released frames as well
+    size_t num_frames_backed(PfHugePages backing) const { return _num_backed[backing]; }
+    int64_t checkpoint_interval() const { return _checkpoint_interval; }
+    // Whether a fuzzy checkpoint is writing back pages
+    bool checkpoint_running() const { return _ckpt_begin_lsn >= 0; }
+    // Number of checkpoints completed
+    size_t num_checkpoints() const { return _num_checkpoints; }
+    // Number of pages being written by the background flusher
+    size_t num_pending_writes() const { return _flusher.num_pending(); }
+    // Number of asynchronous reads not completed yet
+    size_t num_pending_io() const { return _io->num_inflight(); }
+    // Maximum number of pages in the pool
+    size_t capacity() const { return _capacity; }
+    // Number of frames currently backed by memory
+    size_t num_frames() const { return _num_frames; }
+
+    bool in_cache(const PageId &page_id) const { return _page_table.find(page_id) != nullptr; }
+
+    // Activity of the pool since the last reset
+    const PfStats &stats() const { return _stats; }
+    // Activity of an open file since it was opened or the last reset
+    PfStats file_stats(int fd) const { return (size_t)fd < _file_stats.size() ? _file_stats[fd] : PfStats(); }
+    void reset_stats();
+    // Number of dirty pages of the file in memory
+    size_t num_dirty_pages(int fd);
+
+    // Number of cached pages of the file, not counting mapped pages
+    size_t num_file_pages(int fd) const {
+        auto it = _file_pages.find(fd);
+        return it == _file_pages.end() ? 0 : it->second.size();
+    }
+
+    const PfPageTable &page_table() const { return _page_table; }
     const std::list<Page *> &free_list() const { return _free_pages; }
+    const PfReplacer &replacer() const { return *_replacer; }
 
   private:
-    static void force_page(Page *page);
+    // Log the image of the page if it changed since it was last logged.
+    void log_page(Page *page);
+    // Before the first write of a page changed by the open statement, log the image the page has on disk, so that
+    // recovery can put it back if the statement does not commit.
+    void log_undo(Page *page);
+
+    void force_page(Page *page);
+    // Write back dirty pages in (fd, page_no) order, coalescing consecutive pages into one write.
+    void force_pages(std::vector<Page *> pages);
 
-    // Get the page from memory corresponding to the disk page.
+    // Mark a page clean after its image has been written or handed to the flusher.
+    void mark_written(Page *page);
+
+    // Advance the fuzzy checkpoint, starting one if it is due.
+    void checkpoint_step();
+    // Sync the written files and move the redo point to the oldest change not on disk yet.
+    void finish_checkpoint();
+
+    // Write back and evict the given pages. Nothing is written if any of them is pinned.
+    void flush_pages(const std::vector<Page *> &pages);
+
+    // Get the page from memory corresponding to the disk page and pin it.
     // If the page is not in memory, allocate a page and read the disk.
     template <bool EXISTS>
-    Page *get_page(int fd, int page_no);
+    Page *get_page(int fd, int64_t page_no);
+
+    void unpin_page(Page *page);
+
+    // A file served from a mapping
+    struct MappedFile;
+
+    // Pin a page of a mapped file. A page created beyond the end of the file extends it.
+    Page *get_mapped_page(MappedFile &file, int fd, int64_t page_no, bool exists);
+    // Address of the page in the mapping of its file
+    uint8_t *mapped_addr(MappedFile &file, int fd, int64_t page_no);
+    // Pages of mapped files accessed so far
+    std::vector<Page *> mapped_pages();
+    void unmap_file(int fd);
 
-    void access(Page *page);
+    // Cached or mapped page, null if neither
+    Page *find_page(const PageId &page_id);
+
+    // Count an event of the file, both in the pool counters and in those of the file.
+    void count(int fd, uint64_t PfStats::*counter) {
+        _stats.*counter += 1;
+        if ((size_t)fd >= _file_stats.size()) {
+            _file_stats.resize(fd + 1);
+        }
+        _file_stats[fd].*counter += 1;
+    }
+
+    // Get a free frame, allocating or evicting one if necessary.
+    Page *alloc_frame();
+
+    // Map the memory of a chunk of frames, backed by huge pages if possible.
+    struct Chunk;
+    Chunk alloc_chunk(size_t num_pages);
+
+    // Choose the page to evict, preferring a clean one near the eviction end and skipping pages being written by
+    // the flusher.
+    Page *pick_victim() const;
+
+    // Hand the dirty pages next in line for eviction to the background flusher.
+    void clean_tail();
+
+    // Make a page with its id set resident in the cache.
+    void admit(Page *page);
+
+    // Remove a resident page from the cache and put it back to the free list. A victim evicted to make room for
+    // another page may be remembered by the replacer.
+    void evict(Page *page, bool is_victim = false);
+
+    // Read the next batch of warm-up pages once the previous one is done.
+    void warm_up_step();
+
+    // Track the access pattern of the file, and prefetch the pages ahead of a sequential reader.
+    void readahead(int fd, int64_t page_no);
+
+    // Process finished asynchronous reads. If wait is true, block until at least one read completes.
+    void reap_io(bool wait);
+    // Wait until the asynchronous read into the page completes.
+    void wait_io(Page *page);
+    // Wait until all asynchronous reads complete.
+    void wait_io();
 
   private:
-    uint8_t _cache[NUM_CACHE_PAGES * PAGE_SIZE];
-    Page _pages[NUM_CACHE_PAGES];
-    std::unordered_map<PageId, std::list<Page *>::iterator> _busy_map;
-    std::list<Page *> _busy_pages;
+    // A contiguous memory area holding a group of frames
+    struct Chunk {
+        uint8_t *buf;
+        size_t num_pages;
+        std::unique_ptr<Page[]> pages;
+        PfHugePages backing; // kind of pages backing the memory, off for normal pages
+    };
+
+    struct MappedFile {
+        std::vector<uint8_t *> segments;            // mappings of PF_MAP_SEGMENT_SIZE bytes, made on first access
+        std::vector<std::unique_ptr<Page[]>> pages; // descriptors in blocks of PF_CHUNK_PAGES, made on first access
+        int64_t num_pages = 0;                      // size of the file in pages
+    };
+
+    // Readahead state of a file
+    struct Readahead {
+        int64_t last_page_no = -1; // page fetched last time
+        int num_seq = 0;           // length of the current sequential run
+        int window = 0;            // size of the current readahead window
+        int64_t end = 0;           // pages before end have been requested
+        int64_t num_pages = 0;     // size of the file in pages when last looked up
+    };
+
+    size_t _capacity;
+    size_t _num_frames = 0;
+    std::vector<Chunk> _chunks;
+    std::list<Page *> _retired_pages; // frames released by shrinking, whose memory is returned to the OS
+    PfHugePages _huge_pages = HUGE_PAGES_THP;
+    size_t _num_backed[3] = {}; // frames allocated per backing
+    PfPolicy _policy;
+    std::unique_ptr<PfReplacer> _replacer;
+    PfPageTable _page_table;
+    std::unordered_map<int, std::list<Page *>> _file_pages; // fd -> resident pages of the file
+    std::unordered_map<int, MappedFile> _mapped_files;      // fd -> mapping of the file
     std::list<Page *> _free_pages;
+    std::unique_ptr<PfIoEngine> _io;
+    PfFlusher _flusher;
+    bool _background_flush = true;
+    size_t _misses_since_clean = 0;
+    int _max_readahead = PF_READAHEAD_MAX_PAGES;
+    std::unordered_map<int, Readahead> _readahead; // fd -> readahead state
+    std::deque<PageId> _warmup;                    // pages left to warm up, hottest first
+    std::unordered_set<int> _reserved_fds;         // files kept in the reserved region
+    size_t _reserved_capacity = PF_RESERVED_PAGES;
+    size_t _num_reserved = 0;
+    PfWal *_wal = nullptr;
+    PfTrace *_trace = nullptr;
+    std::vector<Page *> _log_queue; // frames changed since the last commit, may hold stale entries
+    int64_t _commit_lsn = 0;               // end of the log after the last commit
+    std::unordered_set<PageId> _undo_pages; // pages whose disk image the open statement has logged
+    std::unordered_set<int> _unsynced_fds; // files written since the last checkpoint
+    int64_t _checkpoint_interval = PF_CHECKPOINT_LOG_SIZE;
+    int64_t _ckpt_begin_lsn = -1;    // end of the log when the running checkpoint began, -1 if none is running
+    std::vector<PageId> _ckpt_pages; // pages dirty when the running checkpoint began, sorted
+    size_t _ckpt_next = 0;           // pages before this have been written by the running checkpoint
+    size_t _num_checkpoints = 0;
+    PfStats _stats;
+    std::vector<PfStats> _file_stats; // fd -> activity of the file
 };
@@ -0,0 +1,139 @@
+#include "pf/pf_replacer.h"
+#include <algorithm>
+#include <cassert>
+
+// Find the least recent unpinned page in the queue
+static Page *last_unpinned(const std::list<Page *> &queue) {
+    for (auto it = queue.rbegin(); it != queue.rend(); it++) {
+        if ((*it)->pin_count == 0) {
+            return *it;
+        }
+    }
+    return nullptr;
+}
+
+// Append the unpinned pages of the queue from the least recent one, until there are n pages. The first skip
+// unpinned pages are ignored.
+static void append_unpinned(const std::list<Page *> &queue, std::vector<Page *> &pages, size_t n, size_t skip = 0) {
+    for (auto it = queue.rbegin(); it != queue.rend() && pages.size() < n; it++) {
+        if ((*it)->pin_count == 0) {
+            if (skip > 0) {
+                skip--;
+            } else {
+                pages.push_back(*it);
+            }
+        }
+    }
+}
+
+std::unique_ptr<PfReplacer> PfReplacer::create(PfPolicy policy, size_t capacity) {
+    switch (policy) {
+    case POLICY_LRU:
+        return std::make_unique<LruReplacer>();
+    case POLICY_2Q:
+        return std::make_unique<TwoQReplacer>(capacity);
+    default:
+        throw InternalError("Unexpected replacement policy");
+    }
+}
+
+void LruReplacer::insert(Page *page) {
+    _lru.push_front(page);
+    page->pos = _lru.begin();
+}
+
+void LruReplacer::access(Page *page) { _lru.splice(_lru.begin(), _lru, page->pos); }
+
+void LruReplacer::erase(Page *page) { _lru.erase(page->pos); }
+
+Page *LruReplacer::victim() const { return last_unpinned(_lru); }
+
+std::vector<Page *> LruReplacer::eviction_order(size_t n) const {
+    std::vector<Page *> pages;
+    append_unpinned(_lru, pages, n);
+    return pages;
+}
+
+TwoQReplacer::TwoQReplacer(size_t capacity) { resize(capacity); }
+
+// Kin = 25% and Kout = 50% of the pool size, as recommended by the paper.
+void TwoQReplacer::resize(size_t capacity) {
+    _max_a1in = std::max<size_t>(capacity / 4, 1);
+    _max_a1out = std::max<size_t>(capacity / 2, 1);
+    while (_a1out.size() > _max_a1out) {
+        _a1out_map.erase(_a1out.back());
+        _a1out.pop_back();
+    }
+}
+
+void TwoQReplacer::insert(Page *page) {
+    auto ghost_it = _a1out_map.find(page->id);
+    if (ghost_it != _a1out_map.end()) {
+        // Page was evicted recently from A1in and is referenced again, so it is hot.
+        _a1out.erase(ghost_it->second);
+        _a1out_map.erase(ghost_it);
+        _am.push_front(page);
+        page->pos = _am.begin();
+        page->queue = QUEUE_AM;
+    } else {
+        _a1in.push_front(page);
+        page->pos = _a1in.begin();
+        page->queue = QUEUE_A1IN;
+    }
+}
+
+void TwoQReplacer::access(Page *page) {
+    // Re-references within A1in are correlated references and do not promote the page.
+    if (page->queue == QUEUE_AM) {
+        _am.splice(_am.begin(), _am, page->pos);
+    }
+}
+
+void TwoQReplacer::evict(Page *page) {
+    erase(page);
+    if (page->queue == QUEUE_AM) {
+        return;
+    }
+    // Remember the evicted page in the ghost queue
+    assert(_a1out_map.count(page->id) == 0);
+    _a1out.push_front(page->id);
+    _a1out_map[page->id] = _a1out.begin();
+    if (_a1out.size() > _max_a1out) {
+        _a1out_map.erase(_a1out.back());
+        _a1out.pop_back();
+    }
+}
+
+void TwoQReplacer::erase(Page *page) {
+    if (page->queue == QUEUE_AM) {
+        _am.erase(page->pos);
+    } else {
+        _a1in.erase(page->pos);
+    }
+}
+
+Page *TwoQReplacer::victim() const {
+    Page *page = nullptr;
+    if (_a1in.size() > _max_a1in) {
+        page = last_unpinned(_a1in);
+    }
+    if (page == nullptr) {
+        page = last_unpinned(_am);
+    }
+    if (page == nullptr) {
+        page = last_unpinned(_a1in);
+    }
+    return page;
+}
+
+// Follows victim(): the excess of A1in goes first, then Am, then the rest of A1in.
+std::vector<Page *> TwoQReplacer::eviction_order(size_t n) const {
+    std::vector<Page *> pages;
+    if (_a1in.size() > _max_a1in) {
+        append_unpinned(_a1in, pages, std::min(n, _a1in.size() - _max_a1in));
+    }
+    size_t num_a1in = pages.size();
+    append_unpinned(_am, pages, n);
+    append_unpinned(_a1in, pages, n, num_a1in);
+    return pages;
+}
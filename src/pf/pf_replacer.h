@@ -0,0 +1,83 @@
+#pragma once
+
+#include "error.h"
+#include "pf/pf_defs.h"
+#include <list>
+#include <memory>
+#include <unordered_map>
+#include <vector>
+
+// A replacer tracks the resident pages of the buffer pool and decides which one to evict.
+class PfReplacer {
+  public:
+    virtual ~PfReplacer() = default;
+
+    // A page has just been loaded into the pool.
+    virtual void insert(Page *page) = 0;
+
+    // A resident page is referenced again.
+    virtual void access(Page *page) = 0;
+
+    // A resident page is evicted to make room for another one.
+    virtual void evict(Page *page) { erase(page); }
+
+    // A resident page is leaving the pool or the replacer for another reason, e.g. its file is closed.
+    virtual void erase(Page *page) = 0;
+
+    // Get the unpinned page to evict next. Return nullptr if every resident page is pinned.
+    virtual Page *victim() const = 0;
+
+    // Get up to n unpinned pages in the order they are going to be evicted, starting with victim().
+    virtual std::vector<Page *> eviction_order(size_t n) const = 0;
+
+    // The pool is resized to the given number of pages.
+    virtual void resize(size_t capacity) {}
+
+    static std::unique_ptr<PfReplacer> create(PfPolicy policy, size_t capacity);
+};
+
+// Classic LRU. The most recently used page is at the front of the list.
+class LruReplacer : public PfReplacer {
+  public:
+    void insert(Page *page) override;
+    void access(Page *page) override;
+    void erase(Page *page) override;
+    Page *victim() const override;
+    std::vector<Page *> eviction_order(size_t n) const override;
+
+    const std::list<Page *> &lru_list() const { return _lru; }
+
+  private:
+    std::list<Page *> _lru;
+};
+
+// The full 2Q algorithm by Johnson & Shasha (VLDB'94). A page referenced only once is admitted into a small FIFO
+// queue A1in and evicted from there, so a large sequential scan cannot flush the hot pages out of the main LRU
+// queue Am. The ids of pages evicted from A1in are remembered in a ghost queue A1out, and a page re-referenced
+// while it is still in A1out is promoted to Am. Pages erased for other reasons are forgotten.
+class TwoQReplacer : public PfReplacer {
+  public:
+    enum Queue { QUEUE_A1IN, QUEUE_AM };
+
+    TwoQReplacer(size_t capacity);
+
+    void insert(Page *page) override;
+    void access(Page *page) override;
+    void evict(Page *page) override;
+    void erase(Page *page) override;
+    Page *victim() const override;
+    std::vector<Page *> eviction_order(size_t n) const override;
+    void resize(size_t capacity) override;
+
+    const std::list<Page *> &a1in_list() const { return _a1in; }
+    const std::list<Page *> &am_list() const { return _am; }
+    const std::list<PageId> &a1out_list() const { return _a1out; }
+
+  private:
+    size_t _max_a1in;
+    size_t _max_a1out;
+    std::list<Page *> _a1in;
+    std::list<Page *> _am;
+    std::list<PageId> _a1out;
+    std::unordered_map<PageId, std::list<PageId>::iterator> _a1out_map;
+};
@@ -1,5 +1,11 @@
 #include "pf/pf.h"
+#include <array>
+#include <chrono>
+#include <climits>
+#include <fstream>
 #include <gtest/gtest.h>
+#include <sys/wait.h>
+#include <thread>
 
 TEST(PfManagerTest, basic) {
     std::string path1 = "a.txt";
@@ -38,20 +44,28 @@ TEST(PfManagerTest, basic) {
     EXPECT_THROW(PfManager::destroy_file(path1), FileNotFoundError);
 }
 
+static const std::list<Page *> &lru_list() {
+    return dynamic_cast<const LruReplacer &>(PfManager::pager.replacer()).lru_list();
+}
+
 static void check_pages(const std::list<PageId> &busy_page_ids) {
-    EXPECT_EQ(PfManager::pager.free_list().size(), NUM_CACHE_PAGES - busy_page_ids.size());
-    EXPECT_EQ(PfManager::pager.busy_list().size(), busy_page_ids.size());
-    auto busy_it = PfManager::pager.busy_list().begin();
+    EXPECT_LE(PfManager::pager.num_frames(), NUM_CACHE_PAGES);
+    EXPECT_EQ(PfManager::pager.free_list().size(), PfManager::pager.num_frames() - busy_page_ids.size());
+    EXPECT_EQ(lru_list().size(), busy_page_ids.size());
+    auto busy_it = lru_list().begin();
     for (const auto &pid : busy_page_ids) {
         EXPECT_EQ(pid, (*busy_it)->id);
         EXPECT_TRUE(PfManager::pager.in_cache(pid));
-        EXPECT_EQ(PfManager::pager.busy_map().at(pid), busy_it);
+        EXPECT_EQ(PfManager::pager.page_table().find(pid), *busy_it);
         busy_it++;
     }
 }
 
 TEST(PfPagerTest, lru) {
     srand((unsigned)time(nullptr));
+    ASSERT_EQ(PfManager::pager.policy(), POLICY_LRU);
+    // Eviction skips pages being written in the background, so check the exact order without the flusher
+    PfManager::pager.set_background_flush(false);
 
     std::vector<std::string> paths{"0.txt", "1.txt", "2.txt", "3.txt"};
     std::vector<int> fds;
@@ -92,6 +106,7 @@ TEST(PfPagerTest, lru) {
         busy_page_ids.erase(curr_it);
     }
     check_pages(busy_page_ids);
+    PfManager::pager.set_background_flush(true);
 
     for (int fd : fds) {
         PfManager::close_file(fd);
@@ -118,7 +133,7 @@ class MockPager {
 
     void check_cache(int fd, int page_no) {
         EXPECT_TRUE(PfManager::pager.in_cache({fd, page_no}));
-        Page *page = PfManager::pager.fetch_page(fd, page_no);
+        PageGuard page = PfManager::pager.fetch_page(fd, page_no);
         uint8_t *mock_buf = get_page(fd, page_no);
         EXPECT_EQ(memcmp(page->buf, mock_buf, PAGE_SIZE), 0);
     }
@@ -133,7 +148,618 @@ void rand_buf(int size, uint8_t *buf) {
     }
 }
 
-TEST(PfPagerTest, readwrite) {
+TEST(PfPagerTest, pin) {
+    std::string path = "pin.txt";
+    if (PfManager::is_file(path)) {
+        PfManager::destroy_file(path);
+    }
+    PfManager::create_file(path);
+    int fd = PfManager::open_file(path);
+
+    // Pin every page in the pool
+    std::vector<PageGuard> guards;
+    for (int i = 0; i < NUM_CACHE_PAGES; i++) {
+        guards.emplace_back(PfManager::pager.create_page(fd, i));
+        guards.back()->buf[0] = (uint8_t)i;
+        EXPECT_EQ(guards.back()->pin_count, 1);
+    }
+    EXPECT_THROW(PfManager::pager.create_page(fd, NUM_CACHE_PAGES), BufferPoolFullError);
+    EXPECT_FALSE(PfManager::pager.in_cache({fd, NUM_CACHE_PAGES}));
+    // Pin the same page twice
+    {
+        PageGuard guard = PfManager::pager.fetch_page(fd, 0);
+        EXPECT_EQ(guard.get(), guards[0].get());
+        EXPECT_EQ(guard->pin_count, 2);
+        PageGuard moved = std::move(guard);
+        EXPECT_FALSE(guard);
+        EXPECT_EQ(moved->pin_count, 2);
+    }
+    EXPECT_EQ(guards[0]->pin_count, 1);
+    // Only the unpinned page can be evicted
+    guards[100].release();
+    PfManager::pager.create_page(fd, NUM_CACHE_PAGES);
+    EXPECT_FALSE(PfManager::pager.in_cache({fd, 100}));
+    for (int i = 0; i < NUM_CACHE_PAGES; i++) {
+        if (i != 100) {
+            EXPECT_TRUE(PfManager::pager.in_cache({fd, i}));
+            EXPECT_EQ(guards[i]->buf[0], (uint8_t)i);
+        }
+    }
+    EXPECT_THROW(PfManager::close_file(fd), PagePinnedError);
+    guards.clear();
+
+    PfManager::close_file(fd);
+    PfManager::destroy_file(path);
+}
+
+TEST(PfPagerTest, resize) {
+    std::string path = "resize.txt";
+    if (PfManager::is_file(path)) {
+        PfManager::destroy_file(path);
+    }
+    PfManager::create_file(path);
+    int fd = PfManager::open_file(path);
+
+    PfPager pager(100);
+    // No memory is allocated until pages are used
+    EXPECT_EQ(pager.num_frames(), 0u);
+    pager.create_page(fd, 0)->buf[0] = 0;
+    EXPECT_EQ(pager.num_frames(), 100u);
+    // Fill the pool
+    for (int i = 1; i < 300; i++) {
+        pager.create_page(fd, i)->buf[0] = (uint8_t)i;
+    }
+    EXPECT_EQ(pager.page_table().size(), 100u);
+    // Grow online
+    pager.resize(1000);
+    EXPECT_EQ(pager.capacity(), 1000u);
+    for (int i = 0; i < 1000; i++) {
+        EXPECT_EQ(pager.fetch_page(fd, i % 300)->buf[0], (uint8_t)(i % 300));
+        if (i >= 300) {
+            pager.create_page(fd, i)->buf[0] = (uint8_t)i;
+        }
+    }
+    EXPECT_EQ(pager.page_table().size(), 1000u);
+    EXPECT_GE(pager.num_frames(), 1000u);
+    // Cannot shrink below the number of pinned pages
+    {
+        std::vector<PageGuard> guards;
+        for (int i = 0; i < 50; i++) {
+            guards.emplace_back(pager.fetch_page(fd, i));
+        }
+        EXPECT_THROW(pager.resize(20), BufferPoolFullError);
+        EXPECT_EQ(pager.capacity(), 1000u);
+    }
+    EXPECT_THROW(pager.resize(PF_MIN_CACHE_PAGES - 1), InvalidPoolSizeError);
+    // Shrink online, evicted pages are written back
+    pager.resize(20);
+    EXPECT_EQ(pager.capacity(), 20u);
+    EXPECT_EQ(pager.num_frames(), 20u);
+    EXPECT_LE(pager.page_table().size(), 20u);
+    for (int i = 0; i < 1000; i++) {
+        EXPECT_EQ(pager.fetch_page(fd, i)->buf[0], (uint8_t)i);
+    }
+    EXPECT_EQ(pager.num_frames(), 20u);
+    // Grow again, retired frames are reused
+    pager.resize(200);
+    for (int i = 0; i < 1000; i++) {
+        EXPECT_EQ(pager.fetch_page(fd, i)->buf[0], (uint8_t)i);
+    }
+    EXPECT_EQ(pager.num_frames(), 200u);
+
+    pager.flush_file(fd);
+    PfManager::close_file(fd);
+    PfManager::destroy_file(path);
+}
+
+TEST(PfPagerTest, huge_pages) {
+    std::string path = "huge.txt";
+    if (PfManager::is_file(path)) {
+        PfManager::destroy_file(path);
+    }
+    PfManager::create_file(path);
+    int fd = PfManager::open_file(path);
+
+    constexpr int num_pages = 2 * PF_CHUNK_PAGES + 100;
+    for (PfHugePages huge_pages : {HUGE_PAGES_OFF, HUGE_PAGES_THP, HUGE_PAGES_HUGETLB}) {
+        PfPager pager(num_pages);
+        pager.set_huge_pages(huge_pages);
+        EXPECT_NE(pager.memory_report().find("Buffer pool"), std::string::npos);
+        for (int i = 0; i < num_pages; i++) {
+            *(int *)pager.create_page(fd, i)->buf = i;
+        }
+        for (int i = 0; i < num_pages; i++) {
+            EXPECT_EQ(*(int *)pager.fetch_page(fd, i)->buf, i);
+        }
+        // Whole chunks fall back as far as needed, and the partial chunk at the end is always on normal pages
+        size_t num_huge = pager.num_frames_backed(HUGE_PAGES_THP) + pager.num_frames_backed(HUGE_PAGES_HUGETLB);
+        EXPECT_EQ(num_huge + pager.num_frames_backed(HUGE_PAGES_OFF), pager.num_frames());
+        EXPECT_GE(pager.num_frames_backed(HUGE_PAGES_OFF), 100u);
+        if (huge_pages == HUGE_PAGES_OFF) {
+            EXPECT_EQ(num_huge, 0u);
+        }
+        if (huge_pages != HUGE_PAGES_HUGETLB) {
+            EXPECT_EQ(pager.num_frames_backed(HUGE_PAGES_HUGETLB), 0u);
+        }
+        // Huge pages are mapped at huge page boundaries
+        for (Page *page : pager.page_table().pages()) {
+            if (page->id.page_no % PF_CHUNK_PAGES == 0 && page->id.page_no < num_pages - 100 && num_huge > 0) {
+                EXPECT_EQ((uintptr_t)page->buf % PF_HUGE_PAGE_SIZE, 0u);
+            }
+        }
+        pager.flush_all();
+    }
+    PfManager::close_file(fd);
+    PfManager::destroy_file(path);
+}
+
+TEST(PfPagerTest, flush) {
+    std::string path = "flush.txt";
+    if (PfManager::is_file(path)) {
+        PfManager::destroy_file(path);
+    }
+    PfManager::create_file(path);
+    int fd = PfManager::open_file(path);
+
+    // Dirty pages in random order, with runs longer than IOV_MAX and holes in between
+    constexpr int num_pages = 5000;
+    std::vector<int64_t> page_nos;
+    for (int i = 0; i < num_pages; i++) {
+        if (i % 1500 != 7) {
+            page_nos.push_back(i);
+        }
+    }
+    for (size_t i = 1; i < page_nos.size(); i++) {
+        std::swap(page_nos[i], page_nos[rand() % (i + 1)]);
+    }
+    PfPager pager(num_pages);
+    for (int page_no : page_nos) {
+        PageGuard page = pager.create_page(fd, page_no);
+        memset(page->buf, 0, PAGE_SIZE);
+        *(int *)page->buf = page_no;
+        *(int *)(page->buf + PAGE_SIZE - sizeof(int)) = ~page_no;
+    }
+    EXPECT_EQ(pager.page_table().size(), page_nos.size());
+    // Nothing is written while a page is pinned
+    {
+        PageGuard page = pager.fetch_page(fd, page_nos.front());
+        EXPECT_THROW(pager.flush_file(fd), PagePinnedError);
+        EXPECT_EQ(pager.page_table().size(), page_nos.size());
+    }
+    pager.flush_file(fd);
+    EXPECT_EQ(pager.page_table().size(), 0u);
+    uint8_t buf[PAGE_SIZE];
+    for (int page_no : page_nos) {
+        PfPager::read_page(fd, page_no, buf, PAGE_SIZE);
+        EXPECT_EQ(*(int *)buf, page_no);
+        EXPECT_EQ(*(int *)(buf + PAGE_SIZE - sizeof(int)), ~page_no);
+    }
+    // Clean pages are not written back
+    pager.fetch_page(fd, 0)->buf[0] = 0xff;
+    pager.flush_all();
+    PfPager::read_page(fd, 0, buf, PAGE_SIZE);
+    EXPECT_EQ(*(int *)buf, 0);
+
+    PfManager::close_file(fd);
+    PfManager::destroy_file(path);
+}
+
+TEST(PfPagerTest, file_pages) {
+    std::vector<std::string> paths{"file0.txt", "file1.txt"};
+    std::vector<int> fds;
+    for (const auto &path : paths) {
+        if (PfManager::is_file(path)) {
+            PfManager::destroy_file(path);
+        }
+        PfManager::create_file(path);
+        fds.push_back(PfManager::open_file(path));
+    }
+
+    PfPager pager(100);
+    for (int i = 0; i < 30; i++) {
+        pager.create_page(fds[0], i);
+        pager.create_page(fds[1], i);
+    }
+    EXPECT_EQ(pager.num_file_pages(fds[0]), 30u);
+    EXPECT_EQ(pager.num_file_pages(fds[1]), 30u);
+    // Evicted pages leave the directory of their file
+    for (int i = 30; i < 80; i++) {
+        pager.create_page(fds[1], i);
+    }
+    size_t num_pages0 = pager.num_file_pages(fds[0]);
+    EXPECT_LT(num_pages0, 30u);
+    EXPECT_EQ(num_pages0 + pager.num_file_pages(fds[1]), 100u);
+    // Flushing a file does not touch the other one
+    pager.flush_file(fds[1]);
+    EXPECT_EQ(pager.num_file_pages(fds[1]), 0u);
+    EXPECT_EQ(pager.num_file_pages(fds[0]), num_pages0);
+    EXPECT_EQ(pager.page_table().size(), num_pages0);
+    pager.flush_file(fds[0]);
+    EXPECT_EQ(pager.num_file_pages(fds[0]), 0u);
+
+    for (int fd : fds) {
+        PfManager::close_file(fd);
+    }
+    for (const auto &path : paths) {
+        PfManager::destroy_file(path);
+    }
+}
+
+TEST(PfPagerTest, stats) {
+    std::vector<std::string> paths{"stats0.txt", "stats1.txt"};
+    std::vector<int> fds;
+    for (const auto &path : paths) {
+        if (PfManager::is_file(path)) {
+            PfManager::destroy_file(path);
+        }
+        PfManager::create_file(path);
+        fds.push_back(PfManager::open_file(path));
+    }
+
+    constexpr int num_pages = PF_MIN_CACHE_PAGES;
+    PfPager pager(num_pages);
+    pager.set_readahead(0);
+    pager.set_background_flush(false);
+    // Creating pages reads nothing
+    for (int i = 0; i < num_pages; i++) {
+        pager.create_page(fds[0], i);
+    }
+    for (int i = 0; i < num_pages; i++) {
+        pager.fetch_page(fds[0], i);
+    }
+    EXPECT_EQ(pager.file_stats(fds[0]).hits, (uint64_t)num_pages);
+    EXPECT_EQ(pager.file_stats(fds[0]).misses, 0u);
+    EXPECT_EQ(pager.num_dirty_pages(fds[0]), (size_t)num_pages);
+    // The second file pushes the first one out, writing back its dirty pages
+    for (int i = 0; i < num_pages; i++) {
+        pager.create_page(fds[1], i);
+    }
+    EXPECT_EQ(pager.file_stats(fds[0]).evictions, (uint64_t)num_pages);
+    EXPECT_EQ(pager.file_stats(fds[0]).write_backs, (uint64_t)num_pages);
+    EXPECT_EQ(pager.num_dirty_pages(fds[0]), 0u);
+    pager.fetch_page(fds[0], 0);
+    EXPECT_EQ(pager.file_stats(fds[0]).misses, 1u);
+    EXPECT_EQ(pager.file_stats(fds[1]).evictions, 1u);
+    EXPECT_EQ(pager.num_dirty_pages(fds[1]), (size_t)num_pages - 1);
+    // The pool counts the events of all files
+    PfStats stats = pager.stats();
+    EXPECT_EQ(stats.hits, (uint64_t)num_pages);
+    EXPECT_EQ(stats.misses, 1u);
+    EXPECT_EQ(stats.evictions, (uint64_t)num_pages + 1);
+    EXPECT_EQ(stats.write_backs, (uint64_t)num_pages + 1);
+    EXPECT_EQ(stats.prefetches, 0u);
+    pager.reset_stats();
+    EXPECT_EQ(pager.stats().evictions, 0u);
+    EXPECT_EQ(pager.file_stats(fds[0]).misses, 0u);
+    // Counters of a file are dropped when it is flushed for closing
+    pager.fetch_page(fds[1], 1);
+    pager.flush_file(fds[1]);
+    EXPECT_EQ(pager.stats().hits, 1u);
+    EXPECT_EQ(pager.file_stats(fds[1]).hits, 0u);
+    pager.flush_file(fds[0]);
+
+    for (int fd : fds) {
+        PfManager::close_file(fd);
+    }
+    for (const auto &path : paths) {
+        PfManager::destroy_file(path);
+    }
+}
+
+TEST(PfPagerTest, reserve) {
+    std::vector<std::string> paths{"reserve0.txt", "reserve1.txt"};
+    std::vector<int> fds;
+    for (const auto &path : paths) {
+        if (PfManager::is_file(path)) {
+            PfManager::destroy_file(path);
+        }
+        PfManager::create_file(path);
+        fds.push_back(PfManager::open_file(path));
+    }
+    constexpr int num_small = 8;
+    constexpr int num_large = 256;
+    uint8_t buf[PAGE_SIZE] = {};
+    for (int i = 0; i < num_large; i++) {
+        *(int *)buf = i;
+        PfPager::write_page(fds[0], i, buf, PAGE_SIZE);
+        PfPager::write_page(fds[1], i, buf, PAGE_SIZE);
+    }
+
+    PfPager pager(32);
+    pager.set_reserved_capacity(12);
+    pager.fetch_page(fds[0], 0);
+    pager.reserve_file(fds[0], num_small);
+    EXPECT_TRUE(pager.is_reserved(fds[0]));
+    EXPECT_EQ(pager.num_reserved(), (size_t)num_small);
+    // A scan of another file does not evict the reserved pages
+    for (int i = 0; i < num_large; i++) {
+        pager.fetch_page(fds[1], i);
+    }
+    for (int i = 0; i < num_small; i++) {
+        ASSERT_TRUE(pager.in_cache(PageId(fds[0], i)));
+        EXPECT_EQ(*(int *)pager.fetch_page(fds[0], i)->buf, i);
+    }
+    EXPECT_EQ(pager.file_stats(fds[0]).evictions, 0u);
+    // Pages of the file loaded later join the region while it has room
+    for (int i = num_small; i < num_large; i++) {
+        pager.fetch_page(fds[0], i);
+    }
+    EXPECT_EQ(pager.num_reserved(), 12u);
+    EXPECT_EQ(pager.page_table().size(), 32u);
+    // The region cannot take the other file
+    EXPECT_THROW(pager.reserve_file(fds[1], num_small), ReservedPoolFullError);
+    EXPECT_FALSE(pager.is_reserved(fds[1]));
+    // Released pages are evicted as usual
+    pager.release_file(fds[0]);
+    EXPECT_EQ(pager.num_reserved(), 0u);
+    for (int i = 0; i < num_large; i++) {
+        pager.fetch_page(fds[1], i);
+    }
+    EXPECT_FALSE(pager.in_cache(PageId(fds[0], 0)));
+    pager.flush_all();
+    // Under 2Q, released pages re-enter A1in rather than jumping into Am ahead of the hot pages
+    PfPager pager_2q(32, POLICY_2Q);
+    pager_2q.set_reserved_capacity(12);
+    pager_2q.set_readahead(0);
+    for (int i = 0; i < num_small; i++) {
+        pager_2q.fetch_page(fds[0], i);
+    }
+    pager_2q.reserve_file(fds[0], num_small);
+    pager_2q.release_file(fds[0]);
+    auto &replacer = dynamic_cast<const TwoQReplacer &>(pager_2q.replacer());
+    EXPECT_EQ(replacer.a1in_list().size(), (size_t)num_small);
+    EXPECT_TRUE(replacer.am_list().empty());
+    EXPECT_TRUE(replacer.a1out_list().empty());
+    pager_2q.flush_all();
+
+    for (int fd : fds) {
+        PfManager::close_file(fd);
+    }
+    for (const auto &path : paths) {
+        PfManager::destroy_file(path);
+    }
+}
+
+TEST(PfPagerTest, async_read) {
+    std::string path = "async.txt";
+    if (PfManager::is_file(path)) {
+        PfManager::destroy_file(path);
+    }
+    PfManager::create_file(path);
+    int fd = PfManager::open_file(path);
+
+    constexpr int num_pages = 500;
+    {
+        PfPager pager;
+        for (int i = 0; i < num_pages; i++) {
+            *(int *)pager.create_page(fd, i)->buf = i;
+        }
+    }
+    for (PfIoEngineKind kind : {IO_ENGINE_URING, IO_ENGINE_THREADS}) {
+        PfPager pager(100);
+        pager.set_io_engine(kind);
+        pager.set_readahead(0);
+#ifndef REDBASE_HAVE_LIBURING
+        EXPECT_EQ(pager.io_engine(), IO_ENGINE_THREADS);
+#endif
+        // Batch fetch of scattered pages
+        std::vector<int64_t> page_nos;
+        for (int i = 0; i < 50; i++) {
+            page_nos.push_back((i * 37) % num_pages);
+        }
+        std::vector<PageGuard> pages = pager.fetch_pages(fd, page_nos);
+        ASSERT_EQ(pages.size(), page_nos.size());
+        for (size_t i = 0; i < pages.size(); i++) {
+            EXPECT_FALSE(pages[i]->io_pending);
+            EXPECT_EQ(*(int *)pages[i]->buf, page_nos[i]);
+        }
+        EXPECT_EQ(pager.num_pending_io(), 0u);
+        // Prefetching stops when every frame is pinned by a guard or a pending read
+        page_nos.clear();
+        for (int i = 0; i < num_pages; i++) {
+            page_nos.push_back(i);
+        }
+        pager.prefetch_pages(fd, page_nos);
+        EXPECT_EQ(pager.page_table().size(), 100u);
+        pages.clear();
+        for (int i = 0; i < num_pages; i++) {
+            EXPECT_EQ(*(int *)pager.fetch_page(fd, i)->buf, i);
+        }
+        EXPECT_EQ(pager.num_pending_io(), 0u);
+        // Pages beyond the end of file are dropped
+        pager.prefetch_pages(fd, {num_pages, num_pages + 1});
+        EXPECT_THROW(pager.fetch_page(fd, num_pages), UnixError);
+        EXPECT_FALSE(pager.in_cache({fd, num_pages}));
+        pager.flush_file(fd);
+        EXPECT_EQ(pager.num_pending_io(), 0u);
+        EXPECT_EQ(pager.page_table().size(), 0u);
+    }
+
+    PfManager::close_file(fd);
+    PfManager::destroy_file(path);
+}
+
+TEST(PfPagerTest, readahead) {
+    std::string path = "readahead.txt";
+    if (PfManager::is_file(path)) {
+        PfManager::destroy_file(path);
+    }
+    PfManager::create_file(path);
+    int fd = PfManager::open_file(path);
+
+    constexpr int num_pages = 1000;
+    PfPager pager(2000);
+    for (int i = 0; i < num_pages; i++) {
+        *(int *)pager.create_page(fd, i)->buf = i;
+    }
+    pager.flush_file(fd);
+    EXPECT_EQ(pager.max_readahead(), PF_READAHEAD_MAX_PAGES);
+    // Random reads do not trigger readahead
+    for (int page_no : {500, 100, 101, 300}) {
+        pager.fetch_page(fd, page_no);
+    }
+    EXPECT_EQ(pager.page_table().size(), 4u);
+    // Readahead starts after three sequential reads
+    pager.fetch_page(fd, 0);
+    pager.fetch_page(fd, 1);
+    EXPECT_FALSE(pager.in_cache({fd, 2}));
+    pager.fetch_page(fd, 2);
+    EXPECT_TRUE(pager.in_cache({fd, 2 + PF_READAHEAD_MIN_PAGES - 1}));
+    EXPECT_FALSE(pager.in_cache({fd, 2 + PF_READAHEAD_MIN_PAGES}));
+    // The window grows as the reader moves on
+    for (int i = 3; i < 200; i++) {
+        EXPECT_EQ(*(int *)pager.fetch_page(fd, i)->buf, i);
+    }
+    EXPECT_TRUE(pager.in_cache({fd, 200 + PF_READAHEAD_MAX_PAGES / 2 - 1}));
+    // The window stops at the end of file
+    for (int i = 200; i < num_pages; i++) {
+        EXPECT_EQ(*(int *)pager.fetch_page(fd, i)->buf, i);
+    }
+    EXPECT_FALSE(pager.in_cache({fd, num_pages}));
+    // Every page but the first two and the random ones was read ahead once, and none past the end
+    EXPECT_EQ(pager.stats().prefetches, (uint64_t)num_pages - 6);
+    pager.flush_file(fd);
+    // Readahead can be disabled
+    pager.set_readahead(0);
+    for (int i = 0; i < 100; i++) {
+        pager.fetch_page(fd, i);
+    }
+    EXPECT_EQ(pager.page_table().size(), 100u);
+    EXPECT_EQ(pager.num_pending_io(), 0u);
+
+    pager.flush_file(fd);
+    PfManager::close_file(fd);
+    PfManager::destroy_file(path);
+}
+
+TEST(PfPagerTest, background_flush) {
+    std::string path = "background.txt";
+    if (PfManager::is_file(path)) {
+        PfManager::destroy_file(path);
+    }
+    PfManager::create_file(path);
+    int fd = PfManager::open_file(path);
+
+    constexpr int capacity = 256;
+    constexpr int num_pages = 2000;
+    PfPager pager(capacity);
+    pager.set_readahead(0);
+    EXPECT_TRUE(pager.background_flush());
+    for (int i = 0; i < num_pages; i++) {
+        *(int *)pager.create_page(fd, i)->buf = i;
+    }
+    // Pages next in line for eviction are kept clean
+    for (Page *page : pager.replacer().eviction_order(capacity / PF_CLEAN_TAIL_RATIO)) {
+        EXPECT_FALSE(page->is_dirty);
+    }
+    // Evicted pages are read back after their background writes complete
+    for (int i = 0; i < num_pages; i++) {
+        PageGuard page = pager.fetch_page(fd, i);
+        EXPECT_EQ(*(int *)page->buf, i);
+        *(int *)page->buf = -i;
+        page->mark_dirty();
+    }
+    for (int i = 0; i < num_pages; i++) {
+        EXPECT_EQ(*(int *)pager.fetch_page(fd, i)->buf, -i);
+    }
+    pager.flush_file(fd);
+    EXPECT_EQ(pager.num_pending_writes(), 0u);
+    uint8_t buf[PAGE_SIZE];
+    for (int i = 0; i < num_pages; i++) {
+        PfPager::read_page(fd, i, buf, PAGE_SIZE);
+        EXPECT_EQ(*(int *)buf, -i);
+    }
+    // Without the flusher, the tail is left dirty
+    pager.set_background_flush(false);
+    for (int i = 0; i < num_pages; i++) {
+        pager.fetch_page(fd, i)->mark_dirty();
+    }
+    EXPECT_EQ(pager.num_pending_writes(), 0u);
+    EXPECT_TRUE(pager.replacer().victim()->is_dirty);
+
+    pager.flush_file(fd);
+    PfManager::close_file(fd);
+    PfManager::destroy_file(path);
+}
+
+TEST(PfPagerTest, background_flush_no_wait) {
+    std::string path = "background_wait.txt";
+    if (PfManager::is_file(path)) {
+        PfManager::destroy_file(path);
+    }
+    PfManager::create_file(path);
+    int fd = PfManager::open_file(path);
+
+    // The tail cleaned at a time fills the flusher queue
+    constexpr int capacity = PF_FLUSH_MAX_PAGES * PF_CLEAN_TAIL_RATIO;
+    constexpr int num_pages = 2 * capacity;
+    PfPager pager(capacity);
+    pager.set_readahead(0);
+    size_t max_pending = 0;
+    for (int i = 0; i < num_pages; i++) {
+        *(int *)pager.create_page(fd, i)->buf = i;
+        max_pending = std::max(max_pending, pager.num_pending_writes());
+    }
+    // Misses evict pages other than those being written instead of waiting for them
+    EXPECT_EQ(max_pending, (size_t)PF_FLUSH_MAX_PAGES);
+    EXPECT_EQ(pager.stats().evictions, (uint64_t)(num_pages - capacity));
+    EXPECT_EQ(pager.stats().flush_waits, 0u);
+    pager.flush_file(fd);
+    uint8_t buf[PAGE_SIZE];
+    for (int i = 0; i < num_pages; i++) {
+        PfPager::read_page(fd, i, buf, PAGE_SIZE);
+        EXPECT_EQ(*(int *)buf, i);
+    }
+
+    PfManager::close_file(fd);
+    PfManager::destroy_file(path);
+}
+
+TEST(PfPagerTest, background_flush_error) {
+    std::string path = "background_error.txt";
+    if (PfManager::is_file(path)) {
+        PfManager::destroy_file(path);
+    }
+    PfManager::create_file(path);
+    // Writes to a descriptor open for reading fail
+    int fd = open(path.c_str(), O_RDONLY);
+    ASSERT_GE(fd, 0);
+
+    // The tail is cleaned on every miss
+    constexpr int capacity = 64;
+    PfPager pager(capacity);
+    pager.set_readahead(0);
+    for (int i = 0; i < capacity; i++) {
+        *(int *)pager.create_page(fd, i)->buf = i;
+    }
+    // The failed background writes are reported by the eviction waiting for them
+    EXPECT_THROW(pager.create_page(fd, capacity), UnixError);
+    while (pager.num_pending_writes() > 0) {
+        try {
+            pager.write_back();
+        } catch (UnixError &) {
+        }
+    }
+    // No change is lost
+    EXPECT_EQ(pager.num_file_pages(fd), (size_t)capacity);
+    EXPECT_EQ(pager.num_dirty_pages(fd), (size_t)capacity);
+    int rw_fd = open(path.c_str(), O_RDWR);
+    ASSERT_GE(rw_fd, 0);
+    ASSERT_EQ(dup2(rw_fd, fd), fd);
+    close(rw_fd);
+    pager.flush_file(fd);
+    uint8_t buf[PAGE_SIZE];
+    for (int i = 0; i < capacity; i++) {
+        PfPager::read_page(fd, i, buf, PAGE_SIZE);
+        EXPECT_EQ(*(int *)buf, i);
+    }
+
+    close(fd);
+    PfManager::destroy_file(path);
+}
+
+static void test_readwrite(PfPolicy policy) {
+    PfManager::pager.set_policy(policy);
     MockPager mock;
 
     // create files
@@ -169,13 +795,13 @@ TEST(PfPagerTest, readwrite) {
 
         if (!is_created[page_id]) {
             // create page
-            Page *page = PfManager::pager.create_page(fd, page_no);
+            PageGuard page = PfManager::pager.create_page(fd, page_no);
             rand_buf(PAGE_SIZE, page->buf);
             memcpy(mock_buf, page->buf, PAGE_SIZE);
         }
 
         // get page
-        Page *page = PfManager::pager.fetch_page(fd, page_no);
+        PageGuard page = PfManager::pager.fetch_page(fd, page_no);
         EXPECT_EQ(memcmp(page->buf, mock_buf, PAGE_SIZE), 0);
         // check equal in cache
         mock.check_cache(fd, page_no);
@@ -187,9 +813,13 @@ TEST(PfPagerTest, readwrite) {
 
         // flush
         if (rand() % 20 == 0) {
-            PfManager::pager.flush_page(page);
+            EXPECT_THROW(PfManager::pager.flush_page(page.get()), PagePinnedError);
+            Page *unpinned = page.get();
+            page.release();
+            PfManager::pager.flush_page(unpinned);
             mock.check_disk(fd, page_no);
         }
+        page.release();
         // flush the entire file
         if (rand() % 200 == 0) {
             PfManager::pager.flush_file(fd);
@@ -222,3 +852,676 @@ TEST(PfPagerTest, readwrite) {
         PfManager::destroy_file(path);
     }
 }
+
+TEST(PfPagerTest, readwrite) {
+    test_readwrite(POLICY_LRU);
+    test_readwrite(POLICY_2Q);
+    PfManager::pager.set_policy(POLICY_LRU);
+}
+
+TEST(PfManagerTest, direct_io) {
+    std::string path = "direct.txt";
+    if (PfManager::is_file(path)) {
+        PfManager::destroy_file(path);
+    }
+    PfManager::create_file(path);
+    PfManager::set_direct_io(true);
+    int fd = PfManager::open_file(path);
+    PfManager::set_direct_io(false);
+    // Falls back to buffered I/O where the filesystem refuses direct I/O
+    EXPECT_EQ(PfManager::is_direct(fd), (fcntl(fd, F_GETFL) & O_DIRECT) != 0);
+
+    // Unaligned buffers and partial pages are staged through aligned ones
+    std::vector<uint8_t> hdr(PAGE_SIZE + 1);
+    rand_buf(PAGE_SIZE, hdr.data() + 1);
+    PfPager::write_page(fd, 0, hdr.data() + 1, PAGE_SIZE);
+    std::vector<uint8_t> buf(PAGE_SIZE + 1);
+    PfPager::read_page(fd, 0, buf.data() + 1, 100);
+    EXPECT_EQ(memcmp(buf.data() + 1, hdr.data() + 1, 100), 0);
+    PfPager::write_page(fd, 0, buf.data() + 1, 10);
+    PfPager::read_page(fd, 0, buf.data() + 1, PAGE_SIZE);
+    EXPECT_EQ(memcmp(buf.data() + 1, hdr.data() + 1, PAGE_SIZE), 0);
+
+    // Pages go through the pool and the background flusher
+    constexpr int num_pages = 256;
+    {
+        PfPager pager(PF_MIN_CACHE_PAGES * 2);
+        for (int i = 1; i < num_pages; i++) {
+            *(int *)pager.create_page(fd, i)->buf = i;
+        }
+        for (int i = 1; i < num_pages; i++) {
+            EXPECT_EQ(*(int *)pager.fetch_page(fd, i)->buf, i);
+        }
+        pager.flush_all();
+        // Asynchronous reads
+        std::vector<int64_t> page_nos;
+        for (int i = 1; i <= PF_MIN_CACHE_PAGES; i++) {
+            page_nos.push_back(i);
+        }
+        auto pages = pager.fetch_pages(fd, page_nos);
+        for (int i = 0; i < PF_MIN_CACHE_PAGES; i++) {
+            EXPECT_EQ(*(int *)pages[i]->buf, i + 1);
+        }
+    }
+    PfManager::close_file(fd);
+    PfManager::destroy_file(path);
+}
+
+TEST(PfManagerTest, mmap_backend) {
+    std::string path = "mmap.txt";
+    std::string wal_path = "mmap_test.log";
+    if (PfManager::is_file(path)) {
+        PfManager::destroy_file(path);
+    }
+    system(("rm -rf " + wal_path).c_str());
+    PfManager::create_file(path);
+    PfManager::set_backend(BACKEND_MMAP);
+    int fd = PfManager::open_file(path);
+    PfManager::set_backend(BACKEND_POOL);
+    EXPECT_TRUE(PfManager::pager.is_mapped(fd));
+
+    // Pages are used in place and take no frames. Changes reach the file only when written back.
+    constexpr int num_pages = 256;
+    size_t num_frames = PfManager::pager.num_frames();
+    for (int i = 0; i < num_pages; i++) {
+        *(int *)PfManager::pager.create_page(fd, i)->buf = i;
+    }
+    EXPECT_EQ(PfManager::pager.num_frames(), num_frames);
+    EXPECT_EQ(PfManager::pager.num_file_pages(fd), 0u);
+    uint8_t buf[PAGE_SIZE];
+    PfPager::read_page(fd, 1, buf, PAGE_SIZE);
+    EXPECT_EQ(*(int *)buf, 0);
+    PfManager::pager.write_back();
+    PfPager::read_page(fd, 1, buf, PAGE_SIZE);
+    EXPECT_EQ(*(int *)buf, 1);
+    for (int i = 0; i < num_pages; i++) {
+        EXPECT_EQ(*(int *)PfManager::pager.fetch_page(fd, i)->buf, i);
+    }
+    EXPECT_THROW(PfManager::pager.fetch_page(fd, num_pages), UnixError);
+    {
+        PageGuard page = PfManager::pager.fetch_page(fd, 1);
+        *(int *)page->buf = -1;
+        page->mark_dirty();
+    }
+    // Closing the file writes back the change and unmaps the file
+    PfManager::close_file(fd);
+    EXPECT_FALSE(PfManager::pager.is_mapped(fd));
+    fd = PfManager::open_file(path);
+    EXPECT_EQ(*(int *)PfManager::pager.fetch_page(fd, 1)->buf, -1);
+    PfManager::close_file(fd);
+
+    // Changes are logged before they are written back, and fuzzy checkpoints write mapped pages too
+    fd = PfManager::open_file(path);
+    pid_t pid = fork();
+    ASSERT_GE(pid, 0);
+    if (pid == 0) {
+        // Crash without writing back the changed pages, whose private copies are lost
+        PfWal wal;
+        wal.open(wal_path);
+        wal.add_file(fd, path);
+        auto pager = new PfPager(PF_MIN_CACHE_PAGES);
+        pager->map_file(fd);
+        pager->set_wal(&wal);
+        pager->set_checkpoint_interval(32 * PAGE_SIZE);
+        for (int round = 0; round < 4; round++) {
+            for (int i = 0; i < num_pages; i++) {
+                PageGuard page = pager->fetch_page(fd, i);
+                *(int *)page->buf = round * num_pages + i;
+                page->mark_dirty();
+                page.release();
+                pager->commit();
+            }
+        }
+        // A statement in progress
+        for (int i = 0; i < num_pages; i++) {
+            PageGuard page = pager->fetch_page(fd, i);
+            *(int *)page->buf = -1;
+            page->mark_dirty();
+        }
+        bool ok = pager->num_checkpoints() > 0 && pager->num_frames() == 0;
+        wal.flush();
+        _exit(ok ? 0 : 1);
+    }
+    int status;
+    ASSERT_EQ(waitpid(pid, &status, 0), pid);
+    ASSERT_TRUE(WIFEXITED(status));
+    EXPECT_EQ(WEXITSTATUS(status), 0);
+    PfWal::recover(wal_path);
+    for (int i = 0; i < num_pages; i++) {
+        PfPager::read_page(fd, i, buf, PAGE_SIZE);
+        EXPECT_EQ(*(int *)buf, 3 * num_pages + i);
+    }
+    PfManager::close_file(fd);
+    PfManager::destroy_file(path);
+    system(("rm -rf " + wal_path).c_str());
+}
+
+TEST(PfManagerTest, warm_up) {
+    std::string path = "warmup.txt";
+    std::string dump_path = "warmup.pool";
+    if (PfManager::is_file(path)) {
+        PfManager::destroy_file(path);
+    }
+    PfManager::create_file(path);
+    int fd = PfManager::open_file(path);
+    constexpr int num_pages = 64;
+    for (int i = 0; i < num_pages; i++) {
+        *(int *)PfManager::pager.create_page(fd, i)->buf = i;
+    }
+    // Pages used last are saved first
+    for (int i : {7, 3, 5}) {
+        PfManager::pager.fetch_page(fd, i);
+    }
+    std::vector<PageId> hot_pages = PfManager::pager.hot_pages();
+    ASSERT_EQ(hot_pages.size(), (size_t)num_pages);
+    EXPECT_EQ(hot_pages[0], PageId(fd, 5));
+    EXPECT_EQ(hot_pages[1], PageId(fd, 3));
+    EXPECT_EQ(hot_pages[2], PageId(fd, 7));
+    PfManager::dump_pool(dump_path);
+    PfManager::close_file(fd);
+
+    // Saved pages are read back in the background by name, whatever the descriptor of the file
+    fd = PfManager::open_file(path);
+    EXPECT_EQ(PfManager::load_pool(dump_path), (size_t)num_pages);
+    EXPECT_EQ(PfManager::pager.num_warmup_pages(), 0u);
+    for (int i = 0; i < num_pages; i++) {
+        EXPECT_TRUE(PfManager::pager.in_cache(PageId(fd, i)));
+        EXPECT_EQ(*(int *)PfManager::pager.fetch_page(fd, i)->buf, i);
+    }
+    PfManager::pager.flush_file(fd);
+    // A smaller pool takes the hottest pages only, and never evicts a page for warm-up
+    {
+        PfPager pager(PF_MIN_CACHE_PAGES);
+        pager.fetch_page(fd, num_pages - 1);
+        std::vector<PageId> page_ids;
+        for (const PageId &page_id : hot_pages) {
+            page_ids.emplace_back(fd, page_id.page_no);
+        }
+        pager.warm_up(page_ids);
+        EXPECT_EQ(pager.num_warmup_pages(), 0u);
+        EXPECT_EQ(pager.page_table().size(), (size_t)PF_MIN_CACHE_PAGES);
+        EXPECT_TRUE(pager.in_cache(PageId(fd, num_pages - 1)));
+        for (int i : {5, 3, 7}) {
+            EXPECT_TRUE(pager.in_cache(PageId(fd, i)));
+            EXPECT_EQ(*(int *)pager.fetch_page(fd, i)->buf, i);
+        }
+    }
+    PfManager::close_file(fd);
+    PfManager::destroy_file(path);
+    unlink(dump_path.c_str());
+}
+
+TEST(PfManagerTest, trace) {
+    std::vector<std::string> paths{"trace0.txt", "trace1.txt"};
+    std::string trace_path = "pf_test.trace";
+    for (const auto &path : paths) {
+        if (PfManager::is_file(path)) {
+            PfManager::destroy_file(path);
+        }
+        PfManager::create_file(path);
+    }
+    // Files open before the trace starts are named too
+    int fd0 = PfManager::open_file(paths[0]);
+    PfManager::start_trace(trace_path);
+    int fd1 = PfManager::open_file(paths[1]);
+    PfManager::pager.create_page(fd0, 0);
+    PfManager::pager.create_page(fd1, 0);
+    PfManager::pager.fetch_page(fd0, 0);
+    PfManager::pager.fetch_page(fd1, 0);
+    // A file opened again is a new file of the trace
+    PfManager::close_file(fd1);
+    fd1 = PfManager::open_file(paths[1]);
+    PfManager::pager.fetch_page(fd1, 0);
+    EXPECT_EQ(PfManager::trace.num_accesses(), 5u);
+    PfManager::stop_trace();
+    PfManager::pager.fetch_page(fd0, 0);
+
+    std::vector<PfTrace::Access> accesses;
+    std::vector<std::string> files;
+    PfTrace::load(trace_path, accesses, files);
+    EXPECT_EQ(files, (std::vector<std::string>{paths[0], paths[1], paths[1]}));
+    std::vector<std::array<int64_t, 3>> expected{{0, 0, 1}, {1, 0, 1}, {0, 0, 0}, {1, 0, 0}, {2, 0, 0}};
+    ASSERT_EQ(accesses.size(), expected.size());
+    for (size_t i = 0; i < accesses.size(); i++) {
+        EXPECT_EQ(accesses[i].file, expected[i][0]);
+        EXPECT_EQ(accesses[i].page_no, expected[i][1]);
+        EXPECT_EQ(accesses[i].create, expected[i][2] != 0);
+    }
+
+    // Large page numbers, and descriptors never named, survive the round trip through several buffer flushes
+    {
+        PfTrace trace;
+        trace.open(trace_path);
+        constexpr int64_t page_no = ((int64_t)1 << 46) + 3;
+        constexpr size_t num_accesses = 3 * PF_TRACE_BUFFER_SIZE / sizeof(uint64_t);
+        for (size_t i = 0; i < num_accesses; i++) {
+            trace.record(100, page_no - i % 4, i % 2);
+        }
+        trace.close();
+        PfTrace::load(trace_path, accesses, files);
+        EXPECT_EQ(files, std::vector<std::string>{"fd100"});
+        ASSERT_EQ(accesses.size(), num_accesses);
+        for (size_t i = 0; i < num_accesses; i++) {
+            EXPECT_EQ(accesses[i].page_no, page_no - (int64_t)(i % 4));
+            EXPECT_EQ(accesses[i].create, i % 2 == 1);
+        }
+    }
+    // Anything else is rejected
+    {
+        std::ofstream ofs(trace_path);
+        ofs << paths[0] << " 0\n";
+    }
+    EXPECT_THROW(PfTrace::load(trace_path, accesses, files), InvalidFileFormatError);
+
+    PfManager::close_file(fd0);
+    PfManager::close_file(fd1);
+    for (const auto &path : paths) {
+        PfManager::destroy_file(path);
+    }
+    unlink(trace_path.c_str());
+}
+
+TEST(PfWalTest, recover) {
+    std::string path = "wal_data.txt";
+    std::string wal_path = "wal_test.log";
+    if (PfManager::is_file(path)) {
+        PfManager::destroy_file(path);
+    }
+    system(("rm -rf " + wal_path).c_str());
+    PfManager::create_file(path);
+    int fd = PfManager::open_file(path);
+
+    constexpr int num_pages = 100;
+    PfWal wal;
+    wal.open(wal_path);
+    wal.add_file(fd, path);
+    {
+        PfPager pager(PF_MIN_CACHE_PAGES);
+        pager.set_wal(&wal);
+        // A committed statement larger than the pool, whose pages are logged on eviction or on commit
+        for (int i = 0; i < num_pages; i++) {
+            *(int *)pager.create_page(fd, i)->buf = i;
+        }
+        pager.commit();
+        // A statement in progress
+        for (int i = 0; i < num_pages; i++) {
+            PageGuard page = pager.fetch_page(fd, i);
+            *(int *)page->buf = -1;
+            page->mark_dirty();
+        }
+    }
+    wal.close();
+    // Crash before any page reaches disk
+    ASSERT_EQ(ftruncate(fd, 0), 0);
+    // Recovery finds the data files whatever the working directory
+    char cwd[PATH_MAX];
+    ASSERT_NE(getcwd(cwd, sizeof(cwd)), nullptr);
+    ASSERT_EQ(chdir("/"), 0);
+    EXPECT_EQ(PfWal::recover(std::string(cwd) + "/" + wal_path), (size_t)num_pages);
+    ASSERT_EQ(chdir(cwd), 0);
+    uint8_t buf[PAGE_SIZE];
+    for (int i = 0; i < num_pages; i++) {
+        PfPager::read_page(fd, i, buf, PAGE_SIZE);
+        EXPECT_EQ(*(int *)buf, i);
+    }
+    // The log is empty after recovery
+    EXPECT_EQ(PfWal::recover(wal_path), 0u);
+
+    // A commit torn by the crash is discarded
+    wal.open(wal_path);
+    std::string segment_path = PfWal::segment_path(wal_path, wal.end_lsn());
+    {
+        PfPager pager(PF_MIN_CACHE_PAGES);
+        pager.set_wal(&wal);
+        *(int *)pager.create_page(fd, 0)->buf = -1;
+        pager.commit();
+        pager.set_wal(nullptr);
+    }
+    wal.close();
+    struct stat st;
+    ASSERT_EQ(stat(segment_path.c_str(), &st), 0);
+    ASSERT_EQ(truncate(segment_path.c_str(), st.st_size - 1), 0);
+    ASSERT_EQ(ftruncate(fd, 0), 0);
+    EXPECT_EQ(PfWal::recover(wal_path), 0u);
+
+    PfManager::close_file(fd);
+    PfManager::destroy_file(path);
+    system(("rm -rf " + wal_path).c_str());
+}
+
+TEST(PfWalTest, group_commit) {
+    std::string path = "wal_group.txt";
+    std::string wal_path = "wal_group.log";
+    if (PfManager::is_file(path)) {
+        PfManager::destroy_file(path);
+    }
+    system(("rm -rf " + wal_path).c_str());
+    PfManager::create_file(path);
+    int fd = PfManager::open_file(path);
+
+    constexpr int num_threads = 8;
+    constexpr int num_commits = 50;
+    PfWal wal;
+    wal.open(wal_path);
+    wal.add_file(fd, path);
+    std::vector<std::thread> threads;
+    for (int t = 0; t < num_threads; t++) {
+        threads.emplace_back([&, t] {
+            uint8_t buf[PAGE_SIZE] = {};
+            Page page{};
+            page.buf = buf;
+            for (int i = 0; i < num_commits; i++) {
+                page.id = PageId(fd, t * num_commits + i);
+                *(int *)buf = t * num_commits + i;
+                wal.log_page(&page);
+                wal.commit();
+            }
+        });
+    }
+    for (auto &thread : threads) {
+        thread.join();
+    }
+    // Every commit is durable on return, with at most one sync each
+    EXPECT_LE(wal.num_syncs(), (size_t)num_threads * num_commits);
+    wal.close();
+    EXPECT_EQ(PfWal::recover(wal_path), (size_t)num_threads * num_commits);
+    uint8_t buf[PAGE_SIZE];
+    for (int i = 0; i < num_threads * num_commits; i++) {
+        PfPager::read_page(fd, i, buf, PAGE_SIZE);
+        EXPECT_EQ(*(int *)buf, i);
+    }
+
+    // In async mode, commits return at once and the log is synced in the background
+    wal.set_durability(DURABILITY_ASYNC, 10);
+    wal.open(wal_path);
+    size_t num_syncs = wal.num_syncs();
+    *(int *)buf = 0;
+    Page page{};
+    page.id = PageId(fd, 0);
+    page.buf = buf;
+    wal.log_page(&page);
+    wal.commit();
+    std::this_thread::sleep_for(std::chrono::milliseconds(100));
+    EXPECT_GT(wal.num_syncs(), num_syncs);
+    wal.close();
+    EXPECT_EQ(PfWal::recover(wal_path), 1u);
+
+    PfManager::close_file(fd);
+    PfManager::destroy_file(path);
+    system(("rm -rf " + wal_path).c_str());
+}
+
+TEST(PfWalTest, checkpoint) {
+    std::string path = "wal_ckpt.txt";
+    std::string wal_path = "wal_ckpt.log";
+    if (PfManager::is_file(path)) {
+        PfManager::destroy_file(path);
+    }
+    system(("rm -rf " + wal_path).c_str());
+    PfManager::create_file(path);
+    int fd = PfManager::open_file(path);
+
+    constexpr int num_pages = 512;
+    constexpr int num_stmts = 200;
+    constexpr int num_writes = 16;
+    constexpr int64_t interval = 256 * PAGE_SIZE;
+    // Every statement changes a few random pages, and each page records the statement that changed it last
+    std::vector<std::vector<int>> stmts(num_stmts);
+    std::vector<int> expect(num_pages, 0);
+    for (int stmt = 0; stmt < num_stmts; stmt++) {
+        for (int i = 0; i < num_writes; i++) {
+            int page_no = rand() % num_pages;
+            stmts[stmt].push_back(page_no);
+            expect[page_no] = stmt;
+        }
+    }
+    pid_t pid = fork();
+    ASSERT_GE(pid, 0);
+    if (pid == 0) {
+        // Crash without writing back the cached pages
+        PfWal wal;
+        wal.set_segment_size(32 * PAGE_SIZE);
+        wal.open(wal_path);
+        wal.add_file(fd, path);
+        auto pager = new PfPager(num_pages);
+        pager->set_wal(&wal);
+        pager->set_checkpoint_interval(interval);
+        for (int i = 0; i < num_pages; i++) {
+            *(int *)pager->create_page(fd, i)->buf = 0;
+        }
+        pager->commit();
+        for (int stmt = 0; stmt < num_stmts; stmt++) {
+            for (int page_no : stmts[stmt]) {
+                PageGuard page = pager->fetch_page(fd, page_no);
+                *(int *)page->buf = stmt;
+                page->mark_dirty();
+            }
+            pager->commit();
+        }
+        // Checkpoints keep the log to be replayed short, and remove the segments before it
+        bool ok = pager->num_checkpoints() > 0 && wal.end_lsn() - wal.redo_lsn() < 2 * interval &&
+                  wal.num_segments() * 32 * PAGE_SIZE < 4 * interval;
+        wal.flush();
+        _exit(ok ? 0 : 1);
+    }
+    int status;
+    ASSERT_EQ(waitpid(pid, &status, 0), pid);
+    ASSERT_TRUE(WIFEXITED(status));
+    EXPECT_EQ(WEXITSTATUS(status), 0);
+    // Replaying from the redo point restores the pages of all statements
+    size_t num_restored = PfWal::recover(wal_path);
+    EXPECT_GT(num_restored, 0u);
+    EXPECT_LT(num_restored, (size_t)num_stmts * num_writes);
+    uint8_t buf[PAGE_SIZE];
+    for (int i = 0; i < num_pages; i++) {
+        PfPager::read_page(fd, i, buf, PAGE_SIZE);
+        EXPECT_EQ(*(int *)buf, expect[i]);
+    }
+
+    PfManager::close_file(fd);
+    PfManager::destroy_file(path);
+    system(("rm -rf " + wal_path).c_str());
+}
+
+TEST(PfWalTest, undo) {
+    std::string path = "wal_undo.txt";
+    std::string wal_path = "wal_undo.log";
+    if (PfManager::is_file(path)) {
+        PfManager::destroy_file(path);
+    }
+    system(("rm -rf " + wal_path).c_str());
+    PfManager::create_file(path);
+    int fd = PfManager::open_file(path);
+
+    constexpr int num_pages = 64;
+    pid_t pid = fork();
+    ASSERT_GE(pid, 0);
+    if (pid == 0) {
+        PfWal wal;
+        wal.open(wal_path);
+        wal.add_file(fd, path);
+        auto pager = new PfPager(PF_MIN_CACHE_PAGES);
+        pager->set_wal(&wal);
+        // Evictions write synchronously, so that the changes are on disk at the crash
+        pager->set_background_flush(false);
+        for (int i = 0; i < num_pages; i++) {
+            *(int *)pager->create_page(fd, i)->buf = i;
+        }
+        pager->commit();
+        // The committed images are on disk only, not in the log to be replayed
+        pager->checkpoint();
+        // Crash in the middle of a statement larger than the pool, some of whose pages have been evicted
+        for (int i = 0; i < num_pages; i++) {
+            PageGuard page = pager->fetch_page(fd, i);
+            *(int *)page->buf = -1;
+            page->mark_dirty();
+        }
+        uint8_t buf[PAGE_SIZE];
+        PfPager::read_page(fd, 0, buf, PAGE_SIZE);
+        _exit(*(int *)buf == -1 ? 0 : 1);
+    }
+    int status;
+    ASSERT_EQ(waitpid(pid, &status, 0), pid);
+    ASSERT_TRUE(WIFEXITED(status));
+    EXPECT_EQ(WEXITSTATUS(status), 0);
+    // Recovery puts back the pages written by the statement
+    PfWal::recover(wal_path);
+    uint8_t buf[PAGE_SIZE];
+    for (int i = 0; i < num_pages; i++) {
+        PfPager::read_page(fd, i, buf, PAGE_SIZE);
+        EXPECT_EQ(*(int *)buf, i);
+    }
+
+    PfManager::close_file(fd);
+    PfManager::destroy_file(path);
+    system(("rm -rf " + wal_path).c_str());
+}
+
+TEST(PfPageTableTest, basic) {
+    srand((unsigned)time(nullptr));
+    // Page ids collided under the former hash (fd << 16) | page_no
+    EXPECT_NE(std::hash<PageId>()(PageId(0, 65536)), std::hash<PageId>()(PageId(1, 0)));
+
+    std::vector<Page> pages(10000);
+    std::unordered_map<PageId, Page *> mock;
+    PfPageTable table;
+    for (int round = 0; round < 100000; round++) {
+        Page *page = &pages[rand() % pages.size()];
+        if (mock.count(page->id) && mock.at(page->id) == page) {
+            // erase a resident page
+            EXPECT_TRUE(table.erase(page->id));
+            EXPECT_FALSE(table.erase(page->id));
+            mock.erase(page->id);
+        } else {
+            // insert a page with a random id, many of them beyond 65536 pages per file
+            PageId page_id(rand() % 4, rand() % 200000);
+            if (mock.count(page_id)) {
+                continue;
+            }
+            page->id = page_id;
+            table.insert(page);
+            mock[page_id] = page;
+        }
+        if (round % 1000 == 0) {
+            EXPECT_EQ(table.size(), mock.size());
+            EXPECT_LE(table.size() * 2, table.num_slots());
+            for (auto &entry : mock) {
+                EXPECT_EQ(table.find(entry.first), entry.second);
+            }
+            EXPECT_EQ(table.find(PageId(4, 0)), nullptr);
+            EXPECT_EQ(table.pages().size(), mock.size());
+        }
+    }
+    table.clear();
+    EXPECT_EQ(table.size(), 0u);
+    EXPECT_EQ(table.find(pages[0].id), nullptr);
+}
+
+// A buffer pool simulator driven by a replacer
+class MockPool {
+  public:
+    MockPool(PfPolicy policy, size_t capacity) : _pages(capacity), _replacer(PfReplacer::create(policy, capacity)) {
+        for (auto &page : _pages) {
+            _free_pages.push_back(&page);
+        }
+    }
+
+    // Access a page and return whether it hits the pool
+    bool access(const PageId &page_id) {
+        auto map_it = _busy_map.find(page_id);
+        if (map_it != _busy_map.end()) {
+            _replacer->access(map_it->second);
+            return true;
+        }
+        Page *page;
+        if (_free_pages.empty()) {
+            page = _replacer->victim();
+            _replacer->evict(page);
+            _busy_map.erase(page->id);
+        } else {
+            page = _free_pages.back();
+            _free_pages.pop_back();
+        }
+        page->id = page_id;
+        _busy_map[page_id] = page;
+        _replacer->insert(page);
+        return false;
+    }
+
+  private:
+    std::vector<Page> _pages;
+    std::vector<Page *> _free_pages;
+    std::unordered_map<PageId, Page *> _busy_map;
+    std::unique_ptr<PfReplacer> _replacer;
+};
+
+static int hot_hits_after_scan(PfPolicy policy) {
+    constexpr int POOL_SIZE = 1000;
+    constexpr int NUM_HOT = 100;
+    constexpr int HOT_FD = 0;
+    constexpr int COLD_FD = 1;
+    constexpr int SCAN_FD = 2;
+    MockPool pool(policy, POOL_SIZE);
+    // Warm up: repeatedly access the hot pages mixed with cold pages that are used only once
+    int cold_page_no = 0;
+    for (int round = 0; round < 20; round++) {
+        for (int i = 0; i < NUM_HOT; i++) {
+            pool.access({HOT_FD, i});
+        }
+        for (int i = 0; i < POOL_SIZE / 2; i++) {
+            pool.access({COLD_FD, cold_page_no++});
+        }
+    }
+    // A sequential scan over a table 10x larger than the pool
+    for (int i = 0; i < 10 * POOL_SIZE; i++) {
+        pool.access({SCAN_FD, i});
+    }
+    int hits = 0;
+    for (int i = 0; i < NUM_HOT; i++) {
+        hits += pool.access({HOT_FD, i});
+    }
+    return hits;
+}
+
+TEST(PfReplacerTest, scan_resistant) {
+    EXPECT_EQ(hot_hits_after_scan(POLICY_LRU), 0);
+    EXPECT_EQ(hot_hits_after_scan(POLICY_2Q), 100);
+}
+
+TEST(PfReplacerTest, two_queue) {
+    std::vector<Page> pages(8);
+    for (int i = 0; i < (int)pages.size(); i++) {
+        pages[i].id = PageId(0, i);
+    }
+    TwoQReplacer replacer(8);
+    // New pages go to A1in
+    for (int i = 0; i < 4; i++) {
+        replacer.insert(&pages[i]);
+    }
+    EXPECT_EQ(replacer.a1in_list().size(), 4u);
+    EXPECT_TRUE(replacer.am_list().empty());
+    // Re-reference in A1in does not promote the page
+    replacer.access(&pages[0]);
+    EXPECT_EQ(replacer.victim(), &pages[0]);
+    // Evicted A1in pages are remembered in A1out
+    replacer.evict(&pages[0]);
+    EXPECT_EQ(replacer.a1out_list().front(), pages[0].id);
+    // Page in A1out is promoted to Am when it is loaded again
+    replacer.insert(&pages[0]);
+    EXPECT_TRUE(replacer.a1out_list().empty());
+    EXPECT_EQ(replacer.am_list().front(), &pages[0]);
+    // A1in holds at most 2 pages, the oldest one in A1in is evicted first
+    EXPECT_EQ(replacer.victim(), &pages[1]);
+    // Eviction order goes on with Am and the rest of A1in
+    std::vector<Page *> order{&pages[1], &pages[0], &pages[2], &pages[3]};
+    EXPECT_EQ(replacer.eviction_order(8), order);
+    replacer.evict(&pages[1]);
+    replacer.evict(&pages[2]);
+    // Once A1in is small enough, evict from Am
+    EXPECT_EQ(replacer.victim(), &pages[0]);
+    // Pages leaving for another reason than eviction are forgotten, and come back to A1in
+    replacer.erase(&pages[3]);
+    EXPECT_EQ(replacer.a1out_list().size(), 2u);
+    replacer.insert(&pages[3]);
+    EXPECT_EQ(replacer.a1in_list().front(), &pages[3]);
+}
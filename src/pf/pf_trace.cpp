@@ -0,0 +1,106 @@
+#include "pf/pf_trace.h"
+#include <cstring>
+#include <fcntl.h>
+#include <fstream>
+#include <unistd.h>
+
+// The header is a single word: the magic in the low half and the format version in the high half
+static constexpr uint64_t TRACE_HEADER = 1ull << 32 | 0x52544252;
+static constexpr uint64_t TRACE_FILE_RECORD = 1ull << 63;
+static constexpr uint64_t TRACE_CREATE = 1ull << 47;
+static constexpr uint64_t TRACE_PAGE_MASK = TRACE_CREATE - 1;
+static constexpr int TRACE_MAX_FILES = 1 << 15;
+
+PfTrace::~PfTrace() {
+    if (is_open()) {
+        close();
+    }
+}
+
+void PfTrace::open(const std::string &path) {
+    if (is_open()) {
+        close();
+    }
+    _fd = ::open(path.c_str(), O_WRONLY | O_CREAT | O_TRUNC, S_IRUSR | S_IWUSR);
+    if (_fd < 0) {
+        throw UnixError();
+    }
+    _fd2file.clear();
+    _num_files = 0;
+    _num_accesses = 0;
+    _buf.clear();
+    _buf.push_back(TRACE_HEADER);
+}
+
+void PfTrace::close() {
+    flush();
+    if (::close(_fd) != 0) {
+        throw UnixError();
+    }
+    _fd = -1;
+}
+
+void PfTrace::add_file(int fd, const std::string &name) {
+    if (_num_files >= TRACE_MAX_FILES) {
+        throw InternalError("Too many files in page trace");
+    }
+    if ((size_t)fd >= _fd2file.size()) {
+        _fd2file.resize(fd + 1, -1);
+    }
+    _fd2file[fd] = _num_files++;
+    _buf.push_back(TRACE_FILE_RECORD | (uint64_t)name.size() << 32 | (uint64_t)_fd2file[fd]);
+    size_t begin = _buf.size();
+    _buf.resize(begin + (name.size() + sizeof(uint64_t) - 1) / sizeof(uint64_t), 0);
+    memcpy(&_buf[begin], name.data(), name.size());
+}
+
+void PfTrace::remove_file(int fd) {
+    if ((size_t)fd < _fd2file.size()) {
+        _fd2file[fd] = -1;
+    }
+}
+
+void PfTrace::flush() {
+    auto buf = (const uint8_t *)_buf.data();
+    size_t size = _buf.size() * sizeof(uint64_t);
+    while (size > 0) {
+        ssize_t bytes_write = write(_fd, buf, size);
+        if (bytes_write <= 0) {
+            throw UnixError();
+        }
+        buf += bytes_write;
+        size -= bytes_write;
+    }
+    _buf.clear();
+}
+
+void PfTrace::load(const std::string &path, std::vector<Access> &accesses, std::vector<std::string> &files) {
+    std::ifstream ifs(path, std::ios::binary);
+    if (!ifs) {
+        throw FileNotFoundError(path);
+    }
+    uint64_t word;
+    if (!ifs.read((char *)&word, sizeof(word)) || word != TRACE_HEADER) {
+        throw InvalidFileFormatError(path);
+    }
+    accesses.clear();
+    files.clear();
+    while (ifs.read((char *)&word, sizeof(word))) {
+        if (word & TRACE_FILE_RECORD) {
+            size_t id = word & 0xffffffff;
+            size_t len = (word >> 32) & 0xffff;
+            std::string name((len + sizeof(uint64_t) - 1) / sizeof(uint64_t) * sizeof(uint64_t), '\0');
+            if (id != files.size() || !ifs.read(&name[0], name.size())) {
+                throw InvalidFileFormatError(path);
+            }
+            name.resize(len);
+            files.push_back(name);
+        } else {
+            int file = word >> 48;
+            if ((size_t)file >= files.size()) {
+                throw InvalidFileFormatError(path);
+            }
+            accesses.push_back({file, (int64_t)(word & TRACE_PAGE_MASK), (word & TRACE_CREATE) != 0});
+        }
+    }
+}
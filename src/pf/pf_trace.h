@@ -0,0 +1,67 @@
+#pragma once
+
+#include "error.h"
+#include "pf/pf_defs.h"
+#include <string>
+#include <vector>
+
+// Trace of the page accesses of the pager, for sizing the buffer pool offline. Every page pinned by the pager is
+// appended to a binary file, which pfsim replays against pools of other sizes and policies.
+//
+// The file starts with a header, followed by little-endian 64-bit words. A file record has the top bit set, the
+// file id in the low 32 bits and the length of the file name in the next 16 bits, and is followed by the name
+// padded with zeros to whole words. Any other word is an access: the file id in bits 48-62, a create flag in bit 47
+// and the page number in bits 0-46. File ids are assigned in order from 0 as files are added, so a file opened
+// again, or a descriptor reused for another file, gets a new id.
+class PfTrace {
+  public:
+    // An access read back from a trace
+    struct Access {
+        int file;        // index into the file names of the trace
+        int64_t page_no;
+        bool create;     // the page was created rather than fetched, so a miss reads nothing
+    };
+
+    PfTrace() = default;
+    ~PfTrace();
+
+    PfTrace(const PfTrace &other) = delete;
+    PfTrace &operator=(const PfTrace &other) = delete;
+
+    // Start a new trace at the path, replacing any existing file.
+    void open(const std::string &path);
+    // Write the buffered accesses and close the trace.
+    void close();
+
+    bool is_open() const { return _fd >= 0; }
+
+    // Name the file opened as fd in the trace. Accesses to a file never named are traced as "fd<N>".
+    void add_file(int fd, const std::string &name);
+    void remove_file(int fd);
+
+    void record(int fd, int64_t page_no, bool create) {
+        if ((size_t)fd >= _fd2file.size() || _fd2file[fd] < 0) {
+            add_file(fd, "fd" + std::to_string(fd));
+        }
+        _buf.push_back((uint64_t)_fd2file[fd] << 48 | (uint64_t)create << 47 | (uint64_t)page_no);
+        _num_accesses++;
+        if (_buf.size() * sizeof(uint64_t) >= PF_TRACE_BUFFER_SIZE) {
+            flush();
+        }
+    }
+
+    // Number of accesses traced since the trace was opened
+    size_t num_accesses() const { return _num_accesses; }
+
+    // Read a whole trace file.
+    static void load(const std::string &path, std::vector<Access> &accesses, std::vector<std::string> &files);
+
+  private:
+    void flush();
+
+    int _fd = -1;
+    std::vector<int> _fd2file; // fd -> id of the file in the trace, -1 if not named yet
+    int _num_files = 0;
+    size_t _num_accesses = 0;
+    std::vector<uint64_t> _buf;
+};
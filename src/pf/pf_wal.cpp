@@ -0,0 +1,530 @@
+#include "pf/pf_wal.h"
+#include <cassert>
+#include <cerrno>
+#include <algorithm>
+#include <chrono>
+#include <cinttypes>
+#include <cstdio>
+#include <dirent.h>
+#include <fcntl.h>
+#include <limits.h>
+#include <sys/stat.h>
+#include <unistd.h>
+
+static const std::string WAL_CONTROL_NAME = "control";
+static constexpr uint32_t WAL_CONTROL_MAGIC = 0x4c415752;
+
+// Content of the control file
+struct WalControl {
+    uint32_t magic;
+    uint32_t checksum; // CRC-32 of redo_lsn
+    int64_t redo_lsn;
+};
+
+// Write the whole buffer at the offset. Return false on error with errno set.
+static bool pwrite_all(int fd, const uint8_t *buf, size_t size, off_t offset) {
+    while (size > 0) {
+        ssize_t bytes_write = pwrite(fd, buf, size, offset);
+        if (bytes_write <= 0) {
+            return false;
+        }
+        buf += bytes_write;
+        size -= bytes_write;
+        offset += bytes_write;
+    }
+    return true;
+}
+
+static uint32_t crc32(uint32_t crc, const void *data, size_t size) {
+    static const auto table = [] {
+        std::vector<uint32_t> t(256);
+        for (uint32_t i = 0; i < 256; i++) {
+            uint32_t c = i;
+            for (int k = 0; k < 8; k++) {
+                c = (c & 1) ? 0xedb88320u ^ (c >> 1) : c >> 1;
+            }
+            t[i] = c;
+        }
+        return t;
+    }();
+    auto p = (const uint8_t *)data;
+    crc = ~crc;
+    for (size_t i = 0; i < size; i++) {
+        crc = table[(crc ^ p[i]) & 0xff] ^ (crc >> 8);
+    }
+    return ~crc;
+}
+
+// Absolute form of the path, with "." and ".." resolved lexically
+static std::string absolute_path(const std::string &path) {
+    std::string full = path;
+    if (path.empty() || path[0] != '/') {
+        char cwd[PATH_MAX];
+        if (getcwd(cwd, sizeof(cwd)) == nullptr) {
+            throw UnixError();
+        }
+        full = std::string(cwd) + "/" + path;
+    }
+    std::vector<std::string> parts;
+    size_t begin = 0;
+    while (begin <= full.size()) {
+        size_t end = std::min(full.find('/', begin), full.size());
+        std::string part = full.substr(begin, end - begin);
+        if (part == "..") {
+            if (!parts.empty()) {
+                parts.pop_back();
+            }
+        } else if (!part.empty() && part != ".") {
+            parts.push_back(part);
+        }
+        begin = end + 1;
+    }
+    std::string result;
+    for (auto &part : parts) {
+        result += "/" + part;
+    }
+    return result.empty() ? "/" : result;
+}
+
+// Directory against which the records of the log at the path name the data files: the one holding the log
+static std::string base_dir(const std::string &path) {
+    std::string log_dir = absolute_path(path);
+    size_t pos = log_dir.rfind('/');
+    return pos == 0 ? "/" : log_dir.substr(0, pos);
+}
+
+// Start LSNs of the segments in the log directory in ascending order
+static std::vector<int64_t> list_segments(const std::string &path) {
+    std::vector<int64_t> segments;
+    DIR *dir = opendir(path.c_str());
+    if (dir == nullptr) {
+        throw UnixError();
+    }
+    while (dirent *entry = readdir(dir)) {
+        uint64_t lsn;
+        int len;
+        if (sscanf(entry->d_name, "%16" SCNx64 "%n", &lsn, &len) == 1 && len == 16 && entry->d_name[len] == '\0') {
+            segments.push_back((int64_t)lsn);
+        }
+    }
+    closedir(dir);
+    std::sort(segments.begin(), segments.end());
+    return segments;
+}
+
+// Make the creation, renaming and removal of files in the directory durable
+static void sync_dir(const std::string &path) {
+    int fd = ::open(path.c_str(), O_RDONLY | O_DIRECTORY);
+    if (fd < 0) {
+        throw UnixError();
+    }
+    int ret = fsync(fd);
+    ::close(fd);
+    if (ret != 0) {
+        throw UnixError();
+    }
+}
+
+// Read the redo point from the control file. Return 0 if there is no control file.
+static int64_t read_control(const std::string &path) {
+    std::string ctl_path = path + "/" + WAL_CONTROL_NAME;
+    int fd = ::open(ctl_path.c_str(), O_RDONLY);
+    if (fd < 0) {
+        if (errno == ENOENT) {
+            return 0;
+        }
+        throw UnixError();
+    }
+    WalControl ctl;
+    ssize_t bytes_read = pread(fd, &ctl, sizeof(ctl), 0);
+    ::close(fd);
+    if (bytes_read != sizeof(ctl) || ctl.magic != WAL_CONTROL_MAGIC ||
+        ctl.checksum != crc32(0, &ctl.redo_lsn, sizeof(ctl.redo_lsn))) {
+        throw InvalidFileFormatError(ctl_path);
+    }
+    return ctl.redo_lsn;
+}
+
+// Replace the control file atomically, so that a crash leaves either the old or the new redo point
+static void write_control(const std::string &path, int64_t redo_lsn) {
+    std::string ctl_path = path + "/" + WAL_CONTROL_NAME;
+    std::string tmp_path = ctl_path + ".tmp";
+    WalControl ctl{WAL_CONTROL_MAGIC, crc32(0, &redo_lsn, sizeof(redo_lsn)), redo_lsn};
+    int fd = ::open(tmp_path.c_str(), O_WRONLY | O_CREAT | O_TRUNC, S_IRUSR | S_IWUSR);
+    if (fd < 0) {
+        throw UnixError();
+    }
+    bool ok = pwrite_all(fd, (const uint8_t *)&ctl, sizeof(ctl), 0) && fdatasync(fd) == 0;
+    if (::close(fd) != 0 || !ok || rename(tmp_path.c_str(), ctl_path.c_str()) != 0) {
+        throw UnixError();
+    }
+    sync_dir(path);
+}
+
+// Create an empty segment starting at the LSN and open it for writing
+static int create_segment(const std::string &path, int64_t start_lsn) {
+    int fd = ::open(PfWal::segment_path(path, start_lsn).c_str(), O_RDWR | O_CREAT | O_TRUNC, S_IRUSR | S_IWUSR);
+    if (fd < 0) {
+        throw UnixError();
+    }
+    sync_dir(path);
+    return fd;
+}
+
+PfWal::~PfWal() { close(); }
+
+std::string PfWal::segment_path(const std::string &path, int64_t start_lsn) {
+    char name[32];
+    snprintf(name, sizeof(name), "%016" PRIx64, start_lsn);
+    return path + "/" + name;
+}
+
+uint32_t PfWal::checksum(const RecordHdr &hdr, const char *name, const uint8_t *image) {
+    uint32_t crc = crc32(0, (const uint8_t *)&hdr + sizeof(hdr.checksum), sizeof(hdr) - sizeof(hdr.checksum));
+    crc = crc32(crc, name, hdr.name_len);
+    if (hdr.type != RECORD_COMMIT) {
+        crc = crc32(crc, image, PAGE_SIZE);
+    }
+    return crc;
+}
+
+void PfWal::open(const std::string &path) {
+    assert(!is_open());
+    if (mkdir(path.c_str(), S_IRWXU) != 0 && errno != EEXIST) {
+        throw UnixError();
+    }
+    int64_t redo_lsn = read_control(path);
+    std::vector<int64_t> segments = list_segments(path);
+    int fd;
+    int64_t end_lsn;
+    if (segments.empty()) {
+        // A new log, or one emptied by recovery. LSNs continue from the redo point.
+        end_lsn = redo_lsn;
+        fd = create_segment(path, end_lsn);
+        segments.push_back(end_lsn);
+    } else {
+        // Append to the last segment
+        fd = ::open(segment_path(path, segments.back()).c_str(), O_RDWR);
+        if (fd < 0) {
+            throw UnixError();
+        }
+        off_t size = lseek(fd, 0, SEEK_END);
+        if (size < 0) {
+            ::close(fd);
+            throw UnixError();
+        }
+        end_lsn = segments.back() + size;
+    }
+    std::lock_guard<std::mutex> lock(_mutex);
+    _path = path;
+    _base = base_dir(path);
+    _fd = fd;
+    _segments = std::move(segments);
+    _redo_lsn = redo_lsn;
+    _written_lsn = _durable_lsn = _end_lsn = end_lsn;
+    if (_durability == DURABILITY_ASYNC) {
+        _stop = false;
+        _syncer = std::thread(&PfWal::syncer, this);
+    }
+}
+
+void PfWal::close() {
+    if (!is_open()) {
+        return;
+    }
+    if (_syncer.joinable()) {
+        {
+            std::lock_guard<std::mutex> lock(_mutex);
+            _stop = true;
+        }
+        _stop_cv.notify_all();
+        _syncer.join();
+    }
+    flush();
+    std::lock_guard<std::mutex> lock(_mutex);
+    if (::close(_fd) != 0) {
+        throw UnixError();
+    }
+    _fd = -1;
+    _segments.clear();
+}
+
+void PfWal::add_file(int fd, const std::string &path) {
+    std::string abs_path = absolute_path(path);
+    std::lock_guard<std::mutex> lock(_mutex);
+    _files[fd] = std::move(abs_path);
+}
+
+void PfWal::remove_file(int fd) {
+    std::lock_guard<std::mutex> lock(_mutex);
+    _files.erase(fd);
+}
+
+int64_t PfWal::append_page(RecordType type, const PageId &page_id, const uint8_t *image) {
+    std::lock_guard<std::mutex> lock(_mutex);
+    assert(_fd >= 0);
+    auto it = _files.find(page_id.fd);
+    if (it == _files.end()) {
+        throw InternalError("Logging a page of an unknown file");
+    }
+    // Name files under the base directory relative to it, and other files by their absolute path
+    const std::string &path = it->second;
+    size_t offset = 0;
+    if (_base == "/") {
+        offset = 1;
+    } else if (path.size() > _base.size() && path.compare(0, _base.size(), _base) == 0 && path[_base.size()] == '/') {
+        offset = _base.size() + 1;
+    }
+    RecordHdr hdr{0, type, (uint16_t)(path.size() - offset), page_id.page_no};
+    append(hdr, path.c_str() + offset, image);
+    return _end_lsn;
+}
+
+void PfWal::commit() {
+    int64_t lsn;
+    {
+        std::lock_guard<std::mutex> lock(_mutex);
+        RecordHdr hdr{0, RECORD_COMMIT, 0, 0};
+        append(hdr, nullptr, nullptr);
+        lsn = _end_lsn;
+    }
+    if (_durability == DURABILITY_SYNC) {
+        flush(lsn);
+    }
+}
+
+void PfWal::append(const RecordHdr &hdr, const char *name, const uint8_t *image) {
+    RecordHdr full = hdr;
+    full.checksum = checksum(hdr, name, image);
+    size_t old_size = _buffer.size();
+    _buffer.insert(_buffer.end(), (const uint8_t *)&full, (const uint8_t *)&full + sizeof(full));
+    _buffer.insert(_buffer.end(), (const uint8_t *)name, (const uint8_t *)name + hdr.name_len);
+    if (hdr.type != RECORD_COMMIT) {
+        _buffer.insert(_buffer.end(), image, image + PAGE_SIZE);
+    }
+    _end_lsn += _buffer.size() - old_size;
+    // Bound the memory held by a long statement. While a flush is running, the buffer is written by the next one.
+    if (_buffer.size() >= PF_WAL_BUFFER_SIZE && !_flushing) {
+        write_buffer();
+    }
+}
+
+void PfWal::write_buffer() {
+    if (!pwrite_all(_fd, _buffer.data(), _buffer.size(), _written_lsn - _segments.back())) {
+        throw UnixError();
+    }
+    _written_lsn += _buffer.size();
+    _buffer.clear();
+    if (_written_lsn - _segments.back() >= _segment_size) {
+        rotate();
+    }
+}
+
+void PfWal::rotate() {
+    // Records never span segments, since a buffer is always written to a single one
+    if (fdatasync(_fd) != 0) {
+        throw UnixError();
+    }
+    _durable_lsn = std::max(_durable_lsn, _written_lsn);
+    int fd = create_segment(_path, _written_lsn);
+    ::close(_fd);
+    _fd = fd;
+    _segments.push_back(_written_lsn);
+}
+
+void PfWal::flush(int64_t lsn) {
+    std::unique_lock<std::mutex> lock(_mutex);
+    while (_durable_lsn < lsn) {
+        if (_flushing) {
+            // Another thread is syncing. Its sync may cover this LSN as well.
+            _flush_cv.wait(lock);
+            continue;
+        }
+        // Become the leader and sync everything appended so far, including the records of the waiting threads
+        _flushing = true;
+        std::vector<uint8_t> buf;
+        buf.swap(_buffer);
+        off_t offset = _written_lsn - _segments.back();
+        int64_t end = _written_lsn + buf.size();
+        lock.unlock();
+        bool ok = pwrite_all(_fd, buf.data(), buf.size(), offset) && fdatasync(_fd) == 0;
+        int err = errno;
+        lock.lock();
+        _flushing = false;
+        _flush_cv.notify_all();
+        if (!ok) {
+            // Put the records back so that the next flush retries them
+            _buffer.insert(_buffer.begin(), buf.begin(), buf.end());
+            errno = err;
+            throw UnixError();
+        }
+        _written_lsn = _durable_lsn = end;
+        _num_syncs++;
+        if (_written_lsn - _segments.back() >= _segment_size) {
+            rotate();
+        }
+    }
+}
+
+void PfWal::checkpoint(int64_t redo_lsn) {
+    std::unique_lock<std::mutex> lock(_mutex);
+    _flush_cv.wait(lock, [this] { return !_flushing; });
+    if (redo_lsn <= _redo_lsn) {
+        return;
+    }
+    write_control(_path, redo_lsn);
+    _redo_lsn = redo_lsn;
+    // A segment is obsolete once the next one starts at or before the redo point
+    size_t num_obsolete = 0;
+    while (num_obsolete + 1 < _segments.size() && _segments[num_obsolete + 1] <= redo_lsn) {
+        if (unlink(segment_path(_path, _segments[num_obsolete]).c_str()) != 0) {
+            throw UnixError();
+        }
+        num_obsolete++;
+    }
+    _segments.erase(_segments.begin(), _segments.begin() + num_obsolete);
+}
+
+void PfWal::syncer() {
+    std::unique_lock<std::mutex> lock(_mutex);
+    while (!_stop) {
+        _stop_cv.wait_for(lock, std::chrono::milliseconds(_sync_interval_ms), [this] { return _stop; });
+        int64_t lsn = _end_lsn;
+        lock.unlock();
+        try {
+            flush(lsn);
+        } catch (UnixError &) {
+            // Retried in the next period. A commit or write-back that needs the records fails by itself.
+        }
+        lock.lock();
+    }
+}
+
+size_t PfWal::recover(const std::string &path) {
+    struct stat st;
+    if (stat(path.c_str(), &st) != 0) {
+        if (errno == ENOENT) {
+            return 0;
+        }
+        throw UnixError();
+    }
+    int64_t redo_lsn = read_control(path);
+    std::vector<int64_t> segments = list_segments(path);
+    // Skip the segments that end before the redo point
+    while (segments.size() > 1 && segments[1] <= redo_lsn) {
+        segments.erase(segments.begin());
+    }
+    std::vector<int> fds;
+    for (int64_t start_lsn : segments) {
+        int fd = ::open(segment_path(path, start_lsn).c_str(), O_RDONLY);
+        if (fd < 0) {
+            throw UnixError();
+        }
+        fds.push_back(fd);
+    }
+    // Read the record at the LSN. Return its size, or 0 if it is torn or beyond the end of the log.
+    RecordHdr hdr;
+    char name[PAGE_SIZE];
+    std::vector<uint8_t> image(PAGE_SIZE);
+    auto read_record = [&](int64_t lsn) -> size_t {
+        // Find the segment holding the LSN. Records never span segments, and each segment starts where the
+        // previous one ends.
+        auto it = std::upper_bound(segments.begin(), segments.end(), lsn);
+        if (it == segments.begin()) {
+            return 0;
+        }
+        int fd = fds[it - segments.begin() - 1];
+        off_t offset = lsn - *(it - 1);
+        if (pread(fd, &hdr, sizeof(hdr), offset) != sizeof(hdr)) {
+            return 0;
+        }
+        if ((hdr.type != RECORD_PAGE && hdr.type != RECORD_COMMIT && hdr.type != RECORD_UNDO) ||
+            hdr.name_len >= sizeof(name)) {
+            return 0;
+        }
+        size_t size = sizeof(hdr);
+        if (pread(fd, name, hdr.name_len, offset + size) != hdr.name_len) {
+            return 0;
+        }
+        name[hdr.name_len] = '\0';
+        size += hdr.name_len;
+        if (hdr.type != RECORD_COMMIT) {
+            if (pread(fd, image.data(), PAGE_SIZE, offset + size) != PAGE_SIZE) {
+                return 0;
+            }
+            size += PAGE_SIZE;
+        }
+        return checksum(hdr, name, image.data()) == hdr.checksum ? size : 0;
+    };
+    // Find the end of the last committed statement
+    int64_t begin_lsn = segments.empty() ? redo_lsn : std::max(redo_lsn, segments.front());
+    int64_t committed_end = begin_lsn;
+    std::vector<int64_t> undo_lsns;
+    int64_t lsn = begin_lsn;
+    while (size_t size = read_record(lsn)) {
+        if (hdr.type == RECORD_UNDO) {
+            undo_lsns.push_back(lsn);
+        }
+        lsn += size;
+        if (hdr.type == RECORD_COMMIT) {
+            committed_end = lsn;
+        }
+    }
+    int64_t end_lsn = lsn;
+    // Write the image of the record just read into its data file. Return false if the file no longer exists.
+    std::unordered_map<std::string, int> files; // path -> fd, -1 if the file is gone
+    std::string base = base_dir(path);
+    auto write_image = [&]() -> bool {
+        auto it = files.find(name);
+        if (it == files.end()) {
+            std::string data_path = name[0] == '/' ? name : base + "/" + name;
+            int data_fd = ::open(data_path.c_str(), O_WRONLY);
+            if (data_fd < 0 && errno != ENOENT) {
+                throw UnixError();
+            }
+            it = files.emplace(name, data_fd).first;
+        }
+        if (it->second < 0) {
+            // The file was dropped after the record
+            return false;
+        }
+        if (!pwrite_all(it->second, image.data(), PAGE_SIZE, (off_t)hdr.page_no * PAGE_SIZE)) {
+            throw UnixError();
+        }
+        return true;
+    };
+    // Undo the statements that did not commit. Their undo records are applied latest first, so each page gets back
+    // the image it had before the first of them wrote it.
+    for (auto it = undo_lsns.rbegin(); it != undo_lsns.rend() && *it >= committed_end; it++) {
+        read_record(*it);
+        write_image();
+    }
+    // Redo the committed page images in log order. A page written by an uncommitted statement after being changed by
+    // a committed one is restored to its committed image here.
+    size_t num_pages = 0;
+    lsn = begin_lsn;
+    while (lsn < committed_end) {
+        lsn += read_record(lsn);
+        if (hdr.type == RECORD_PAGE && write_image()) {
+            num_pages++;
+        }
+    }
+    for (auto &entry : files) {
+        if (entry.second >= 0 && (fdatasync(entry.second) != 0 || ::close(entry.second) != 0)) {
+            throw UnixError();
+        }
+    }
+    for (int fd : fds) {
+        ::close(fd);
+    }
+    // Every committed change is in the data files now. Move the redo point past the whole log before removing
+    // the segments, so that LSNs keep growing.
+    write_control(path, std::max(end_lsn, redo_lsn));
+    for (int64_t start_lsn : list_segments(path)) {
+        if (unlink(segment_path(path, start_lsn).c_str()) != 0) {
+            throw UnixError();
+        }
+    }
+    sync_dir(path);
+    return num_pages;
+}
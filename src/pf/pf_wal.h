@@ -0,0 +1,162 @@
+#pragma once
+
+#include "error.h"
+#include "pf/pf_defs.h"
+#include <condition_variable>
+#include <mutex>
+#include <string>
+#include <thread>
+#include <unordered_map>
+#include <vector>
+
+// Write-ahead log of page images. The pager logs the image of every page changed by a statement when the
+// statement commits, or earlier if the page is written back before that. Before a statement first writes a
+// changed page back, the image the page has on disk is logged as well. Recovery copies the images of committed
+// statements into the data files and puts back the disk images saved by statements that did not commit, so after
+// a crash the data files hold exactly the committed changes, even if pages of a committed statement never reached
+// disk or pages of an uncommitted one did.
+//
+// Commits are grouped: a thread waiting for its commit record to become durable syncs all records appended so
+// far, so concurrent commits share one fdatasync. All methods are thread safe.
+//
+// Log sequence numbers (LSN) are byte positions in the log since it was created. The log is a directory of
+// segment files named by the LSN of their first record, plus a control file holding the redo point: the LSN from
+// which recovery replays the log. A checkpoint moves the redo point forward once the data files hold every change
+// logged before it, and deletes the segments that end before it, so recovery time and log size stay bounded.
+//
+// Records name the data files relative to the directory holding the log, so recovery does not depend on the
+// working directory.
+class PfWal {
+  public:
+    PfWal() = default;
+    ~PfWal();
+
+    PfWal(const PfWal &other) = delete;
+    PfWal &operator=(const PfWal &other) = delete;
+
+    // Set the durability mode and the sync period of async mode. Takes effect on the next open.
+    void set_durability(PfDurability durability, int sync_interval_ms = PF_WAL_SYNC_INTERVAL_MS) {
+        _durability = durability;
+        _sync_interval_ms = sync_interval_ms;
+    }
+
+    PfDurability durability() const { return _durability; }
+    int sync_interval_ms() const { return _sync_interval_ms; }
+
+    // Set the size at which a new segment is started. Takes effect on the next open.
+    void set_segment_size(int64_t size) { _segment_size = size; }
+
+    // Open or create the log directory and append to it. Recover the log first, since records already in it are
+    // kept.
+    void open(const std::string &path);
+    // Make all records durable and close the log.
+    void close();
+
+    bool is_open() const { return _fd >= 0; }
+
+    // Name the data file opened as fd in the records of its pages
+    void add_file(int fd, const std::string &path);
+    void remove_file(int fd);
+
+    // Append the image of the page. Return the LSN after the record.
+    int64_t log_page(const Page *page) { return append_page(RECORD_PAGE, page->id, page->buf); }
+
+    // Append the image of the page on disk before the open statement changed it, to be put back if the statement
+    // does not commit. Return the LSN after the record.
+    int64_t log_undo(const PageId &page_id, const uint8_t *image) { return append_page(RECORD_UNDO, page_id, image); }
+
+    // Append a commit record. In sync mode, wait until all records up to it are durable.
+    void commit();
+
+    // Wait until all records up to the LSN are durable.
+    void flush(int64_t lsn);
+    // Wait until all records appended so far are durable.
+    void flush() { flush(end_lsn()); }
+
+    // Move the redo point forward to the LSN and delete the segments before it. The data files must hold every
+    // change logged before the LSN on disk.
+    void checkpoint(int64_t redo_lsn);
+
+    // LSN after the last appended record
+    int64_t end_lsn() const {
+        std::lock_guard<std::mutex> lock(_mutex);
+        return _end_lsn;
+    }
+
+    // LSN from which recovery would replay the log
+    int64_t redo_lsn() const {
+        std::lock_guard<std::mutex> lock(_mutex);
+        return _redo_lsn;
+    }
+
+    // Number of segment files in the log
+    size_t num_segments() const {
+        std::lock_guard<std::mutex> lock(_mutex);
+        return _segments.size();
+    }
+
+    // Number of fdatasync calls on the log
+    size_t num_syncs() const {
+        std::lock_guard<std::mutex> lock(_mutex);
+        return _num_syncs;
+    }
+
+    // Put back the disk images of pages written by statements that did not commit, copy the page images of
+    // committed statements after the redo point into the data files, sync them, and empty the log. Records of
+    // files that no longer exist are skipped. Return the number of committed page images restored.
+    static size_t recover(const std::string &path);
+
+    // Path of the segment starting at the LSN in the log directory
+    static std::string segment_path(const std::string &path, int64_t start_lsn);
+
+  private:
+    enum RecordType : uint16_t { RECORD_PAGE = 1, RECORD_COMMIT = 2, RECORD_UNDO = 3 };
+
+    // Header of a log record. A page or undo record is followed by the file name and the page image.
+    struct RecordHdr {
+        uint32_t checksum; // CRC-32 of the rest of the record, detects records torn by a crash
+        uint16_t type;
+        uint16_t name_len;
+        int64_t page_no;
+    };
+
+    static uint32_t checksum(const RecordHdr &hdr, const char *name, const uint8_t *image);
+
+    // Append a record of the image of a page. Return the LSN after the record.
+    int64_t append_page(RecordType type, const PageId &page_id, const uint8_t *image);
+
+    // Append a record to the buffer. Must hold the lock.
+    void append(const RecordHdr &hdr, const char *name, const uint8_t *image);
+
+    // Write the buffer to the current segment. Must hold the lock and not be flushing.
+    void write_buffer();
+
+    // Sync the current segment and start a new one at the written LSN. Must hold the lock and not be flushing.
+    void rotate();
+
+    void syncer();
+
+  private:
+    PfDurability _durability = DURABILITY_SYNC;
+    int _sync_interval_ms = PF_WAL_SYNC_INTERVAL_MS;
+    int64_t _segment_size = PF_WAL_SEGMENT_SIZE;
+    std::string _path;                           // log directory
+    std::string _base;                           // absolute path of the directory holding the log
+    int _fd = -1;                                // current segment
+    std::unordered_map<int, std::string> _files; // fd -> absolute path of data files
+
+    mutable std::mutex _mutex;
+    std::condition_variable _flush_cv;
+    std::vector<uint8_t> _buffer;   // records not written to the file yet
+    std::vector<int64_t> _segments; // start LSNs of the segments in ascending order, the last one is current
+    int64_t _redo_lsn = 0;          // redo point in the control file
+    int64_t _written_lsn = 0;       // records before this are in the file
+    int64_t _durable_lsn = 0;       // records before this are synced
+    int64_t _end_lsn = 0;           // records before this are appended
+    bool _flushing = false;         // a thread is writing and syncing the log
+    size_t _num_syncs = 0;
+
+    std::thread _syncer; // periodic syncs in async mode
+    std::condition_variable _stop_cv;
+    bool _stop = false;
+};
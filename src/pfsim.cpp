@@ -0,0 +1,176 @@
+#include "options.h"
+#include <algorithm>
+#include <cstdio>
+
+// Offline buffer pool simulator. Replays a page access trace recorded with --trace against pools of several sizes
+// and prints the miss ratio of each replacement policy, to choose a pool size and policy for the workload.
+//
+// The LRU curve comes from the stack distances of the accesses (Mattson et al., 1970), which give the hits of an
+// LRU pool of every size in a single pass. The other policies are replayed once per size through the replacers of
+// the pager. A miss is a fetch of a page that is not cached; creating a page never reads it, so creations count
+// neither as hits nor as misses, but they still occupy frames. Readahead, pinned and reserved pages are ignored.
+
+// Binary indexed tree over the time of the accesses, holding 1 at the time of the latest access to each page
+class Fenwick {
+  public:
+    Fenwick(size_t n) : _tree(n + 1) {}
+
+    void add(size_t i, int delta) {
+        for (i++; i < _tree.size(); i += i & -i) {
+            _tree[i] += delta;
+        }
+    }
+
+    // Sum of [0, i)
+    int64_t prefix(size_t i) const {
+        int64_t sum = 0;
+        for (; i > 0; i -= i & -i) {
+            sum += _tree[i];
+        }
+        return sum;
+    }
+
+  private:
+    std::vector<int64_t> _tree;
+};
+
+// Number of fetches hitting an LRU pool at each stack depth: a fetch at depth d hits any pool of more than d pages.
+static std::vector<uint64_t> lru_depths(const std::vector<PfTrace::Access> &accesses) {
+    std::vector<uint64_t> depths;
+    std::unordered_map<PageId, size_t> last_access;
+    Fenwick recent(accesses.size());
+    for (size_t t = 0; t < accesses.size(); t++) {
+        const PfTrace::Access &access = accesses[t];
+        auto it = last_access.emplace(PageId(access.file, access.page_no), t);
+        if (!it.second) {
+            size_t prev = it.first->second;
+            // Distinct pages accessed since the previous access to this page
+            size_t depth = recent.prefix(t) - recent.prefix(prev + 1);
+            if (!access.create) {
+                if (depth >= depths.size()) {
+                    depths.resize(depth + 1);
+                }
+                depths[depth]++;
+            }
+            recent.add(prev, -1);
+            it.first->second = t;
+        }
+        recent.add(t, 1);
+    }
+    return depths;
+}
+
+// Number of misses of a pool of the given size under the policy
+static uint64_t replay(PfPolicy policy, size_t capacity, const std::vector<PfTrace::Access> &accesses) {
+    auto replacer = PfReplacer::create(policy, capacity);
+    std::unique_ptr<Page[]> frames(new Page[capacity]());
+    size_t num_frames = 0;
+    std::unordered_map<PageId, Page *> cached;
+    uint64_t misses = 0;
+    for (const PfTrace::Access &access : accesses) {
+        PageId page_id(access.file, access.page_no);
+        auto it = cached.find(page_id);
+        if (it != cached.end()) {
+            replacer->access(it->second);
+            continue;
+        }
+        if (!access.create) {
+            misses++;
+        }
+        Page *page;
+        if (num_frames < capacity) {
+            page = &frames[num_frames++];
+        } else {
+            page = replacer->victim();
+            replacer->evict(page);
+            cached.erase(page->id);
+        }
+        page->id = page_id;
+        replacer->insert(page);
+        cached.emplace(page_id, page);
+    }
+    return misses;
+}
+
+static void print_usage(const char *prog) {
+    std::cerr << "Usage: " << prog << " <trace> [SIZE...]\n"
+              << "Print the miss ratio of every replacement policy for buffer pools of the given sizes, in bytes\n"
+              << "with optional K/M/G suffix. By default, sizes double from " << PF_MIN_CACHE_PAGES * PAGE_SIZE / 1024
+              << "K until the pool holds every page of the trace.\n";
+}
+
+int main(int argc, char **argv) {
+    if (argc < 2) {
+        print_usage(argv[0]);
+        exit(1);
+    }
+    std::vector<size_t> sizes;
+    for (int i = 2; i < argc; i++) {
+        unsigned long long bytes;
+        if (!Options::parse_bytes(argv[i], bytes) || bytes / PAGE_SIZE == 0) {
+            print_usage(argv[0]);
+            exit(1);
+        }
+        sizes.push_back(bytes / PAGE_SIZE);
+    }
+    std::vector<PfTrace::Access> accesses;
+    std::vector<std::string> files;
+    try {
+        PfTrace::load(argv[1], accesses, files);
+    } catch (RedBaseError &e) {
+        std::cerr << e.what() << std::endl;
+        exit(1);
+    }
+
+    // Accesses and distinct pages of each file
+    std::vector<uint64_t> file_accesses(files.size());
+    std::vector<std::unordered_set<int64_t>> file_pages(files.size());
+    uint64_t num_fetches = 0;
+    for (const PfTrace::Access &access : accesses) {
+        file_accesses[access.file]++;
+        file_pages[access.file].insert(access.page_no);
+        num_fetches += !access.create;
+    }
+    size_t num_pages = 0;
+    printf("%-32s %12s %12s\n", "File", "Accesses", "Pages");
+    for (size_t i = 0; i < files.size(); i++) {
+        printf("%-32s %12llu %12zu\n", files[i].c_str(), (unsigned long long)file_accesses[i], file_pages[i].size());
+        num_pages += file_pages[i].size();
+    }
+    printf("%zu accesses, %llu fetches, %zu distinct pages (%.1f MiB)\n\n", accesses.size(),
+           (unsigned long long)num_fetches, num_pages, (double)num_pages * PAGE_SIZE / (1 << 20));
+    if (num_fetches == 0) {
+        return 0;
+    }
+
+    if (sizes.empty()) {
+        for (size_t size = PF_MIN_CACHE_PAGES;; size *= 2) {
+            sizes.push_back(size);
+            if (size >= num_pages) {
+                break;
+            }
+        }
+    }
+    std::sort(sizes.begin(), sizes.end());
+    std::vector<uint64_t> depths = lru_depths(accesses);
+    std::vector<PfPolicy> policies = {POLICY_LRU, POLICY_2Q};
+    printf("%12s %10s", "Pool MiB", "Pages");
+    for (PfPolicy policy : policies) {
+        printf(" %9s", (policy2str(policy) + " miss%").c_str());
+    }
+    printf("\n");
+    size_t depth = 0;
+    uint64_t lru_hits = 0;
+    for (size_t size : sizes) {
+        for (; depth < size && depth < depths.size(); depth++) {
+            lru_hits += depths[depth];
+        }
+        printf("%12.2f %10zu", (double)size * PAGE_SIZE / (1 << 20), size);
+        for (PfPolicy policy : policies) {
+            uint64_t misses = policy == POLICY_LRU ? num_fetches - lru_hits : replay(policy, size, accesses);
+            printf(" %9.2f", 100.0 * misses / num_fetches);
+        }
+        printf("\n");
+    }
+    return 0;
+}
@@ -77,7 +77,7 @@ void QlManager::insert_into(const std::string &tab_name, std::vector<Value> valu
     // Get record file handle
     auto fh = SmManager::fhs.at(tab_name).get();
     // Make record buffer
-    RmRecord rec(fh->hdr.record_size);
+    RmRecord rec(tab.row_size());
     for (size_t i = 0; i < values.size(); i++) {
         auto &col = tab.cols[i];
         auto &val = values[i];
@@ -88,7 +88,13 @@ void QlManager::insert_into(const std::string &tab_name, std::vector<Value> valu
         memcpy(rec.data + col.offset, val.raw->data, col.len);
     }
     // Insert into record file
-    Rid rid = fh->insert_record(rec.data);
+    Rid rid;
+    if (tab.is_packed()) {
+        std::vector<uint8_t> packed(fh->hdr.record_size);
+        rid = fh->insert_record(packed.data(), tab.pack(rec.data, packed.data()));
+    } else {
+        rid = fh->insert_record(rec.data);
+    }
     // Insert into index
     for (size_t i = 0; i < tab.cols.size(); i++) {
         auto &col = tab.cols[i];
@@ -97,6 +103,8 @@ void QlManager::insert_into(const std::string &tab_name, std::vector<Value> valu
             ih->insert_entry(rec.data + col.offset, rid);
         }
     }
+    // Make the statement durable
+    PfManager::pager.commit();
 }
 
 void QlManager::delete_from(const std::string &tab_name, std::vector<Condition> conds) {
@@ -119,17 +127,25 @@ void QlManager::delete_from(const std::string &tab_name, std::vector<Condition>
         }
     }
     // Delete each rid from record file and index file
+    RmRecord row(tab.row_size());
     for (auto &rid : rids) {
         auto rec = fh->get_record(rid);
+        if (tab.is_packed()) {
+            tab.unpack(rec->data, row.data);
+        } else {
+            memcpy(row.data, rec->data, row.size);
+        }
         // Delete from index file
         for (size_t col_i = 0; col_i < tab.cols.size(); col_i++) {
             if (ihs[col_i] != nullptr) {
-                ihs[col_i]->delete_entry(rec->data + tab.cols[col_i].offset, rid);
+                ihs[col_i]->delete_entry(row.data + tab.cols[col_i].offset, rid);
             }
         }
         // Delete from record file
         fh->delete_record(rid);
     }
+    // Make the statement durable
+    PfManager::pager.commit();
 }
 
 void QlManager::update_set(const std::string &tab_name, std::vector<SetClause> set_clauses,
@@ -164,28 +180,55 @@ void QlManager::update_set(const std::string &tab_name, std::vector<SetClause> s
             }
         }
     }
+    // A packed record that grows may move to another page, and then all indexes point to its new rid
+    bool packed = tab.is_packed();
+    std::vector<IxIndexHandle *> moved_ihs(tab.cols.size(), nullptr);
+    if (packed) {
+        for (size_t i = 0; i < tab.cols.size(); i++) {
+            if (tab.cols[i].index && ihs[i] == nullptr) {
+                moved_ihs[i] = SmManager::ihs.at(IxManager::get_index_name(tab_name, i)).get();
+            }
+        }
+    }
+    RmRecord row(tab.row_size());
+    std::vector<uint8_t> rec_buf(fh->hdr.record_size);
     // Update each rid from record file and index file
     for (auto &rid : rids) {
         auto rec = fh->get_record(rid);
+        if (packed) {
+            tab.unpack(rec->data, row.data);
+        } else {
+            memcpy(row.data, rec->data, row.size);
+        }
         // Remove old entry from index
         for (size_t i = 0; i < tab.cols.size(); i++) {
             if (ihs[i] != nullptr) {
-                ihs[i]->delete_entry(rec->data + tab.cols[i].offset, rid);
+                ihs[i]->delete_entry(row.data + tab.cols[i].offset, rid);
             }
         }
         // Update record in record file
         for (auto &set_clause : set_clauses) {
             auto lhs_col = tab.get_col(set_clause.lhs.col_name);
-            memcpy(rec->data + lhs_col->offset, set_clause.rhs.raw->data, lhs_col->len);
+            memcpy(row.data + lhs_col->offset, set_clause.rhs.raw->data, lhs_col->len);
+        }
+        Rid new_rid = rid;
+        if (packed) {
+            new_rid = fh->update_record(rid, rec_buf.data(), tab.pack(row.data, rec_buf.data()));
+        } else {
+            fh->update_record(rid, row.data);
         }
-        fh->update_record(rid, rec->data);
         // Insert new entry into index
         for (size_t i = 0; i < tab.cols.size(); i++) {
             if (ihs[i] != nullptr) {
-                ihs[i]->insert_entry(rec->data + tab.cols[i].offset, rid);
+                ihs[i]->insert_entry(row.data + tab.cols[i].offset, new_rid);
+            } else if (moved_ihs[i] != nullptr && new_rid != rid) {
+                moved_ihs[i]->delete_entry(row.data + tab.cols[i].offset, rid);
+                moved_ihs[i]->insert_entry(row.data + tab.cols[i].offset, new_rid);
             }
         }
     }
+    // Make the statement durable
+    PfManager::pager.commit();
 }
 
 static std::vector<Condition> pop_conds(std::vector<Condition> &conds, const std::vector<std::string> &tab_names) {
@@ -249,17 +292,17 @@ void QlManager::select_from(std::vector<TabCol> sel_cols, const std::vector<std:
     // Print records
     size_t num_rec = 0;
     for (query_plan->begin(); !query_plan->is_end(); query_plan->next()) {
-        auto rec = query_plan->rec();
+        RmRecordView rec = query_plan->rec();
         std::vector<std::string> columns;
         for (auto &col : query_plan->cols()) {
             std::string col_str;
-            uint8_t *rec_buf = rec->data + col.offset;
+            const uint8_t *rec_buf = rec.data + col.offset;
             if (col.type == TYPE_INT) {
-                col_str = std::to_string(*(int *)rec_buf);
+                col_str = std::to_string(*(const int *)rec_buf);
             } else if (col.type == TYPE_FLOAT) {
-                col_str = std::to_string(*(float *)rec_buf);
+                col_str = std::to_string(*(const float *)rec_buf);
             } else if (col.type == TYPE_STRING) {
-                col_str = std::string((char *)rec_buf, col.len);
+                col_str = std::string((const char *)rec_buf, col.len);
                 col_str.resize(strlen(col_str.c_str()));
             }
             columns.push_back(col_str);
@@ -10,18 +10,18 @@ std::vector<ColMeta>::const_iterator QlNode::get_col(const std::vector<ColMeta>
     return pos;
 }
 
-std::map<TabCol, Value> QlNode::rec2dict(const std::vector<ColMeta> &cols, const RmRecord *rec) {
+std::map<TabCol, Value> QlNode::rec2dict(const std::vector<ColMeta> &cols, const RmRecordView &rec) {
     std::map<TabCol, Value> rec_dict;
     for (auto &col : cols) {
         TabCol key(col.tab_name, col.name);
         Value val;
-        uint8_t *val_buf = rec->data + col.offset;
+        const uint8_t *val_buf = rec.data + col.offset;
         if (col.type == TYPE_INT) {
-            val.set_int(*(int *)val_buf);
+            val.set_int(*(const int *)val_buf);
         } else if (col.type == TYPE_FLOAT) {
-            val.set_float(*(float *)val_buf);
+            val.set_float(*(const float *)val_buf);
         } else if (col.type == TYPE_STRING) {
-            std::string str_val((char *)val_buf, col.len);
+            std::string str_val((const char *)val_buf, col.len);
             str_val.resize(strlen(str_val.c_str()));
             val.set_str(str_val);
         }
@@ -46,21 +46,29 @@ QlNodeProj::QlNodeProj(std::unique_ptr<QlNode> prev, const std::vector<TabCol> &
         _cols.push_back(col);
     }
     _len = curr_offset;
+    // Selecting every column in order passes the records of prev through without copying
+    _is_identity = _len == _prev->len();
+    for (size_t proj_idx = 0; proj_idx < _cols.size(); proj_idx++) {
+        _is_identity = _is_identity && _cols[proj_idx].offset == prev_cols[_sel_idxs[proj_idx]].offset;
+    }
+    _buf.resize(_len);
 }
 
-std::unique_ptr<RmRecord> QlNodeProj::rec() const {
+RmRecordView QlNodeProj::rec() const {
     assert(!is_end());
+    RmRecordView prev_rec = _prev->rec();
+    if (_is_identity) {
+        return prev_rec;
+    }
     auto &prev_cols = _prev->cols();
-    auto prev_rec = _prev->rec();
     auto &proj_cols = _cols;
-    auto proj_rec = std::make_unique<RmRecord>(_len);
     for (size_t proj_idx = 0; proj_idx < proj_cols.size(); proj_idx++) {
         size_t prev_idx = _sel_idxs[proj_idx];
         auto &prev_col = prev_cols[prev_idx];
         auto &proj_col = proj_cols[proj_idx];
-        memcpy(proj_rec->data + proj_col.offset, prev_rec->data + prev_col.offset, proj_col.len);
+        memcpy(_buf.data() + proj_col.offset, prev_rec.data + prev_col.offset, proj_col.len);
     }
-    return proj_rec;
+    return RmRecordView(_buf.data(), (int)_len);
 }
 
 QlNodeTable::QlNodeTable(std::string tab_name, std::vector<Condition> conds) {
@@ -70,6 +78,11 @@ QlNodeTable::QlNodeTable(std::string tab_name, std::vector<Condition> conds) {
     _fh = SmManager::fhs.at(_tab_name).get();
     _cols = tab.cols;
     _len = _cols.back().offset + _cols.back().len;
+    _tab = &tab;
+    _packed = tab.is_packed();
+    if (_packed) {
+        _row.resize(_len);
+    }
     static std::map<CompOp, CompOp> swap_op = {
         {OP_EQ, OP_EQ}, {OP_NE, OP_NE}, {OP_LT, OP_GT}, {OP_GT, OP_LT}, {OP_LE, OP_GE}, {OP_GE, OP_LE},
     };
@@ -104,9 +117,12 @@ void QlNodeTable::begin() {
         }
     }
 
+    _rm_scan = nullptr;
     if (index_no == -1) {
         // no index is available, scan record file
-        _scan = std::make_unique<RmScan>(_fh);
+        auto rm_scan = std::make_unique<RmScan>(_fh);
+        _rm_scan = rm_scan.get();
+        _scan = std::move(rm_scan);
     } else {
         // index is available, scan index
         auto ih = SmManager::ihs.at(IxManager::get_index_name(_tab_name, index_no)).get();
@@ -136,26 +152,33 @@ void QlNodeTable::begin() {
         _scan = std::make_unique<IxScan>(ih, lower, upper);
     }
     // Get the first record
-    while (!_scan->is_end()) {
-        _rid = _scan->rid();
-        auto rec = _fh->get_record(_rid);
-        if (eval_conds(_cols, _fed_conds, rec.get())) {
-            break;
-        }
+    while (!_scan->is_end() && !read_rec()) {
         _scan->next();
     }
+    if (_scan->is_end()) {
+        _page.release();
+    }
 }
 
 void QlNodeTable::next() {
     check_runtime_conds();
     assert(!is_end());
     for (_scan->next(); !_scan->is_end(); _scan->next()) {
-        _rid = _scan->rid();
-        auto rec = _fh->get_record(_rid);
-        if (eval_conds(_cols, _fed_conds, rec.get())) {
-            break;
+        if (read_rec()) {
+            return;
         }
     }
+    _page.release();
+}
+
+bool QlNodeTable::read_rec() {
+    _rid = _scan->rid();
+    _rec = _rm_scan != nullptr ? _rm_scan->record() : _fh->view_record(_rid, _page);
+    if (_packed) {
+        _tab->unpack(_rec.data, _row.data());
+        _rec = RmRecordView(_row.data(), _len);
+    }
+    return eval_conds(_cols, _fed_conds, _rec);
 }
 
 bool QlNodeTable::is_end() const { return _scan->is_end(); }
@@ -181,10 +204,10 @@ void QlNodeTable::check_runtime_conds() {
     }
 }
 
-bool QlNodeTable::eval_cond(const std::vector<ColMeta> &rec_cols, const Condition &cond, const RmRecord *rec) {
+bool QlNodeTable::eval_cond(const std::vector<ColMeta> &rec_cols, const Condition &cond, const RmRecordView &rec) {
     auto lhs_col = get_col(rec_cols, cond.lhs_col);
-    uint8_t *lhs = rec->data + lhs_col->offset;
-    uint8_t *rhs;
+    const uint8_t *lhs = rec.data + lhs_col->offset;
+    const uint8_t *rhs;
     ColType rhs_type;
     if (cond.is_rhs_val) {
         rhs_type = cond.rhs_val.type;
@@ -193,7 +216,7 @@ bool QlNodeTable::eval_cond(const std::vector<ColMeta> &rec_cols, const Conditio
         // rhs is a column
         auto rhs_col = get_col(rec_cols, cond.rhs_col);
         rhs_type = rhs_col->type;
-        rhs = rec->data + rhs_col->offset;
+        rhs = rec.data + rhs_col->offset;
     }
     assert(rhs_type == lhs_col->type); // TODO convert to common type
     int cmp = ix_compare(lhs, rhs, rhs_type, lhs_col->len);
@@ -215,7 +238,7 @@ bool QlNodeTable::eval_cond(const std::vector<ColMeta> &rec_cols, const Conditio
 }
 
 bool QlNodeTable::eval_conds(const std::vector<ColMeta> &rec_cols, const std::vector<Condition> &conds,
-                             const RmRecord *rec) {
+                             const RmRecordView &rec) {
     return std::all_of(conds.begin(), conds.end(),
                        [&](const Condition &cond) { return eval_cond(rec_cols, cond, rec); });
 }
@@ -230,6 +253,7 @@ QlNodeJoin::QlNodeJoin(std::unique_ptr<QlNode> left, std::unique_ptr<QlNode> rig
         col.offset += _left->len();
     }
     _cols.insert(_cols.end(), right_cols.begin(), right_cols.end());
+    _buf.resize(_len);
 }
 
 void QlNodeJoin::begin() {
@@ -262,12 +286,11 @@ void QlNodeJoin::next() {
     }
 }
 
-std::unique_ptr<RmRecord> QlNodeJoin::rec() const {
+RmRecordView QlNodeJoin::rec() const {
     assert(!is_end());
-    auto record = std::make_unique<RmRecord>(_len);
-    memcpy(record->data, _left->rec()->data, _left->len());
-    memcpy(record->data + _left->len(), _right->rec()->data, _right->len());
-    return record;
+    memcpy(_buf.data(), _left->rec().data, _left->len());
+    memcpy(_buf.data() + _left->len(), _right->rec().data, _right->len());
+    return RmRecordView(_buf.data(), (int)_len);
 }
 
 void QlNodeJoin::feed(const std::map<TabCol, Value> &feed_dict) {
@@ -276,7 +299,7 @@ void QlNodeJoin::feed(const std::map<TabCol, Value> &feed_dict) {
 }
 
 void QlNodeJoin::feed_right() {
-    auto left_dict = rec2dict(_left->cols(), _left->rec().get());
+    auto left_dict = rec2dict(_left->cols(), _left->rec());
     auto feed_dict = _prev_feed_dict;
     feed_dict.insert(left_dict.begin(), left_dict.end());
     _right->feed(feed_dict);
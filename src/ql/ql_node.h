@@ -14,12 +14,13 @@ class QlNode {
     virtual void next() = 0;
     virtual bool is_end() const = 0;
 
-    virtual std::unique_ptr<RmRecord> rec() const = 0;
+    // The current record. It is valid until the node moves, and points into a pinned page where possible.
+    virtual RmRecordView rec() const = 0;
     virtual void feed(const std::map<TabCol, Value> &feed_dict) = 0;
 
     static std::vector<ColMeta>::const_iterator get_col(const std::vector<ColMeta> &rec_cols, const TabCol &target);
 
-    static std::map<TabCol, Value> rec2dict(const std::vector<ColMeta> &cols, const RmRecord *rec);
+    static std::map<TabCol, Value> rec2dict(const std::vector<ColMeta> &cols, const RmRecordView &rec);
 };
 
 class QlNodeProj : public QlNode {
@@ -36,7 +37,7 @@ class QlNodeProj : public QlNode {
     }
     bool is_end() const override { return _prev->is_end(); }
 
-    std::unique_ptr<RmRecord> rec() const override;
+    RmRecordView rec() const override;
 
     void feed(const std::map<TabCol, Value> &feed_dict) override {
         throw InternalError("Cannot feed a projection node");
@@ -47,6 +48,8 @@ class QlNodeProj : public QlNode {
     std::vector<ColMeta> _cols;
     size_t _len;
     std::vector<size_t> _sel_idxs;
+    bool _is_identity; // all columns of prev in order, so its records pass through
+    mutable std::vector<uint8_t> _buf;
 };
 
 class QlNodeTable : public QlNode {
@@ -60,9 +63,9 @@ class QlNodeTable : public QlNode {
     size_t len() const override { return _len; }
     const std::vector<ColMeta> &cols() const override { return _cols; }
 
-    std::unique_ptr<RmRecord> rec() const override {
+    RmRecordView rec() const override {
         assert(!is_end());
-        return _fh->get_record(_rid);
+        return _rec;
     }
 
     void feed(const std::map<TabCol, Value> &feed_dict) override;
@@ -71,12 +74,15 @@ class QlNodeTable : public QlNode {
 
     void check_runtime_conds();
 
-    static bool eval_cond(const std::vector<ColMeta> &rec_cols, const Condition &cond, const RmRecord *rec);
+    static bool eval_cond(const std::vector<ColMeta> &rec_cols, const Condition &cond, const RmRecordView &rec);
 
     static bool eval_conds(const std::vector<ColMeta> &rec_cols, const std::vector<Condition> &conds,
-                           const RmRecord *rec);
+                           const RmRecordView &rec);
 
   private:
+    // View the record under the scan and check it against the conditions
+    bool read_rec();
+
     std::string _tab_name;
     std::vector<Condition> _conds;
     RmFileHandle *_fh;
@@ -86,6 +92,12 @@ class QlNodeTable : public QlNode {
 
     Rid _rid;
     std::unique_ptr<RecScan> _scan;
+    RmScan *_rm_scan = nullptr; // _scan if it scans the record file, whose pages it keeps pinned
+    PageGuard _page;            // page of the current record found through an index
+    RmRecordView _rec;
+    const TabMeta *_tab;
+    bool _packed;               // records are packed, and unpacked into _row to be read
+    std::vector<uint8_t> _row;
 };
 
 class QlNodeJoin : public QlNode {
@@ -102,7 +114,7 @@ class QlNodeJoin : public QlNode {
 
     bool is_end() const override { return _left->is_end(); }
 
-    std::unique_ptr<RmRecord> rec() const override;
+    RmRecordView rec() const override;
 
     void feed(const std::map<TabCol, Value> &feed_dict) override;
 
@@ -115,4 +127,5 @@ class QlNodeJoin : public QlNode {
     std::vector<ColMeta> _cols;
 
     std::map<TabCol, Value> _prev_feed_dict;
+    mutable std::vector<uint8_t> _buf;
 };
@@ -63,3 +63,109 @@ TEST(ql, basic) {
     exec_sql("select * from tb1, tb2;");
     SmManager::close_db();
 }
+
+// A row of tb3 read back from its record file
+struct Tb3Row {
+    Rid rid;
+    std::string name;
+    std::string note;
+};
+
+// Read the rows of tb3 by id
+static std::map<int, Tb3Row> scan_tb3() {
+    const TabMeta &tab = SmManager::db.get_table("tb3");
+    std::vector<uint8_t> row(tab.row_size());
+    auto get_str = [&](int col_idx) {
+        const ColMeta &col = tab.cols[col_idx];
+        const char *str = (const char *)row.data() + col.offset;
+        return std::string(str, strnlen(str, col.len));
+    };
+    std::map<int, Tb3Row> rows;
+    for (RmScan scan(SmManager::fhs.at("tb3").get()); !scan.is_end(); scan.next()) {
+        tab.unpack(scan.record().data, row.data());
+        rows[*(int *)row.data()] = Tb3Row{scan.rid(), get_str(1), get_str(2)};
+    }
+    return rows;
+}
+
+// Look up the rids of a name in the index of tb3
+static std::vector<Rid> lookup_name(const std::string &name) {
+    IxIndexHandle *ih = SmManager::ihs.at(IxManager::get_index_name("tb3", 1)).get();
+    std::vector<uint8_t> key(ih->hdr.col_len, 0);
+    memcpy(key.data(), name.data(), name.size());
+    std::vector<Rid> rids;
+    for (IxScan scan(ih, ih->lower_bound(key.data()), ih->upper_bound(key.data())); !scan.is_end(); scan.next()) {
+        rids.push_back(scan.rid());
+    }
+    return rids;
+}
+
+// Run a query and return what it printed
+static std::string query(const std::string &sql) {
+    testing::internal::CaptureStdout();
+    exec_sql(sql);
+    return testing::internal::GetCapturedStdout();
+}
+
+TEST(ql, varchar) {
+    const std::string db_name = "db";
+    if (SmManager::is_dir(db_name)) {
+        SmManager::drop_db(db_name);
+    }
+    SmManager::create_db(db_name);
+    SmManager::open_db(db_name);
+
+    exec_sql("create table tb3(id int, name varchar(16), note varchar(64));");
+    exec_sql("create index tb3(name);");
+    exec_sql("desc tb3;");
+
+    exec_sql("insert into tb3 values (1, 'abc', '');");
+    exec_sql("insert into tb3 values (2, '0123456789abcdef', 'short');");
+    exec_sql("insert into tb3 values (3, '', 'a note');");
+    exec_sql("insert into tb3 values (4, 'abc', 'another note');");
+    auto rows = scan_tb3();
+    ASSERT_EQ(rows.size(), 4u);
+    EXPECT_EQ(rows.at(2).name, "0123456789abcdef");
+    EXPECT_EQ(rows.at(4).note, "another note");
+    // Records are stored without padding
+    EXPECT_EQ(SmManager::fhs.at("tb3")->get_record(rows.at(1).rid)->size, 4 + 2 + 3 + 2);
+
+    exec_sql("select * from tb3;");
+    EXPECT_NE(query("select * from tb3 where name = 'abc';").find("Total record(s): 2\n"), std::string::npos);
+    // Fill the page, so that record 1 has no room to grow in place
+    const std::string long_note(64, 'x');
+    int64_t page_no = rows.at(1).rid.page_no;
+    int id = 100;
+    do {
+        exec_sql("insert into tb3 values (" + std::to_string(id) + ", '', '" + long_note + "');");
+        rows = scan_tb3();
+    } while (rows.at(id++).rid.page_no == page_no);
+    Rid old_rid = rows.at(1).rid;
+    exec_sql("update tb3 set note = '" + long_note + "' where id = 1;");
+    rows = scan_tb3();
+    // The record moved, and is read back at its new rid and found there by the index
+    Rid new_rid = rows.at(1).rid;
+    EXPECT_NE(new_rid, old_rid);
+    EXPECT_EQ(rows.at(1).name, "abc");
+    EXPECT_EQ(rows.at(1).note, long_note);
+    EXPECT_FALSE(SmManager::fhs.at("tb3")->is_record(old_rid));
+    std::vector<Rid> rids = lookup_name("abc");
+    EXPECT_EQ(rids.size(), 2u);
+    EXPECT_NE(std::find(rids.begin(), rids.end(), new_rid), rids.end());
+    EXPECT_EQ(std::find(rids.begin(), rids.end(), old_rid), rids.end());
+
+    exec_sql("update tb3 set name = 'xyz' where note = 'short';");
+    EXPECT_EQ(scan_tb3().at(2).name, "xyz");
+    EXPECT_EQ(lookup_name("xyz"), std::vector<Rid>{rows.at(2).rid});
+    EXPECT_TRUE(lookup_name("0123456789abcdef").empty());
+    // Only row 2 sorts after 'abc', the others have names 'abc' or ''
+    std::string output = query("select * from tb3 where name > 'abc';");
+    EXPECT_NE(output.find(" xyz |"), std::string::npos);
+    EXPECT_NE(output.find("Total record(s): 1\n"), std::string::npos);
+    exec_sql("delete from tb3 where id = 3;");
+    EXPECT_EQ(scan_tb3().count(3), 0u);
+    exec_sql("select id, note from tb3;");
+
+    EXPECT_THROW(exec_sql("insert into tb3 values (5, '0123456789abcdefg', '');"), StringOverflowError);
+    SmManager::close_db();
+}
@@ -1,12 +1,15 @@
 #include "interp.h"
+#include "options.h"
 
 int main(int argc, char **argv) {
-    if (argc != 2) {
-        std::cerr << "Usage: " << argv[0] << " <database>" << std::endl;
+    Options options;
+    if (!options.parse(argc, argv)) {
+        Options::print_usage(argv[0]);
         exit(1);
     }
     try {
-        std::string db_name = argv[1];
+        options.apply();
+        std::string db_name = options.db_name;
         if (!SmManager::is_dir(db_name)) {
             SmManager::create_db(db_name);
         }
@@ -1,4 +1,5 @@
 #include "interp.h"
+#include "options.h"
 #include <readline/history.h>
 #include <readline/readline.h>
 #include <signal.h>
@@ -8,8 +9,9 @@ static bool should_exit = false;
 void sigint_handler(int signo) { should_exit = true; }
 
 int main(int argc, char **argv) {
-    if (argc != 2) {
-        std::cerr << "Usage: " << argv[0] << " <database>" << std::endl;
+    Options options;
+    if (!options.parse(argc, argv)) {
+        Options::print_usage(argv[0]);
         exit(1);
     }
     signal(SIGINT, sigint_handler);
@@ -24,8 +26,11 @@ int main(int argc, char **argv) {
                      "\n"
                      "Type 'help;' for help.\n"
                      "\n";
+        // Configure storage engine
+        options.apply();
+        std::cout << PfManager::pager.memory_report() << "\n\n";
         // Database name is passed by args
-        std::string db_name = argv[1];
+        std::string db_name = options.db_name;
         if (!SmManager::is_dir(db_name)) {
             // Database not found, create a new one
             SmManager::create_db(db_name);
@@ -2,7 +2,14 @@
 
 #include <cinttypes>
 #include <cstring>
+#ifdef __AVX2__
+#include <immintrin.h>
+#endif
 
+// Bits are numbered from the highest bit of the first byte, which is the layout of slot bitmaps in record files.
+// Searches and counts work on 64-bit words: a word loaded big-endian keeps bit i of the bitmap at bit 63 - i, so
+// the first bit of interest is found by counting leading zeros. With AVX2, runs of 32 bytes without any bit of
+// interest are skipped at once.
 class Bitmap {
   public:
     static constexpr int WIDTH = 8;
@@ -16,19 +23,107 @@ class Bitmap {
 
     static bool test(const uint8_t *bm, int pos) { return (bm[get_bucket(pos)] & get_bit(pos)) != 0; }
 
+    // Set bits [begin, end), whole bytes at once
+    static void set_range(uint8_t *bm, int begin, int end) {
+        if (begin >= end) {
+            return;
+        }
+        int first = get_bucket(begin);
+        int last = get_bucket(end - 1);
+        uint8_t head = 0xff >> (begin % WIDTH);
+        uint8_t tail = 0xff << (WIDTH - 1 - (end - 1) % WIDTH);
+        if (first == last) {
+            bm[first] |= head & tail;
+            return;
+        }
+        bm[first] |= head;
+        memset(bm + first + 1, 0xff, last - first - 1);
+        bm[last] |= tail;
+    }
+
+    // Position of the first bit equal to bit after curr, or max_n if there is none
     static int next_bit(bool bit, const uint8_t *bm, int max_n, int curr) {
-        for (int i = curr + 1; i < max_n; i++) {
-            if (test(bm, i) == bit) {
-                return i;
+        int pos = curr + 1;
+        if (pos >= max_n) {
+            return max_n;
+        }
+        // In full pages the very next bit matches, and testing it is quicker than a word search
+        if (test(bm, pos) == bit) {
+            return pos;
+        }
+        int num_bytes = (max_n + WIDTH - 1) / WIDTH;
+        uint64_t flip = bit ? 0 : ~(uint64_t)0;
+        int word_no = pos / 64;
+        // Drop the bits before pos in its word
+        uint64_t word = (load_word(bm, word_no, num_bytes) ^ flip) & (~(uint64_t)0 >> (pos % 64));
+        while (word == 0) {
+            word_no++;
+#ifdef __AVX2__
+            word_no = skip_words(bit, bm, word_no, num_bytes);
+#endif
+            if (word_no * 64 >= max_n) {
+                return max_n;
             }
+            word = load_word(bm, word_no, num_bytes) ^ flip;
         }
-        return max_n;
+        // Bits past max_n in the last word may match too
+        int found = word_no * 64 + __builtin_clzll(word);
+        return found < max_n ? found : max_n;
     }
 
     static int first_bit(bool bit, const uint8_t *bm, int max_n) { return next_bit(bit, bm, max_n, -1); }
 
+    // Number of bits equal to bit among the first max_n
+    static int count(bool bit, const uint8_t *bm, int max_n) {
+        int num_bytes = (max_n + WIDTH - 1) / WIDTH;
+        int num_ones = 0;
+        for (int word_no = 0; word_no * 64 < max_n; word_no++) {
+            uint64_t word = load_word(bm, word_no, num_bytes);
+            if ((word_no + 1) * 64 > max_n) {
+                word &= ~(~(uint64_t)0 >> (max_n % 64));
+            }
+            num_ones += __builtin_popcountll(word);
+        }
+        return bit ? num_ones : max_n - num_ones;
+    }
+
   private:
     static int get_bucket(int pos) { return pos / WIDTH; }
 
     static uint8_t get_bit(int pos) { return HIGHEST_BIT >> (uint8_t)(pos % WIDTH); }
+
+    // Bits [64 * word_no, 64 * word_no + 64) with the first one at the top. Bytes past the bitmap read as zero.
+    static uint64_t load_word(const uint8_t *bm, int word_no, int num_bytes) {
+        int offset = word_no * 8;
+        uint64_t word;
+        if (offset + 8 > num_bytes) {
+            word = 0;
+            for (int i = 0; i < 8; i++) {
+                word = word << 8 | (offset + i < num_bytes ? bm[offset + i] : 0);
+            }
+            return word;
+        }
+        memcpy(&word, bm + offset, 8);
+#if __BYTE_ORDER__ == __ORDER_LITTLE_ENDIAN__
+        word = __builtin_bswap64(word);
+#endif
+        return word;
+    }
+
+#ifdef __AVX2__
+    // Skip whole 32-byte blocks from the word holding no bit equal to bit, as far as the bitmap fills them.
+    // Return the first word that may hold one.
+    static int skip_words(bool bit, const uint8_t *bm, int word_no, int num_bytes) {
+        __m256i none = _mm256_set1_epi8(bit ? 0 : (char)0xff);
+        int offset = word_no * 8;
+        while (offset + 32 <= num_bytes) {
+            __m256i block = _mm256_loadu_si256((const __m256i *)(bm + offset));
+            if (_mm256_movemask_epi8(_mm256_cmpeq_epi8(block, none)) != -1) {
+                break;
+            }
+            offset += 32;
+        }
+        return offset / 8;
+    }
+#endif
 };
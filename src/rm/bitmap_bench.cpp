@@ -0,0 +1,92 @@
+#include "rm/bitmap.h"
+#include <chrono>
+#include <cstdio>
+#include <random>
+#include <vector>
+
+// Slot bitmap searches as done by record files, against the former bit-by-bit search. A page of 4-byte records has
+// 985 slots. A scan walks the used slots of a page with next_bit, at several fill ratios. An insert finds the first
+// free slot with first_bit and takes it, from an empty page until it is full.
+
+static constexpr int NUM_SLOTS = 985;
+static constexpr int NUM_PAGES = 1024;
+static constexpr int NUM_ROUNDS = 50;
+
+// The bit-by-bit search that Bitmap used before
+static int naive_next_bit(bool bit, const uint8_t *bm, int max_n, int curr) {
+    for (int i = curr + 1; i < max_n; i++) {
+        if (Bitmap::test(bm, i) == bit) {
+            return i;
+        }
+    }
+    return max_n;
+}
+
+template <typename F>
+static double time_ns(F &&f) {
+    auto start = std::chrono::steady_clock::now();
+    f();
+    auto end = std::chrono::steady_clock::now();
+    return std::chrono::duration<double, std::nano>(end - start).count();
+}
+
+template <typename NextBit>
+static double bench_scan(const std::vector<std::vector<uint8_t>> &pages, NextBit next_bit, uint64_t &sum) {
+    return time_ns([&] {
+               for (int round = 0; round < NUM_ROUNDS; round++) {
+                   for (const auto &bm : pages) {
+                       for (int i = next_bit(true, bm.data(), NUM_SLOTS, -1); i < NUM_SLOTS;
+                            i = next_bit(true, bm.data(), NUM_SLOTS, i)) {
+                           sum += i;
+                       }
+                   }
+               }
+           }) /
+           NUM_ROUNDS / pages.size();
+}
+
+template <typename NextBit>
+static double bench_insert(NextBit next_bit, uint64_t &sum) {
+    std::vector<uint8_t> bm((NUM_SLOTS + Bitmap::WIDTH - 1) / Bitmap::WIDTH);
+    int num_pages = NUM_ROUNDS * NUM_PAGES / 16;
+    return time_ns([&] {
+               for (int page = 0; page < num_pages; page++) {
+                   Bitmap::init(bm.data(), bm.size());
+                   for (int n = 0; n < NUM_SLOTS; n++) {
+                       int slot_no = next_bit(false, bm.data(), NUM_SLOTS, -1);
+                       Bitmap::set(bm.data(), slot_no);
+                       sum += slot_no;
+                   }
+               }
+           }) /
+           num_pages / NUM_SLOTS;
+}
+
+int main() {
+    // Lambdas, so that both searches are inlined as at their call sites in record files
+    auto naive = [](bool bit, const uint8_t *bm, int max_n, int curr) { return naive_next_bit(bit, bm, max_n, curr); };
+    auto word = [](bool bit, const uint8_t *bm, int max_n, int curr) { return Bitmap::next_bit(bit, bm, max_n, curr); };
+    std::mt19937 rng(0);
+    uint64_t sum = 0;
+    for (int density : {100, 50, 10, 1}) {
+        std::vector<std::vector<uint8_t>> pages(NUM_PAGES);
+        for (auto &bm : pages) {
+            bm.resize((NUM_SLOTS + Bitmap::WIDTH - 1) / Bitmap::WIDTH);
+            for (int i = 0; i < NUM_SLOTS; i++) {
+                if ((int)(rng() % 100) < density) {
+                    Bitmap::set(bm.data(), i);
+                }
+            }
+        }
+        double naive_ns = bench_scan(pages, naive, sum);
+        double word_ns = bench_scan(pages, word, sum);
+        printf("scan   %3d%% used  bit-by-bit %8.1f ns/page  word %7.1f ns/page  speedup %5.1fx\n", density,
+               naive_ns, word_ns, naive_ns / word_ns);
+    }
+    double naive_ns = bench_insert(naive, sum);
+    double word_ns = bench_insert(word, sum);
+    printf("insert            bit-by-bit %8.1f ns/slot  word %7.1f ns/slot  speedup %5.1fx\n", naive_ns, word_ns,
+           naive_ns / word_ns);
+    printf("checksum %llu\n", (unsigned long long)sum);
+    return 0;
+}
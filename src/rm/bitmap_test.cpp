@@ -1,5 +1,7 @@
 #include "rm/bitmap.h"
+#include <algorithm>
 #include <bitset>
+#include <vector>
 #include <gtest/gtest.h>
 
 constexpr int MAX_N = 4096;
@@ -44,3 +46,73 @@ TEST(Bitmap, basic) {
         check_equal(bm, mock);
     }
 }
+
+// Bit-by-bit reference of next_bit
+static int naive_next_bit(bool bit, const uint8_t *bm, int max_n, int curr) {
+    for (int i = curr + 1; i < max_n; i++) {
+        if (Bitmap::test(bm, i) == bit) {
+            return i;
+        }
+    }
+    return max_n;
+}
+
+TEST(Bitmap, search) {
+    srand((unsigned)time(nullptr));
+
+    // Sizes that end inside a byte, a word and a 32-byte block, with bits past max_n set to catch reads beyond it
+    for (int max_n : {1, 7, 8, 63, 64, 65, 200, 255, 256, 257, 985, 4000}) {
+        int num_bytes = (max_n + Bitmap::WIDTH - 1) / Bitmap::WIDTH;
+        for (int density : {0, 1, 10, 50, 90, 99, 100}) {
+            std::vector<uint8_t> bm(num_bytes, 0xff);
+            int num_ones = 0;
+            for (int i = 0; i < max_n; i++) {
+                if (rand() % 100 < density) {
+                    num_ones++;
+                } else {
+                    Bitmap::reset(bm.data(), i);
+                }
+            }
+            EXPECT_EQ(Bitmap::count(true, bm.data(), max_n), num_ones);
+            EXPECT_EQ(Bitmap::count(false, bm.data(), max_n), max_n - num_ones);
+            for (bool bit : {false, true}) {
+                for (int curr = -1; curr < max_n; curr++) {
+                    ASSERT_EQ(Bitmap::next_bit(bit, bm.data(), max_n, curr),
+                              naive_next_bit(bit, bm.data(), max_n, curr))
+                        << "max_n " << max_n << " density " << density << " bit " << bit << " curr " << curr;
+                }
+                // Walking over all matching bits visits each once
+                int num_found = 0;
+                for (int i = Bitmap::first_bit(bit, bm.data(), max_n); i < max_n;
+                     i = Bitmap::next_bit(bit, bm.data(), max_n, i)) {
+                    num_found++;
+                }
+                EXPECT_EQ(num_found, bit ? num_ones : max_n - num_ones);
+            }
+        }
+    }
+}
+
+TEST(Bitmap, set_range) {
+    srand((unsigned)time(nullptr));
+
+    for (int round = 0; round < 1000; round++) {
+        uint8_t bm[MAX_N / Bitmap::WIDTH];
+        Bitmap::init(bm, MAX_N / Bitmap::WIDTH);
+        std::bitset<MAX_N> mock;
+        for (int i = 0; i < MAX_N; i++) {
+            if (rand() % 4 == 0) {
+                Bitmap::set(bm, i);
+                mock.set(i);
+            }
+        }
+        // Short ranges within a byte and long ones across many
+        int begin = rand() % MAX_N;
+        int end = std::min(MAX_N, begin + (round % 2 == 0 ? rand() % 16 : rand() % MAX_N));
+        Bitmap::set_range(bm, begin, end);
+        for (int i = begin; i < end; i++) {
+            mock.set(i);
+        }
+        check_equal(bm, mock);
+    }
+}
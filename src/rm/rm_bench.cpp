@@ -0,0 +1,120 @@
+#include "rm/rm.h"
+#include <algorithm>
+#include <chrono>
+#include <cstdio>
+#include <cstring>
+#include <vector>
+
+// Loads and full scans of a table of 4M records of 16 bytes (about 70 MiB) cached in the buffer pool. The table is
+// loaded a record at a time with insert_record and in batches with insert_records, against a plain memcpy of the
+// records. Each scan sums the first int of every record, reading it through the page pinned by the scan, through a
+// copy from get_record as the query layer does, or from the batches of fetch_batch. Buffer pool accesses are
+// counted per record.
+
+static constexpr int NUM_RECORDS = 4 * 1000 * 1000;
+static constexpr int RECORD_SIZE = 16;
+static constexpr int NUM_SCANS = 5;
+static constexpr int POOL_PAGES = 64 * 1024; // 256 MiB
+static constexpr int LOAD_BATCH = 64 * 1024;  // records per insert_records call
+
+template <typename F>
+static void bench_scan(const char *name, F &&scan) {
+    uint64_t sum = 0;
+    PfManager::pager.reset_stats();
+    auto start = std::chrono::steady_clock::now();
+    for (int i = 0; i < NUM_SCANS; i++) {
+        sum += scan();
+    }
+    auto end = std::chrono::steady_clock::now();
+    double ns = std::chrono::duration<double, std::nano>(end - start).count();
+    const PfStats &stats = PfManager::pager.stats();
+    double accesses = (double)(stats.hits + stats.misses) / NUM_SCANS / NUM_RECORDS;
+    printf("%-20s %7.2f M records/s  %6.3f pool accesses/record  sum %llu\n", name,
+           (double)NUM_SCANS * NUM_RECORDS / ns * 1e3, accesses, (unsigned long long)sum);
+}
+
+// Time a load of the records into a new file, leaving the file open in fh
+template <typename F>
+static void bench_load(const char *name, const std::string &filename, std::unique_ptr<RmFileHandle> &fh, F &&load) {
+    if (fh) {
+        RmManager::close_file(fh.get());
+        RmManager::destroy_file(filename);
+    }
+    RmManager::create_file(filename, RECORD_SIZE);
+    fh = RmManager::open_file(filename);
+    PfManager::pager.reset_stats();
+    auto start = std::chrono::steady_clock::now();
+    load();
+    auto end = std::chrono::steady_clock::now();
+    double ns = std::chrono::duration<double, std::nano>(end - start).count();
+    const PfStats &stats = PfManager::pager.stats();
+    double accesses = (double)(stats.hits + stats.misses) / NUM_RECORDS;
+    printf("%-20s %7.2f M records/s  %6.3f pool accesses/record  %8.1f MiB/s\n", name, NUM_RECORDS / ns * 1e3,
+           accesses, (double)NUM_RECORDS * RECORD_SIZE / ns * 1e9 / (1 << 20));
+}
+
+int main() {
+    PfManager::pager.resize(POOL_PAGES);
+    std::string filename = "rm_bench";
+    if (PfManager::is_file(filename)) {
+        RmManager::destroy_file(filename);
+    }
+    std::vector<uint8_t> records((size_t)NUM_RECORDS * RECORD_SIZE);
+    for (int i = 0; i < NUM_RECORDS; i++) {
+        *(int *)(records.data() + (size_t)i * RECORD_SIZE) = i;
+    }
+
+    std::vector<uint8_t> copy(records.size());
+    memset(copy.data(), 0, copy.size());
+    auto start = std::chrono::steady_clock::now();
+    memcpy(copy.data(), records.data(), records.size());
+    auto end = std::chrono::steady_clock::now();
+    double ns = std::chrono::duration<double, std::nano>(end - start).count();
+    printf("%-20s %7.2f M records/s  %6.3f pool accesses/record  %8.1f MiB/s\n", "memcpy", NUM_RECORDS / ns * 1e3,
+           0., (double)copy.size() / ns * 1e9 / (1 << 20));
+
+    std::unique_ptr<RmFileHandle> fh;
+    bench_load("insert_record", filename, fh, [&] {
+        for (int i = 0; i < NUM_RECORDS; i++) {
+            fh->insert_record(records.data() + (size_t)i * RECORD_SIZE);
+        }
+    });
+    bench_load("insert_records", filename, fh, [&] {
+        std::vector<Rid> rids;
+        for (int i = 0; i < NUM_RECORDS; i += LOAD_BATCH) {
+            rids.clear();
+            fh->insert_records(records.data() + (size_t)i * RECORD_SIZE, std::min(LOAD_BATCH, NUM_RECORDS - i), rids);
+        }
+    });
+    printf("\n");
+
+    bench_scan("scan in place", [&] {
+        uint64_t sum = 0;
+        for (RmScan scan(fh.get()); !scan.is_end(); scan.next()) {
+            sum += *(const int *)scan.record().data;
+        }
+        return sum;
+    });
+    bench_scan("scan + get_record", [&] {
+        uint64_t sum = 0;
+        for (RmScan scan(fh.get()); !scan.is_end(); scan.next()) {
+            sum += *(int *)fh->get_record(scan.rid())->data;
+        }
+        return sum;
+    });
+    bench_scan("fetch_batch", [&] {
+        uint64_t sum = 0;
+        RmBatch batch;
+        for (int64_t page_no = RM_FIRST_RECORD_PAGE; fh->fetch_batch(page_no, batch);
+             page_no = batch.rids[0].page_no + 1) {
+            for (const uint8_t *slot : batch.slots) {
+                sum += *(const int *)slot;
+            }
+        }
+        return sum;
+    });
+
+    RmManager::close_file(fh.get());
+    RmManager::destroy_file(filename);
+    return 0;
+}
@@ -3,12 +3,59 @@
 #include "defs.h"
 #include "pf/pf.h"
 
-constexpr int RM_NO_PAGE = -1;
-constexpr int RM_FILE_HDR_PAGE = 0;
-constexpr int RM_FIRST_RECORD_PAGE = 1;
+constexpr int64_t RM_NO_PAGE = -1;
+constexpr int64_t RM_FILE_HDR_PAGE = 0;
+constexpr int64_t RM_FIRST_RECORD_PAGE = 1;
 constexpr int RM_MAX_RECORD_SIZE = 512;
 
+constexpr uint32_t RM_FILE_MAGIC = 0x4d524252; // "RBRM"
+constexpr int RM_FILE_VERSION = 2;            // version 1 files have 32-bit page numbers and no magic
+
+// Record layout of a file. Fixed files hold records of record_size bytes in slots found by a bitmap. Slotted files
+// hold records of up to record_size bytes, found through a directory of offsets at the start of each page.
+enum RmLayout { RM_LAYOUT_FIXED, RM_LAYOUT_SLOTTED };
+
 struct RmFileHdr {
+    uint32_t magic;
+    int version;
+    int record_size;          // size of every record, or the largest size in slotted files
+    int num_records_per_page; // in slotted files, the most slots a page can have
+    int bitmap_size;          // zero in slotted files
+    int64_t num_pages;
+    int64_t first_free;
+    int64_t num_alloc_pages;  // pages allocated on disk, beyond num_pages when preallocated. Zero in older files.
+    RmLayout layout;          // fixed in older files
+};
+
+struct RmPageHdr {
+    int64_t next_free;
+    int num_records;
+};
+
+// Header of a page in a slotted file. The slot directory follows it, growing towards the end of the page, while
+// records are stored from the end of the page down.
+struct RmSlottedPageHdr {
+    int64_t next_free;
+    int num_records;
+    int num_slots;    // entries of the slot directory, used or not
+    int data_begin;   // offset of the lowest record
+    int free_bytes;   // bytes of the page used by nothing, including holes left between records
+    int in_free_list; // whether the page is on the free list of the file
+};
+
+// An entry of the slot directory of a slotted page
+struct RmSlot {
+    uint16_t offset; // offset of the record in the page, zero if the slot is free
+    uint16_t size;
+};
+
+static_assert(PAGE_SIZE <= UINT16_MAX, "Slot offsets must fit in 16 bits");
+
+// Most slots a page of a slotted file can have, all holding empty records
+constexpr int RM_MAX_SLOTS = (PAGE_SIZE - (int)sizeof(RmSlottedPageHdr)) / (int)sizeof(RmSlot);
+
+// Headers of version 1 files, only used to upgrade them
+struct RmFileHdrV1 {
     int record_size;
     int num_pages;
     int num_records_per_page;
@@ -16,7 +63,7 @@ struct RmFileHdr {
     int bitmap_size;
 };
 
-struct RmPageHdr {
+struct RmPageHdrV1 {
     int next_free;
     int num_records;
 };
@@ -36,3 +83,14 @@ struct RmRecord {
 
     ~RmRecord() { delete[] data; }
 };
+
+// A read-only record used in place, usually in a page frame, without copying it. It does not pin the page, and
+// is valid only while whoever handed it out keeps the page pinned.
+struct RmRecordView {
+    const uint8_t *data = nullptr;
+    int size = 0;
+
+    RmRecordView() = default;
+    RmRecordView(const uint8_t *data_, int size_) : data(data_), size(size_) {}
+    RmRecordView(const RmRecord &rec) : data(rec.data), size(rec.size) {}
+};
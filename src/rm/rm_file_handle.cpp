@@ -1,24 +1,97 @@
 #include "rm/rm_file_handle.h"
+#include <algorithm>
 #include <cassert>
 
 bool RmFileHandle::is_record(const Rid &rid) const {
     RmPageHandle ph = fetch_page(rid.page_no);
+    if (hdr.layout == RM_LAYOUT_SLOTTED) {
+        return SlottedPage(ph.page->buf).is_used(rid.slot_no);
+    }
     return Bitmap::test(ph.bitmap, rid.slot_no);
 }
 
 std::unique_ptr<RmRecord> RmFileHandle::get_record(const Rid &rid) const {
-    auto record = std::make_unique<RmRecord>(hdr.record_size);
-    RmPageHandle ph = fetch_page(rid.page_no);
-    if (!Bitmap::test(ph.bitmap, rid.slot_no)) {
+    PageGuard page;
+    RmRecordView view = view_record(rid, page);
+    auto record = std::make_unique<RmRecord>(view.size);
+    memcpy(record->data, view.data, view.size);
+    return record;
+}
+
+RmRecordView RmFileHandle::view_record(const Rid &rid, PageGuard &page) const {
+    if (!page || page->id != PageId(fd, rid.page_no)) {
+        assert(rid.page_no < hdr.num_pages);
+        page = PfManager::pager.fetch_page(fd, rid.page_no);
+    }
+    if (hdr.layout == RM_LAYOUT_SLOTTED) {
+        SlottedPage sp(page->buf);
+        if (!sp.is_used(rid.slot_no)) {
+            throw RecordNotFoundError(rid.page_no, rid.slot_no);
+        }
+        return RmRecordView(sp.get(rid.slot_no), sp.size(rid.slot_no));
+    }
+    const uint8_t *bitmap = page->buf + sizeof(RmPageHdr);
+    if (!Bitmap::test(bitmap, rid.slot_no)) {
         throw RecordNotFoundError(rid.page_no, rid.slot_no);
     }
-    uint8_t *slot = ph.get_slot(rid.slot_no);
-    memcpy(record->data, slot, hdr.record_size);
-    record->size = hdr.record_size;
-    return record;
+    return RmRecordView(bitmap + hdr.bitmap_size + rid.slot_no * hdr.record_size, hdr.record_size);
 }
 
-Rid RmFileHandle::insert_record(uint8_t *buf) {
+bool RmFileHandle::fetch_batch(int64_t page_no, RmBatch &batch) const {
+    batch.rids.clear();
+    batch.slots.clear();
+    batch.sizes.clear();
+    batch.page.release();
+    for (; page_no < hdr.num_pages; page_no++) {
+        RmPageHandle ph = fetch_page(page_no);
+        int num_records = ph.hdr->num_records;
+        if (num_records == 0) {
+            continue;
+        }
+        if (hdr.layout == RM_LAYOUT_SLOTTED) {
+            SlottedPage sp(ph.page->buf);
+            for (int slot_no = sp.next_used(-1); slot_no < sp.hdr->num_slots; slot_no = sp.next_used(slot_no)) {
+                batch.rids.emplace_back(page_no, slot_no);
+                batch.slots.push_back(sp.get(slot_no));
+                batch.sizes.push_back(sp.size(slot_no));
+            }
+            batch.page = std::move(ph.page);
+            return true;
+        }
+        // Stop at the last record rather than at the end of the bitmap
+        int slot_no = -1;
+        for (int i = 0; i < num_records; i++) {
+            slot_no = Bitmap::next_bit(true, ph.bitmap, hdr.num_records_per_page, slot_no);
+            assert(slot_no < hdr.num_records_per_page);
+            batch.rids.emplace_back(page_no, slot_no);
+            batch.slots.push_back(ph.get_slot(slot_no));
+        }
+        batch.page = std::move(ph.page);
+        return true;
+    }
+    return false;
+}
+
+Rid RmFileHandle::insert_record(const uint8_t *buf, int size) {
+    check_size(size);
+    if (hdr.layout == RM_LAYOUT_SLOTTED) {
+        while (true) {
+            RmPageHandle ph = create_page();
+            SlottedPage sp(ph.page->buf);
+            ph.page->mark_dirty();
+            // A page on the free list may have lost its room to records that grew in place
+            bool fits = sp.can_insert(size);
+            int slot_no = fits ? sp.insert(buf, size) : -1;
+            if (!has_room(sp)) {
+                hdr.first_free = sp.hdr->next_free;
+                sp.hdr->in_free_list = 0;
+                write_hdr();
+            }
+            if (fits) {
+                return Rid(ph.page->id.page_no, slot_no);
+            }
+        }
+    }
     RmPageHandle ph = create_page();
     // get slot number
     int slot_no = Bitmap::first_bit(false, ph.bitmap, hdr.num_records_per_page);
@@ -31,6 +104,7 @@ Rid RmFileHandle::insert_record(uint8_t *buf) {
     if (ph.hdr->num_records == hdr.num_records_per_page) {
         // page is full
         hdr.first_free = ph.hdr->next_free;
+        write_hdr();
     }
     // copy record data into slot
     uint8_t *slot = ph.get_slot(slot_no);
@@ -39,8 +113,56 @@ Rid RmFileHandle::insert_record(uint8_t *buf) {
     return rid;
 }
 
+void RmFileHandle::insert_records(const uint8_t *bufs, size_t num_records, std::vector<Rid> &rids) {
+    if (hdr.layout == RM_LAYOUT_SLOTTED) {
+        // Storing each record at the largest size would waste the room slotted pages are meant to save
+        throw InternalError("Bulk insert into a file of variable-size records");
+    }
+    rids.reserve(rids.size() + num_records);
+    // Fill the free pages
+    while (num_records > 0 && hdr.first_free != RM_NO_PAGE) {
+        RmPageHandle ph = fetch_page(hdr.first_free);
+        size_t num_filled = fill_page(ph, bufs, num_records, rids);
+        bufs += num_filled * hdr.record_size;
+        num_records -= num_filled;
+        if (ph.hdr->num_records == hdr.num_records_per_page) {
+            hdr.first_free = ph.hdr->next_free;
+        }
+    }
+    if (num_records > 0) {
+        // Append new pages for the rest, allocated on disk at once
+        int64_t num_new_pages = (num_records + hdr.num_records_per_page - 1) / hdr.num_records_per_page;
+        hdr.num_alloc_pages = PfManager::allocate_pages(fd, hdr.num_pages + num_new_pages, hdr.num_alloc_pages);
+        while (num_records > 0) {
+            RmPageHandle ph(&hdr, PfManager::pager.create_page(fd, hdr.num_pages));
+            ph.hdr->num_records = 0;
+            ph.hdr->next_free = RM_NO_PAGE;
+            Bitmap::init(ph.bitmap, hdr.bitmap_size);
+            hdr.num_pages++;
+            size_t num_filled = fill_page(ph, bufs, num_records, rids);
+            bufs += num_filled * hdr.record_size;
+            num_records -= num_filled;
+            if (ph.hdr->num_records < hdr.num_records_per_page) {
+                // Only the last page may have room left, and there is no other free page
+                hdr.first_free = ph.page->id.page_no;
+            }
+        }
+    }
+    write_hdr();
+}
+
 void RmFileHandle::delete_record(const Rid &rid) {
     RmPageHandle ph = fetch_page(rid.page_no);
+    if (hdr.layout == RM_LAYOUT_SLOTTED) {
+        SlottedPage sp(ph.page->buf);
+        if (!sp.is_used(rid.slot_no)) {
+            throw RecordNotFoundError(rid.page_no, rid.slot_no);
+        }
+        ph.page->mark_dirty();
+        sp.erase(rid.slot_no);
+        release_slotted_page(sp, rid.page_no);
+        return;
+    }
     if (!Bitmap::test(ph.bitmap, rid.slot_no)) {
         throw RecordNotFoundError(rid.page_no, rid.slot_no);
     }
@@ -53,35 +175,65 @@ void RmFileHandle::delete_record(const Rid &rid) {
     ph.hdr->num_records--;
 }
 
-void RmFileHandle::update_record(const Rid &rid, uint8_t *buf) {
+Rid RmFileHandle::update_record(const Rid &rid, const uint8_t *buf, int size) {
+    check_size(size);
     RmPageHandle ph = fetch_page(rid.page_no);
+    if (hdr.layout == RM_LAYOUT_SLOTTED) {
+        SlottedPage sp(ph.page->buf);
+        if (!sp.is_used(rid.slot_no)) {
+            throw RecordNotFoundError(rid.page_no, rid.slot_no);
+        }
+        ph.page->mark_dirty();
+        if (sp.update(rid.slot_no, buf, size)) {
+            release_slotted_page(sp, rid.page_no);
+            return rid;
+        }
+        // No room left in the page: move the record
+        sp.erase(rid.slot_no);
+        release_slotted_page(sp, rid.page_no);
+        ph.page.release();
+        return insert_record(buf, size);
+    }
     if (!Bitmap::test(ph.bitmap, rid.slot_no)) {
         throw RecordNotFoundError(rid.page_no, rid.slot_no);
     }
     ph.page->mark_dirty();
     uint8_t *slot = ph.get_slot(rid.slot_no);
     memcpy(slot, buf, hdr.record_size);
+    return rid;
 }
 
-RmPageHandle RmFileHandle::fetch_page(int page_no) const {
+void RmFileHandle::write_hdr() const {
+    PageGuard page = PfManager::pager.fetch_page(fd, RM_FILE_HDR_PAGE);
+    memcpy(page->buf, &hdr, sizeof(hdr));
+    page->mark_dirty();
+}
+
+RmPageHandle RmFileHandle::fetch_page(int64_t page_no) const {
     assert(page_no < hdr.num_pages);
-    Page *page = PfManager::pager.fetch_page(fd, page_no);
-    RmPageHandle ph(&hdr, page);
+    RmPageHandle ph(&hdr, PfManager::pager.fetch_page(fd, page_no));
     return ph;
 }
 
 RmPageHandle RmFileHandle::create_page() {
     if (hdr.first_free == RM_NO_PAGE) {
         // No free pages. Need to allocate a new page.
-        Page *page = PfManager::pager.create_page(fd, hdr.num_pages);
+        hdr.num_alloc_pages = PfManager::allocate_pages(fd, hdr.num_pages + 1, hdr.num_alloc_pages);
+        RmPageHandle ph(&hdr, PfManager::pager.create_page(fd, hdr.num_pages));
         // Init page handle
-        RmPageHandle ph = RmPageHandle(&hdr, page);
-        ph.hdr->num_records = 0;
-        ph.hdr->next_free = RM_NO_PAGE;
-        Bitmap::init(ph.bitmap, hdr.bitmap_size);
+        if (hdr.layout == RM_LAYOUT_SLOTTED) {
+            SlottedPage sp(ph.page->buf);
+            sp.init();
+            sp.hdr->in_free_list = 1;
+        } else {
+            ph.hdr->num_records = 0;
+            ph.hdr->next_free = RM_NO_PAGE;
+            Bitmap::init(ph.bitmap, hdr.bitmap_size);
+        }
         // Update file header
         hdr.num_pages++;
-        hdr.first_free = page->id.page_no;
+        hdr.first_free = ph.page->id.page_no;
+        write_hdr();
         return ph;
     } else {
         // Fetch the first free page.
@@ -90,7 +242,44 @@ RmPageHandle RmFileHandle::create_page() {
     }
 }
 
+size_t RmFileHandle::fill_page(RmPageHandle &ph, const uint8_t *bufs, size_t num_records, std::vector<Rid> &rids) {
+    ph.page->mark_dirty();
+    int64_t page_no = ph.page->id.page_no;
+    size_t num_filled = 0;
+    int slot_no = Bitmap::first_bit(false, ph.bitmap, hdr.num_records_per_page);
+    while (num_filled < num_records && slot_no < hdr.num_records_per_page) {
+        // The run of free slots from slot_no, up to the records left
+        int end = Bitmap::next_bit(true, ph.bitmap, hdr.num_records_per_page, slot_no);
+        end = (int)std::min<size_t>(end, slot_no + (num_records - num_filled));
+        Bitmap::set_range(ph.bitmap, slot_no, end);
+        memcpy(ph.get_slot(slot_no), bufs + num_filled * hdr.record_size, (size_t)(end - slot_no) * hdr.record_size);
+        for (int i = slot_no; i < end; i++) {
+            rids.emplace_back(page_no, i);
+        }
+        num_filled += end - slot_no;
+        slot_no = Bitmap::next_bit(false, ph.bitmap, hdr.num_records_per_page, end - 1);
+    }
+    ph.hdr->num_records += num_filled;
+    return num_filled;
+}
+
 void RmFileHandle::release_page(RmPageHandle &ph) {
     ph.hdr->next_free = hdr.first_free;
     hdr.first_free = ph.page->id.page_no;
+    write_hdr();
+}
+
+void RmFileHandle::release_slotted_page(const SlottedPage &sp, int64_t page_no) {
+    if (!sp.hdr->in_free_list && has_room(sp)) {
+        sp.hdr->next_free = hdr.first_free;
+        sp.hdr->in_free_list = 1;
+        hdr.first_free = page_no;
+        write_hdr();
+    }
+}
+
+void RmFileHandle::check_size(int size) const {
+    if (hdr.layout == RM_LAYOUT_SLOTTED ? size < 0 || size > hdr.record_size : size != hdr.record_size) {
+        throw InvalidRecordSizeError(size);
+    }
 }
@@ -2,16 +2,19 @@
 
 #include "rm/bitmap.h"
 #include "rm/rm_defs.h"
+#include "rm/slotted_page.h"
 #include <memory>
+#include <vector>
 
+// A record page pinned in the buffer pool
 struct RmPageHandle {
     RmPageHdr *hdr;
     uint8_t *bitmap;
     uint8_t *slots;
-    Page *page;
+    PageGuard page;
     const RmFileHdr *fhdr;
 
-    RmPageHandle(const RmFileHdr *fhdr_, Page *page_) : page(page_), fhdr(fhdr_) {
+    RmPageHandle(const RmFileHdr *fhdr_, PageGuard page_) : page(std::move(page_)), fhdr(fhdr_) {
         hdr = (RmPageHdr *)page->buf;
         bitmap = page->buf + sizeof(RmPageHdr);
         slots = bitmap + fhdr->bitmap_size;
@@ -20,9 +23,18 @@ struct RmPageHandle {
     uint8_t *get_slot(int slot_no) const { return slots + slot_no * fhdr->record_size; }
 };
 
-class RmFileHandle {
-    friend class RmScan;
+// The records of one record page, read at once by a batch scan. The page stays pinned as long as the batch holds
+// it, so the records can be read in place.
+struct RmBatch {
+    PageGuard page;
+    std::vector<Rid> rids;
+    std::vector<const uint8_t *> slots; // slots[i] holds the record at rids[i]
+    std::vector<int> sizes;             // sizes[i] is the size of the record at rids[i] in slotted files, else empty
+
+    size_t size() const { return rids.size(); }
+};
 
+class RmFileHandle {
   public:
     RmFileHdr hdr;
     int fd;
@@ -40,16 +52,54 @@ class RmFileHandle {
 
     std::unique_ptr<RmRecord> get_record(const Rid &rid) const;
 
-    Rid insert_record(uint8_t *buf);
+    // View the record in place. The view is valid while page stays pinned. If page already pins the page of the
+    // record, it is used without going through the buffer pool.
+    RmRecordView view_record(const Rid &rid, PageGuard &page) const;
+
+    Rid insert_record(uint8_t *buf) { return insert_record(buf, hdr.record_size); }
+
+    // Insert a record of the given size, which is record_size in fixed files and at most record_size in slotted ones
+    Rid insert_record(const uint8_t *buf, int size);
+
+    // Insert num_records records stored back to back in bufs, and append their rids in the same order. The free
+    // pages are filled first, then new pages are appended. Each run of free slots in a page is filled with a single
+    // copy and a single bitmap update, so the rids of a new page are its first slots in order. Records of a slotted
+    // file have sizes of their own and are inserted one at a time, so slotted files throw InternalError.
+    void insert_records(const uint8_t *bufs, size_t num_records, std::vector<Rid> &rids);
 
     void delete_record(const Rid &rid);
 
-    void update_record(const Rid &rid, uint8_t *buf);
+    Rid update_record(const Rid &rid, uint8_t *buf) { return update_record(rid, buf, hdr.record_size); }
+
+    // Replace a record with one of the given size. In a slotted file, a record that outgrows the free space of its
+    // page moves to another page, and its new rid is returned. Otherwise the rid stays the same.
+    Rid update_record(const Rid &rid, const uint8_t *buf, int size);
+
+    // Read the records of the first page at or after page_no that has any into the batch, replacing its content.
+    // Return false if no page has records, leaving the batch empty.
+    bool fetch_batch(int64_t page_no, RmBatch &batch) const;
+
+    // Copy the file header into the header page in the buffer pool, where it is logged and written back
+    // together with the records.
+    void write_hdr() const;
 
   private:
-    RmPageHandle fetch_page(int page_no) const;
+    RmPageHandle fetch_page(int64_t page_no) const;
 
     RmPageHandle create_page();
 
+    // Copy the first records of bufs into the free slots of the page. Return the number of records copied.
+    size_t fill_page(RmPageHandle &ph, const uint8_t *bufs, size_t num_records, std::vector<Rid> &rids);
+
     void release_page(RmPageHandle &ph);
+
+    // Whether a page of a slotted file has room for a record of the largest size, which keeps it on the free list
+    bool has_room(const SlottedPage &sp) const {
+        return sp.hdr->free_bytes >= hdr.record_size + (int)sizeof(RmSlot);
+    }
+
+    // Put a page of a slotted file on the free list if it has room again
+    void release_slotted_page(const SlottedPage &sp, int64_t page_no);
+
+    void check_size(int size) const;
 };
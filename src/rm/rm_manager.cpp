@@ -1,6 +1,8 @@
 #include "rm/rm_manager.h"
+#include <cstdio>
+#include <vector>
 
-void RmManager::create_file(const std::string &filename, int record_size) {
+void RmManager::create_file(const std::string &filename, int record_size, RmLayout layout) {
     if (record_size < 1 || record_size > RM_MAX_RECORD_SIZE) {
         throw InvalidRecordSizeError(record_size);
     }
@@ -8,14 +10,26 @@ void RmManager::create_file(const std::string &filename, int record_size) {
     int fd = PfManager::open_file(filename);
 
     RmFileHdr hdr{};
+    hdr.magic = RM_FILE_MAGIC;
+    hdr.version = RM_FILE_VERSION;
     hdr.record_size = record_size;
     hdr.num_pages = 1;
     hdr.first_free = RM_NO_PAGE;
-    // We have: sizeof(RmPageHdr) + (n + 7) / 8 + n * record_size <= PAGE_SIZE
-    hdr.num_records_per_page =
-        (Bitmap::WIDTH * (PAGE_SIZE - 1 - (int)sizeof(RmPageHdr)) + 1) / (1 + record_size * Bitmap::WIDTH);
-    hdr.bitmap_size = (hdr.num_records_per_page + Bitmap::WIDTH - 1) / Bitmap::WIDTH;
-    PfPager::write_page(fd, RM_FILE_HDR_PAGE, (uint8_t *)&hdr, sizeof(hdr));
+    hdr.num_alloc_pages = 1;
+    hdr.layout = layout;
+    if (layout == RM_LAYOUT_SLOTTED) {
+        hdr.num_records_per_page = RM_MAX_SLOTS;
+        hdr.bitmap_size = 0;
+    } else {
+        // We have: sizeof(RmPageHdr) + (n + 7) / 8 + n * record_size <= PAGE_SIZE
+        hdr.num_records_per_page =
+            (Bitmap::WIDTH * (PAGE_SIZE - 1 - (int)sizeof(RmPageHdr)) + 1) / (1 + record_size * Bitmap::WIDTH);
+        hdr.bitmap_size = (hdr.num_records_per_page + Bitmap::WIDTH - 1) / Bitmap::WIDTH;
+    }
+    // Write a full page, since the header page is later cached and updated in the buffer pool
+    uint8_t page_buf[PAGE_SIZE] = {};
+    memcpy(page_buf, &hdr, sizeof(hdr));
+    PfPager::write_page(fd, RM_FILE_HDR_PAGE, page_buf, PAGE_SIZE);
     PfManager::close_file(fd);
 }
 
@@ -23,10 +37,63 @@ void RmManager::destroy_file(const std::string &filename) { PfManager::destroy_f
 
 std::unique_ptr<RmFileHandle> RmManager::open_file(const std::string &filename) {
     int fd = PfManager::open_file(filename);
-    return std::make_unique<RmFileHandle>(fd);
+    auto fh = std::make_unique<RmFileHandle>(fd);
+    if (fh->hdr.magic != RM_FILE_MAGIC || fh->hdr.version != RM_FILE_VERSION) {
+        PfManager::close_file(fd);
+        throw InvalidFileFormatError(filename);
+    }
+    return fh;
 }
 
 void RmManager::close_file(const RmFileHandle *fh) {
-    PfPager::write_page(fh->fd, RM_FILE_HDR_PAGE, (uint8_t *)&fh->hdr, sizeof(fh->hdr));
+    fh->write_hdr();
     PfManager::close_file(fh->fd);
 }
+
+bool RmManager::is_legacy_file(const std::string &filename) {
+    int fd = PfManager::open_file(filename);
+    RmFileHdr hdr{};
+    PfPager::read_page(fd, RM_FILE_HDR_PAGE, (uint8_t *)&hdr, sizeof(hdr));
+    PfManager::close_file(fd);
+    return hdr.magic != RM_FILE_MAGIC;
+}
+
+void RmManager::upgrade_file(const std::string &filename) {
+    int old_fd = PfManager::open_file(filename);
+    RmFileHdrV1 old_hdr{};
+    PfPager::read_page(old_fd, RM_FILE_HDR_PAGE, (uint8_t *)&old_hdr, sizeof(old_hdr));
+    if (old_hdr.record_size < 1 || old_hdr.record_size > RM_MAX_RECORD_SIZE) {
+        PfManager::close_file(old_fd);
+        throw InvalidFileFormatError(filename);
+    }
+
+    // Rewrite all records into a new file, then replace the old one. A crash before that leaves the old file, and
+    // the new one is discarded when the upgrade starts over.
+    std::string new_filename = filename + ".upgrade";
+    if (PfManager::is_file(new_filename)) {
+        destroy_file(new_filename);
+    }
+    create_file(new_filename, old_hdr.record_size);
+    auto fh = open_file(new_filename);
+    std::vector<uint8_t> buf(PAGE_SIZE);
+    const uint8_t *bitmap = buf.data() + sizeof(RmPageHdrV1);
+    const uint8_t *slots = bitmap + old_hdr.bitmap_size;
+    std::vector<uint8_t> records;
+    std::vector<Rid> rids;
+    for (int page_no = RM_FIRST_RECORD_PAGE; page_no < old_hdr.num_pages; page_no++) {
+        PfPager::read_page(old_fd, page_no, buf.data(), PAGE_SIZE);
+        // Pack the records of the page to insert them at once
+        records.clear();
+        int slot_no = Bitmap::first_bit(true, bitmap, old_hdr.num_records_per_page);
+        while (slot_no < old_hdr.num_records_per_page) {
+            const uint8_t *slot = slots + slot_no * old_hdr.record_size;
+            records.insert(records.end(), slot, slot + old_hdr.record_size);
+            slot_no = Bitmap::next_bit(true, bitmap, old_hdr.num_records_per_page, slot_no);
+        }
+        rids.clear();
+        fh->insert_records(records.data(), records.size() / old_hdr.record_size, rids);
+    }
+    close_file(fh.get());
+    PfManager::close_file(old_fd);
+    PfManager::rename_file(new_filename, filename);
+}
@@ -6,11 +6,18 @@
 
 class RmManager {
   public:
-    static void create_file(const std::string &filename, int record_size);
+    // Create a record file. Records of fixed files all have record_size bytes, those of slotted files at most.
+    static void create_file(const std::string &filename, int record_size, RmLayout layout = RM_LAYOUT_FIXED);
 
     static void destroy_file(const std::string &filename);
 
     static std::unique_ptr<RmFileHandle> open_file(const std::string &filename);
 
     static void close_file(const RmFileHandle *fh);
+
+    // Whether the file is a record file of version 1, which has 32-bit page numbers and no magic number
+    static bool is_legacy_file(const std::string &filename);
+
+    // Convert a version 1 record file into the current format. Records are moved, so their rids change.
+    static void upgrade_file(const std::string &filename);
 };
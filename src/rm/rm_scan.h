@@ -1,20 +1,26 @@
 #pragma once
 
-#include "rm/rm_defs.h"
-
-class RmFileHandle;
+#include "rm/rm_file_handle.h"
 
+// Scan of all records of a file, a page at a time. The page of the current record stays pinned until the scan
+// moves past it.
 class RmScan : public RecScan {
   public:
     RmScan(const RmFileHandle *fh);
 
     void next() override;
 
-    bool is_end() const override { return _rid.page_no == RM_NO_PAGE; }
+    bool is_end() const override { return _pos == _batch.size(); }
+
+    Rid rid() const override { return _batch.rids[_pos]; }
 
-    Rid rid() const override { return _rid; }
+    // The current record, in place in its page
+    RmRecordView record() const {
+        return RmRecordView(_batch.slots[_pos], _batch.sizes.empty() ? _fh->hdr.record_size : _batch.sizes[_pos]);
+    }
 
   private:
     const RmFileHandle *_fh;
-    Rid _rid;
+    RmBatch _batch;
+    size_t _pos = 0;
 };
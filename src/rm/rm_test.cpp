@@ -1,5 +1,6 @@
 #include "rm/rm.h"
 #include <gtest/gtest.h>
+#include <set>
 
 void rand_buf(int size, uint8_t *out_buf) {
     for (int i = 0; i < size; i++) {
@@ -21,8 +22,21 @@ void check_equal(const RmFileHandle *fh, const std::unordered_map<Rid, std::stri
         Rid rid = entry.first;
         auto mock_buf = (uint8_t *)entry.second.c_str();
         auto rec = fh->get_record(rid);
-        EXPECT_EQ(memcmp(mock_buf, rec->data, fh->hdr.record_size), 0);
+        ASSERT_EQ(rec->size, (int)entry.second.size());
+        EXPECT_EQ(memcmp(mock_buf, rec->data, rec->size), 0);
     }
+    // Test record views: a guard already holding the page is reused
+    PageGuard page;
+    for (auto &entry : mock) {
+        RmRecordView view = fh->view_record(entry.first, page);
+        EXPECT_EQ(page->id.page_no, entry.first.page_no);
+        Page *prev = page.get();
+        EXPECT_EQ(fh->view_record(entry.first, page).data, view.data);
+        EXPECT_EQ(page.get(), prev);
+        ASSERT_EQ(view.size, (int)entry.second.size());
+        EXPECT_EQ(memcmp(view.data, entry.second.c_str(), view.size), 0);
+    }
+    page.release();
     // Randomly get record
     for (int i = 0; i < 10; i++) {
         Rid rid(1 + rand() % (fh->hdr.num_pages - 1), rand() % fh->hdr.num_records_per_page);
@@ -35,10 +49,37 @@ void check_equal(const RmFileHandle *fh, const std::unordered_map<Rid, std::stri
     for (RmScan scan(fh); !scan.is_end(); scan.next()) {
         EXPECT_GT(mock.count(scan.rid()), 0);
         auto rec = fh->get_record(scan.rid());
-        EXPECT_EQ(memcmp(rec->data, mock.at(scan.rid()).c_str(), fh->hdr.record_size), 0);
+        EXPECT_EQ(memcmp(rec->data, mock.at(scan.rid()).c_str(), rec->size), 0);
+        ASSERT_EQ(scan.record().size, rec->size);
+        EXPECT_EQ(memcmp(scan.record().data, rec->data, rec->size), 0);
         num_records++;
     }
     EXPECT_EQ(num_records, mock.size());
+    // Test batch scan: each batch holds all records of one page, in slot order
+    num_records = 0;
+    RmBatch batch;
+    int64_t page_no = RM_FIRST_RECORD_PAGE;
+    while (fh->fetch_batch(page_no, batch)) {
+        ASSERT_GT(batch.size(), 0u);
+        EXPECT_EQ(batch.page->id.page_no, batch.rids[0].page_no);
+        EXPECT_GE(batch.page->pin_count, 1);
+        for (size_t i = 0; i < batch.size(); i++) {
+            EXPECT_EQ(batch.rids[i].page_no, batch.rids[0].page_no);
+            if (i > 0) {
+                EXPECT_GT(batch.rids[i].slot_no, batch.rids[i - 1].slot_no);
+            }
+            const std::string &mock_rec = mock.at(batch.rids[i]);
+            if (fh->hdr.layout == RM_LAYOUT_SLOTTED) {
+                ASSERT_EQ(batch.sizes[i], (int)mock_rec.size());
+            }
+            EXPECT_EQ(memcmp(batch.slots[i], mock_rec.c_str(), mock_rec.size()), 0);
+        }
+        num_records += batch.size();
+        page_no = batch.rids[0].page_no + 1;
+    }
+    EXPECT_EQ(batch.size(), 0u);
+    EXPECT_FALSE(batch.page);
+    EXPECT_EQ(num_records, mock.size());
 }
 
 std::ostream &operator<<(std::ostream &os, const Rid &rid) {
@@ -127,4 +168,243 @@ TEST(rm, basic) {
     // clean up
     RmManager::close_file(fh.get());
     RmManager::destroy_file(filename);
-}
\ No newline at end of file
+}
+
+TEST(rm, upgrade) {
+    std::string filename = "legacy.txt";
+    if (PfManager::is_file(filename)) {
+        PfManager::destroy_file(filename);
+    }
+    // Write a version 1 file by hand: 32-bit page numbers and no magic number
+    constexpr int record_size = 100;
+    constexpr int num_pages = 4;
+    RmFileHdrV1 old_hdr{};
+    old_hdr.record_size = record_size;
+    old_hdr.num_pages = num_pages;
+    old_hdr.num_records_per_page =
+        (Bitmap::WIDTH * (PAGE_SIZE - 1 - (int)sizeof(RmPageHdrV1)) + 1) / (1 + record_size * Bitmap::WIDTH);
+    old_hdr.first_free = RM_NO_PAGE;
+    old_hdr.bitmap_size = (old_hdr.num_records_per_page + Bitmap::WIDTH - 1) / Bitmap::WIDTH;
+    PfManager::create_file(filename);
+    int fd = PfManager::open_file(filename);
+    PfPager::write_page(fd, RM_FILE_HDR_PAGE, (uint8_t *)&old_hdr, sizeof(old_hdr));
+    std::multiset<std::string> expected;
+    uint8_t page_buf[PAGE_SIZE];
+    for (int page_no = RM_FIRST_RECORD_PAGE; page_no < num_pages; page_no++) {
+        memset(page_buf, 0, PAGE_SIZE);
+        auto page_hdr = (RmPageHdrV1 *)page_buf;
+        page_hdr->next_free = RM_NO_PAGE;
+        uint8_t *bitmap = page_buf + sizeof(RmPageHdrV1);
+        uint8_t *slots = bitmap + old_hdr.bitmap_size;
+        for (int slot_no = 0; slot_no < old_hdr.num_records_per_page; slot_no++) {
+            if (rand() % 3 == 0) {
+                continue;
+            }
+            Bitmap::set(bitmap, slot_no);
+            page_hdr->num_records++;
+            rand_buf(record_size, slots + slot_no * record_size);
+            expected.emplace((char *)slots + slot_no * record_size, record_size);
+        }
+        PfPager::write_page(fd, page_no, page_buf, PAGE_SIZE);
+    }
+    PfManager::close_file(fd);
+
+    EXPECT_TRUE(RmManager::is_legacy_file(filename));
+    EXPECT_THROW(RmManager::open_file(filename), InvalidFileFormatError);
+    // A new file left by an upgrade interrupted by a crash is discarded
+    std::string new_filename = filename + ".upgrade";
+    if (!PfManager::is_file(new_filename)) {
+        PfManager::create_file(new_filename);
+    }
+    RmManager::upgrade_file(filename);
+    EXPECT_FALSE(RmManager::is_legacy_file(filename));
+    EXPECT_FALSE(PfManager::is_file(new_filename));
+
+    auto fh = RmManager::open_file(filename);
+    EXPECT_EQ(fh->hdr.version, RM_FILE_VERSION);
+    EXPECT_EQ(fh->hdr.record_size, record_size);
+    std::multiset<std::string> actual;
+    for (RmScan scan(fh.get()); !scan.is_end(); scan.next()) {
+        auto rec = fh->get_record(scan.rid());
+        actual.emplace((char *)rec->data, record_size);
+    }
+    EXPECT_EQ(actual, expected);
+    RmManager::close_file(fh.get());
+    RmManager::destroy_file(filename);
+}
+
+TEST(rm, extents) {
+    std::string filename = "extents.txt";
+    if (PfManager::is_file(filename)) {
+        PfManager::destroy_file(filename);
+    }
+    constexpr int extent_pages = 16;
+    PfManager::set_extent_pages(extent_pages);
+    RmManager::create_file(filename, 400);
+    auto fh = RmManager::open_file(filename);
+    std::vector<uint8_t> buf(fh->hdr.record_size);
+    size_t num_records = 0;
+    auto grow_to = [&](int64_t num_pages) {
+        while (fh->hdr.num_pages < num_pages) {
+            rand_buf(fh->hdr.record_size, buf.data());
+            fh->insert_record(buf.data());
+            num_records++;
+        }
+    };
+    struct stat st;
+    // The first new page allocates the whole first extent, while the file still ends after its last written page
+    EXPECT_EQ(fh->hdr.num_alloc_pages, 1);
+    grow_to(2);
+    EXPECT_EQ(fh->hdr.num_alloc_pages, extent_pages);
+    ASSERT_EQ(fstat(fh->fd, &st), 0);
+    EXPECT_GE((int64_t)st.st_blocks * 512, extent_pages * PAGE_SIZE);
+    EXPECT_LE(st.st_size, 2 * PAGE_SIZE);
+    grow_to(extent_pages);
+    EXPECT_EQ(fh->hdr.num_alloc_pages, extent_pages);
+    grow_to(extent_pages + 1);
+    EXPECT_EQ(fh->hdr.num_alloc_pages, 2 * extent_pages);
+    ASSERT_EQ(fstat(fh->fd, &st), 0);
+    EXPECT_GE((int64_t)st.st_blocks * 512, 2 * extent_pages * PAGE_SIZE);
+    PfManager::pager.flush_file(fh->fd);
+    ASSERT_EQ(fstat(fh->fd, &st), 0);
+    EXPECT_EQ(st.st_size, (extent_pages + 1) * PAGE_SIZE);
+    // The allocated size survives reopening
+    RmManager::close_file(fh.get());
+    fh = RmManager::open_file(filename);
+    EXPECT_EQ(fh->hdr.num_pages, extent_pages + 1);
+    EXPECT_EQ(fh->hdr.num_alloc_pages, 2 * extent_pages);
+    // A file that does not track its allocated size yet starts from its end
+    fh->hdr.num_alloc_pages = 0;
+    grow_to(extent_pages + 2);
+    EXPECT_EQ(fh->hdr.num_alloc_pages, 2 * extent_pages);
+    // Without extents, files grow a page at a time
+    PfManager::set_extent_pages(0);
+    grow_to(2 * extent_pages + 1);
+    EXPECT_EQ(fh->hdr.num_alloc_pages, 2 * extent_pages + 1);
+    PfManager::set_extent_pages(PF_EXTENT_PAGES);
+
+    size_t num_scanned = 0;
+    for (RmScan scan(fh.get()); !scan.is_end(); scan.next()) {
+        num_scanned++;
+    }
+    EXPECT_EQ(num_scanned, num_records);
+    RmManager::close_file(fh.get());
+    RmManager::destroy_file(filename);
+}
+
+TEST(rm, insert_records) {
+    srand((unsigned)time(nullptr));
+
+    std::unordered_map<Rid, std::string, rid_hash_t, rid_equal_t> mock;
+    std::string filename = "bulk.txt";
+    if (PfManager::is_file(filename)) {
+        PfManager::destroy_file(filename);
+    }
+    RmManager::create_file(filename, 4 + rand() % 256);
+    auto fh = RmManager::open_file(filename);
+    int record_size = fh->hdr.record_size;
+    std::vector<uint8_t> bufs;
+    std::vector<Rid> rids;
+    for (int round = 0; round < 50; round++) {
+        // Free slots scattered over the pages, from deletes, and batches up to a few pages long
+        for (int i = rand() % 200; i > 0 && !mock.empty(); i--) {
+            auto it = mock.begin();
+            std::advance(it, rand() % mock.size());
+            fh->delete_record(it->first);
+            mock.erase(it);
+        }
+        size_t num_records = rand() % (4 * fh->hdr.num_records_per_page);
+        bufs.resize(num_records * record_size);
+        rand_buf((int)bufs.size(), bufs.data());
+        rids.assign(1, Rid(-1, -1));
+        fh->insert_records(bufs.data(), num_records, rids);
+        // Rids are appended
+        ASSERT_EQ(rids.size(), num_records + 1);
+        EXPECT_EQ(rids[0], Rid(-1, -1));
+        for (size_t i = 0; i < num_records; i++) {
+            const Rid &rid = rids[i + 1];
+            EXPECT_EQ(mock.count(rid), 0u);
+            mock[rid] = std::string((char *)bufs.data() + i * record_size, record_size);
+        }
+        // The free list stays usable by single inserts
+        rand_buf(record_size, bufs.data());
+        Rid rid = fh->insert_record(bufs.data());
+        EXPECT_EQ(mock.count(rid), 0u);
+        mock[rid] = std::string((char *)bufs.data(), record_size);
+        if (round % 10 == 0) {
+            RmManager::close_file(fh.get());
+            fh = RmManager::open_file(filename);
+        }
+        check_equal(fh.get(), mock);
+    }
+    RmManager::close_file(fh.get());
+    RmManager::destroy_file(filename);
+}
+
+TEST(rm, slotted) {
+    srand((unsigned)time(nullptr));
+
+    std::unordered_map<Rid, std::string, rid_hash_t, rid_equal_t> mock;
+    std::string filename = "slotted.txt";
+    if (PfManager::is_file(filename)) {
+        PfManager::destroy_file(filename);
+    }
+    int max_size = 1 + rand() % RM_MAX_RECORD_SIZE;
+    RmManager::create_file(filename, max_size, RM_LAYOUT_SLOTTED);
+    auto fh = RmManager::open_file(filename);
+    EXPECT_EQ(fh->hdr.layout, RM_LAYOUT_SLOTTED);
+    EXPECT_EQ(fh->hdr.record_size, max_size);
+    EXPECT_THROW(fh->insert_record(nullptr, max_size + 1), InvalidRecordSizeError);
+    std::vector<Rid> rids;
+    EXPECT_THROW(fh->insert_records(nullptr, 1, rids), InternalError);
+
+    // Short records most of the time, so that records which grow in place often outgrow their page
+    auto rand_size = [&] { return rand() % 4 == 0 ? rand() % (max_size + 1) : rand() % (max_size / 8 + 1); };
+    uint8_t write_buf[PAGE_SIZE];
+    size_t num_moved = 0;
+    for (int round = 0; round < 10000; round++) {
+        double insert_prob = 1. - mock.size() / 2500.;
+        double dice = rand() * 1. / RAND_MAX;
+        int size = rand_size();
+        rand_buf(size, write_buf);
+        if (mock.empty() || dice < insert_prob) {
+            Rid rid = fh->insert_record(write_buf, size);
+            EXPECT_EQ(mock.count(rid), 0u);
+            mock[rid] = std::string((char *)write_buf, size);
+        } else {
+            auto it = mock.begin();
+            std::advance(it, rand() % mock.size());
+            Rid rid = it->first;
+            if (rand() % 2 == 0) {
+                Rid new_rid = fh->update_record(rid, write_buf, size);
+                if (new_rid != rid) {
+                    EXPECT_EQ(mock.count(new_rid), 0u);
+                    EXPECT_FALSE(fh->is_record(rid));
+                    mock.erase(rid);
+                    num_moved++;
+                }
+                mock[new_rid] = std::string((char *)write_buf, size);
+            } else {
+                fh->delete_record(rid);
+                mock.erase(rid);
+            }
+        }
+        if (round % 500 == 0) {
+            RmManager::close_file(fh.get());
+            fh = RmManager::open_file(filename);
+        }
+        if (round % 50 == 0) {
+            check_equal(fh.get(), mock);
+        }
+    }
+    check_equal(fh.get(), mock);
+    // Pages are filled up to the room of a largest record, as in fixed files
+    size_t num_bytes = 0;
+    for (auto &entry : mock) {
+        num_bytes += entry.second.size() + sizeof(RmSlot);
+    }
+    std::cout << "records " << mock.size() << ", moved " << num_moved << ", pages " << fh->hdr.num_pages
+              << ", fill " << (double)num_bytes / (fh->hdr.num_pages - 1) / PAGE_SIZE << '\n';
+    RmManager::close_file(fh.get());
+    RmManager::destroy_file(filename);
+}
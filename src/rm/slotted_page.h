@@ -0,0 +1,139 @@
+#pragma once
+
+#include "rm/rm_defs.h"
+#include <algorithm>
+#include <cassert>
+#include <cstring>
+#include <vector>
+
+// Variable-length records in a page of a slotted file. A record is found by its slot number in the directory, which
+// stays the same while the record lives, even when the page is compacted. Space freed by deleted or shrunk records
+// is reclaimed by moving the records together at the end of the page once a new record no longer fits otherwise.
+class SlottedPage {
+  public:
+    RmSlottedPageHdr *hdr;
+    RmSlot *slots;
+    uint8_t *buf;
+
+    SlottedPage(uint8_t *buf_) : hdr((RmSlottedPageHdr *)buf_), slots((RmSlot *)(buf_ + sizeof(*hdr))), buf(buf_) {}
+
+    void init() {
+        hdr->next_free = RM_NO_PAGE;
+        hdr->num_records = 0;
+        hdr->num_slots = 0;
+        hdr->data_begin = PAGE_SIZE;
+        hdr->free_bytes = PAGE_SIZE - (int)sizeof(RmSlottedPageHdr);
+        hdr->in_free_list = 0;
+    }
+
+    bool is_used(int slot_no) const { return slot_no < hdr->num_slots && slots[slot_no].offset != 0; }
+
+    const uint8_t *get(int slot_no) const { return buf + slots[slot_no].offset; }
+
+    int size(int slot_no) const { return slots[slot_no].size; }
+
+    // First used slot after slot_no, or num_slots if there is none
+    int next_used(int slot_no) const {
+        do {
+            slot_no++;
+        } while (slot_no < hdr->num_slots && slots[slot_no].offset == 0);
+        return slot_no;
+    }
+
+    // Whether a record of the size fits, compacting the page if need be
+    bool can_insert(int size) const { return size + (has_free_slot() ? 0 : (int)sizeof(RmSlot)) <= hdr->free_bytes; }
+
+    // Store a record that fits, in the first free slot or a new one. Return the slot number.
+    int insert(const uint8_t *rec, int size) {
+        assert(can_insert(size));
+        int slot_no = 0;
+        while (slot_no < hdr->num_slots && slots[slot_no].offset != 0) {
+            slot_no++;
+        }
+        if (slot_no == hdr->num_slots) {
+            // The directory grows over the free bytes before the records, which may have to be gathered first
+            if (contiguous_free() < (int)sizeof(RmSlot) + size) {
+                compact();
+            }
+            slots[slot_no] = RmSlot{0, 0};
+            hdr->num_slots++;
+            hdr->free_bytes -= sizeof(RmSlot);
+        }
+        place(slot_no, rec, size);
+        hdr->num_records++;
+        return slot_no;
+    }
+
+    void erase(int slot_no) {
+        assert(is_used(slot_no));
+        hdr->free_bytes += slots[slot_no].size;
+        slots[slot_no] = RmSlot{0, 0};
+        hdr->num_records--;
+        // Free slots at the end of the directory are given back
+        while (hdr->num_slots > 0 && slots[hdr->num_slots - 1].offset == 0) {
+            hdr->num_slots--;
+            hdr->free_bytes += sizeof(RmSlot);
+        }
+    }
+
+    // Replace a record, keeping its slot. Return false, leaving the page as it was, if the new record does not fit.
+    bool update(int slot_no, const uint8_t *rec, int size) {
+        assert(is_used(slot_no));
+        RmSlot &slot = slots[slot_no];
+        if (size <= slot.size) {
+            memcpy(buf + slot.offset, rec, size);
+            hdr->free_bytes += slot.size - size;
+            slot.size = size;
+            return true;
+        }
+        if (size > hdr->free_bytes + slot.size) {
+            return false;
+        }
+        // Move the record, releasing its old bytes first so that compaction can reuse them
+        hdr->free_bytes += slot.size;
+        slot = RmSlot{0, 0};
+        place(slot_no, rec, size);
+        return true;
+    }
+
+    // Bytes between the slot directory and the records
+    int contiguous_free() const {
+        return hdr->data_begin - (int)sizeof(RmSlottedPageHdr) - hdr->num_slots * (int)sizeof(RmSlot);
+    }
+
+    // Move all records to the end of the page, in the order of their offsets, leaving no hole between them
+    void compact() {
+        std::vector<int> order;
+        order.reserve(hdr->num_records);
+        for (int slot_no = 0; slot_no < hdr->num_slots; slot_no++) {
+            if (slots[slot_no].offset != 0) {
+                order.push_back(slot_no);
+            }
+        }
+        std::sort(order.begin(), order.end(), [&](int a, int b) { return slots[a].offset > slots[b].offset; });
+        // Records only move up, and the highest first, so none is overwritten before it moves
+        int end = PAGE_SIZE;
+        for (int slot_no : order) {
+            RmSlot &slot = slots[slot_no];
+            end -= slot.size;
+            memmove(buf + end, buf + slot.offset, slot.size);
+            slot.offset = (uint16_t)end;
+        }
+        hdr->data_begin = end;
+    }
+
+  private:
+    bool has_free_slot() const { return hdr->num_records < hdr->num_slots; }
+
+    // Store a record in a free slot already in the directory
+    void place(int slot_no, const uint8_t *rec, int size) {
+        if (contiguous_free() < size) {
+            compact();
+        }
+        assert(contiguous_free() >= size);
+        hdr->data_begin -= size;
+        memcpy(buf + hdr->data_begin, rec, size);
+        slots[slot_no] = RmSlot{(uint16_t)hdr->data_begin, (uint16_t)size};
+        hdr->free_bytes -= size;
+    }
+};
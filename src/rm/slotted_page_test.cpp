@@ -0,0 +1,98 @@
+#include "rm/slotted_page.h"
+#include <map>
+#include <string>
+#include <gtest/gtest.h>
+
+static std::string rand_rec(int max_size) {
+    std::string rec(rand() % (max_size + 1), '\0');
+    for (auto &c : rec) {
+        c = (char)(rand() & 0xff);
+    }
+    return rec;
+}
+
+static void check_equal(const SlottedPage &sp, const std::map<int, std::string> &mock) {
+    EXPECT_EQ(sp.hdr->num_records, (int)mock.size());
+    // Free bytes are what the header, the directory and the records leave
+    int used = (int)sizeof(RmSlottedPageHdr) + sp.hdr->num_slots * (int)sizeof(RmSlot);
+    for (auto &entry : mock) {
+        ASSERT_TRUE(sp.is_used(entry.first));
+        EXPECT_EQ(sp.size(entry.first), (int)entry.second.size());
+        EXPECT_EQ(memcmp(sp.get(entry.first), entry.second.data(), entry.second.size()), 0);
+        EXPECT_GE(sp.get(entry.first), sp.buf + sp.hdr->data_begin);
+        used += entry.second.size();
+    }
+    EXPECT_EQ(sp.hdr->free_bytes, PAGE_SIZE - used);
+    EXPECT_GE(sp.contiguous_free(), 0);
+    // The directory ends at the last used slot
+    EXPECT_TRUE(sp.hdr->num_slots == 0 || sp.is_used(sp.hdr->num_slots - 1));
+    auto it = mock.begin();
+    for (int slot_no = sp.next_used(-1); slot_no < sp.hdr->num_slots; slot_no = sp.next_used(slot_no)) {
+        ASSERT_NE(it, mock.end());
+        EXPECT_EQ(slot_no, it->first);
+        it++;
+    }
+    EXPECT_EQ(it, mock.end());
+}
+
+TEST(SlottedPage, basic) {
+    srand((unsigned)time(nullptr));
+
+    for (int max_size : {0, 16, 200, 1000}) {
+        uint8_t buf[PAGE_SIZE];
+        SlottedPage sp(buf);
+        sp.init();
+        std::map<int, std::string> mock;
+        for (int round = 0; round < 10000; round++) {
+            int choice = rand() % 3;
+            std::string rec = rand_rec(max_size);
+            if (choice == 0 || mock.empty()) {
+                // Insert, which fails only when the page is short of room
+                if (sp.can_insert(rec.size())) {
+                    int slot_no = sp.insert((const uint8_t *)rec.data(), rec.size());
+                    EXPECT_EQ(mock.count(slot_no), 0u);
+                    mock[slot_no] = rec;
+                } else {
+                    EXPECT_LT(sp.hdr->free_bytes, (int)(rec.size() + sizeof(RmSlot)));
+                }
+            } else {
+                auto it = mock.begin();
+                std::advance(it, rand() % mock.size());
+                if (choice == 1) {
+                    sp.erase(it->first);
+                    mock.erase(it);
+                } else {
+                    int free_bytes = sp.hdr->free_bytes;
+                    bool fits = (int)rec.size() <= free_bytes + (int)it->second.size();
+                    EXPECT_EQ(sp.update(it->first, (const uint8_t *)rec.data(), rec.size()), fits);
+                    if (fits) {
+                        it->second = rec;
+                    } else {
+                        EXPECT_EQ(sp.hdr->free_bytes, free_bytes);
+                    }
+                }
+            }
+            check_equal(sp, mock);
+        }
+    }
+}
+
+TEST(SlottedPage, fill) {
+    // A page of empty records holds the most slots, and a page of one record holds the largest one
+    uint8_t buf[PAGE_SIZE];
+    SlottedPage sp(buf);
+    sp.init();
+    uint8_t empty = 0;
+    while (sp.can_insert(0)) {
+        sp.insert(&empty, 0);
+    }
+    EXPECT_EQ(sp.hdr->num_slots, RM_MAX_SLOTS);
+    sp.init();
+    int max_size = sp.hdr->free_bytes - (int)sizeof(RmSlot);
+    std::string rec(max_size, 'x');
+    ASSERT_TRUE(sp.can_insert(max_size));
+    EXPECT_FALSE(sp.can_insert(max_size + 1));
+    int slot_no = sp.insert((const uint8_t *)rec.data(), max_size);
+    EXPECT_EQ(sp.contiguous_free(), 0);
+    EXPECT_EQ(memcmp(sp.get(slot_no), rec.data(), max_size), 0);
+}
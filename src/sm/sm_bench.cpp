@@ -0,0 +1,94 @@
+#include "ix/ix.h"
+#include "rm/rm.h"
+#include <chrono>
+#include <random>
+
+// Read throughput of the page backends over a table of 1M records of 128 bytes (about 130 MiB) with an index on
+// the key. The pool backend copies every page into a frame, the mmap backend uses pages in place in the kernel page
+// cache. Both are timed warm: the files are in the page cache, and the pool is large enough to hold them.
+// A full scan reads every record through RmScan, and a point lookup probes the index and fetches the record.
+
+static constexpr int NUM_RECORDS = 1000 * 1000;
+static constexpr int RECORD_SIZE = 128;
+static constexpr int NUM_SCANS = 5;
+static constexpr int NUM_LOOKUPS = 2 * 1000 * 1000;
+static constexpr int POOL_PAGES = 128 * 1024; // 512 MiB
+
+template <typename F>
+static double time_ns(F &&f) {
+    auto start = std::chrono::steady_clock::now();
+    f();
+    auto end = std::chrono::steady_clock::now();
+    return std::chrono::duration<double, std::nano>(end - start).count();
+}
+
+static void bench_backend(const std::string &filename, PfBackend backend, const std::vector<int> &keys) {
+    PfManager::set_backend(backend);
+    auto fh = RmManager::open_file(filename);
+    auto ih = IxManager::open_index(filename, 0);
+    // Warm up the pool and the page cache
+    uint64_t sum = 0;
+    for (RmScan scan(fh.get()); !scan.is_end(); scan.next()) {
+        sum += *(int *)fh->get_record(scan.rid())->data;
+    }
+    double scan_ns = time_ns([&] {
+        for (int i = 0; i < NUM_SCANS; i++) {
+            for (RmScan scan(fh.get()); !scan.is_end(); scan.next()) {
+                sum += *(int *)fh->get_record(scan.rid())->data;
+            }
+        }
+    });
+    double lookup_ns = time_ns([&] {
+        for (int key : keys) {
+            Rid rid = ih->get_rid(ih->lower_bound((const uint8_t *)&key));
+            sum += *(int *)fh->get_record(rid)->data;
+        }
+    });
+    printf("backend %-4s  scan %6.2f M records/s  lookup %6.2f M lookups/s  frames %zu  sum %llu\n",
+           backend2str(backend).c_str(), (double)NUM_SCANS * NUM_RECORDS / scan_ns * 1e3,
+           (double)keys.size() / lookup_ns * 1e3, PfManager::pager.num_frames(), (unsigned long long)sum);
+    IxManager::close_index(ih.get());
+    RmManager::close_file(fh.get());
+    // Start the next backend from an empty pool
+    PfManager::pager.resize(PF_MIN_CACHE_PAGES);
+    PfManager::pager.resize(POOL_PAGES);
+}
+
+int main() {
+    PfManager::pager.resize(POOL_PAGES);
+    std::string filename = "sm_bench";
+    if (PfManager::is_file(filename)) {
+        RmManager::destroy_file(filename);
+    }
+    if (IxManager::exists(filename, 0)) {
+        IxManager::destroy_index(filename, 0);
+    }
+    RmManager::create_file(filename, RECORD_SIZE);
+    IxManager::create_index(filename, 0, TYPE_INT, sizeof(int));
+    {
+        auto fh = RmManager::open_file(filename);
+        auto ih = IxManager::open_index(filename, 0);
+        std::vector<uint8_t> buf(RECORD_SIZE);
+        for (int key = 0; key < NUM_RECORDS; key++) {
+            *(int *)buf.data() = key;
+            Rid rid = fh->insert_record(buf.data());
+            ih->insert_entry((const uint8_t *)&key, rid);
+        }
+        IxManager::close_index(ih.get());
+        RmManager::close_file(fh.get());
+    }
+
+    std::mt19937 rng(0);
+    std::vector<int> keys(NUM_LOOKUPS);
+    for (auto &key : keys) {
+        key = rng() % NUM_RECORDS;
+    }
+    for (PfBackend backend : {BACKEND_POOL, BACKEND_MMAP}) {
+        bench_backend(filename, backend, keys);
+    }
+    PfManager::set_backend(BACKEND_POOL);
+
+    RmManager::destroy_file(filename);
+    IxManager::destroy_index(filename, 0);
+    return 0;
+}
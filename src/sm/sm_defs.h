@@ -4,3 +4,5 @@
 #include <string>
 
 static const std::string DB_META_NAME = "db.meta";
+static const std::string DB_WAL_NAME = "db.wal";
+static const std::string DB_POOL_NAME = "db.pool";
@@ -2,6 +2,7 @@
 #include "ix/ix.h"
 #include "record_printer.h"
 #include "rm/rm.h"
+#include <fcntl.h>
 #include <fstream>
 #include <sys/stat.h>
 #include <unistd.h>
@@ -59,25 +60,62 @@ void SmManager::open_db(const std::string &db_name) {
     // Load meta
     std::ifstream ifs(DB_META_NAME);
     ifs >> db;
+    // Redo the statements committed before a crash
+    PfWal::recover(DB_WAL_NAME);
     // Open all record files & index files
+    bool upgraded_any = false;
     for (auto &entry : db.tabs) {
         auto &tab = entry.second;
+        // Files written before page numbers became 64-bit are converted on first open.
+        // Upgrading a table moves its records, so all of its indexes are rebuilt.
+        bool upgraded = RmManager::is_legacy_file(tab.name);
+        if (upgraded) {
+            RmManager::upgrade_file(tab.name);
+            upgraded_any = true;
+        }
         fhs[tab.name] = RmManager::open_file(tab.name);
         for (size_t i = 0; i < tab.cols.size(); i++) {
             auto &col = tab.cols[i];
             if (col.index) {
                 auto index_name = IxManager::get_index_name(tab.name, i);
                 assert(ihs.count(index_name) == 0);
-                ihs[index_name] = IxManager::open_index(tab.name, i);
+                if (upgraded || IxManager::is_legacy_index(tab.name, i)) {
+                    // Build the index aside and move it into place once complete, so that a crash leaves the
+                    // legacy index, which is rebuilt on the next open
+                    std::string tmp_name = tab.name + ".upgrade";
+                    if (IxManager::exists(tmp_name, i)) {
+                        IxManager::destroy_index(tmp_name, i);
+                    }
+                    auto ih = build_index(tab, i, tmp_name);
+                    IxManager::close_index(ih.get());
+                    PfManager::rename_file(IxManager::get_index_name(tmp_name, i), index_name);
+                    ihs[index_name] = IxManager::open_index(tab.name, i);
+                    upgraded_any = true;
+                } else {
+                    ihs[index_name] = IxManager::open_index(tab.name, i);
+                }
             }
         }
     }
+    // Start logging changes
+    if (PfManager::wal.durability() != DURABILITY_OFF) {
+        PfManager::wal.open(DB_WAL_NAME);
+        PfManager::pager.set_wal(&PfManager::wal);
+    }
+    if (upgraded_any) {
+        checkpoint();
+    }
+    // Read back the pages cached when the database was closed, while statements run
+    PfManager::load_pool(DB_POOL_NAME);
 }
 
 void SmManager::close_db() {
-    // Dump meta
-    std::ofstream ofs(DB_META_NAME);
-    ofs << db;
+    // Dump meta and all changes, after which the log is no longer needed
+    checkpoint();
+    PfManager::pager.set_wal(nullptr);
+    PfManager::wal.close();
+    // Remember the cached pages to warm up the pool on the next open
+    PfManager::dump_pool(DB_POOL_NAME);
     db.name.clear();
     db.tabs.clear();
     // Close all record files
@@ -95,6 +133,116 @@ void SmManager::close_db() {
     }
 }
 
+void SmManager::checkpoint() {
+    // Commit the pending changes before writing them back, so that the log covers them until the redo point moves
+    PfManager::pager.commit();
+    if (PfManager::wal.is_open()) {
+        PfManager::wal.flush();
+    }
+    PfManager::pager.write_back();
+    for (auto &entry : fhs) {
+        PfPager::sync_file(entry.second->fd);
+    }
+    for (auto &entry : ihs) {
+        PfPager::sync_file(entry.second->fd);
+    }
+    flush_meta();
+    // Everything is on disk, so recovery can start from the end of the log
+    PfManager::pager.checkpoint();
+}
+
+void SmManager::flush_meta() {
+    // Replace the catalog atomically, so that a crash leaves either the old or the new one
+    std::string tmp_name = DB_META_NAME + ".tmp";
+    {
+        std::ofstream ofs(tmp_name);
+        ofs << db;
+    }
+    int fd = open(tmp_name.c_str(), O_RDONLY);
+    if (fd < 0) {
+        throw UnixError();
+    }
+    if (fsync(fd) != 0 || close(fd) != 0) {
+        throw UnixError();
+    }
+    if (rename(tmp_name.c_str(), DB_META_NAME.c_str()) != 0) {
+        throw UnixError();
+    }
+}
+
+// Share of fetches served from memory
+static std::string hit_ratio(const PfStats &stats) {
+    uint64_t num_fetches = stats.hits + stats.misses;
+    if (num_fetches == 0) {
+        return "-";
+    }
+    char buf[16];
+    snprintf(buf, sizeof(buf), "%.2f%%", 100.0 * stats.hits / num_fetches);
+    return buf;
+}
+
+void SmManager::show_status() {
+    PfPager &pager = PfManager::pager;
+    const PfStats &stats = pager.stats();
+    size_t num_dirty = 0;
+    for (auto &entry : fhs) {
+        num_dirty += pager.num_dirty_pages(entry.second->fd);
+    }
+    for (auto &entry : ihs) {
+        num_dirty += pager.num_dirty_pages(entry.second->fd);
+    }
+    std::vector<std::vector<std::string>> rows = {
+        {"Pool pages", std::to_string(pager.capacity())},
+        {"Frames", std::to_string(pager.num_frames())},
+        {"Cached pages", std::to_string(pager.page_table().size())},
+        {"Dirty pages", std::to_string(num_dirty)},
+        {"Reserved pages", std::to_string(pager.num_reserved())},
+        {"Reserved budget", std::to_string(pager.reserved_capacity())},
+        {"Hits", std::to_string(stats.hits)},
+        {"Misses", std::to_string(stats.misses)},
+        {"Hit ratio", hit_ratio(stats)},
+        {"Prefetches", std::to_string(stats.prefetches)},
+        {"Evictions", std::to_string(stats.evictions)},
+        {"Write-backs", std::to_string(stats.write_backs)},
+        {"Flush waits", std::to_string(stats.flush_waits)},
+        {"Checkpoints", std::to_string(pager.num_checkpoints())},
+    };
+    RecordPrinter printer(2);
+    printer.print_separator();
+    printer.print_record({"Variable", "Value"});
+    printer.print_separator();
+    for (auto &row : rows) {
+        printer.print_record(row);
+    }
+    printer.print_separator();
+}
+
+void SmManager::show_bufferpool() {
+    PfPager &pager = PfManager::pager;
+    std::vector<std::string> captions = {"File",   "Reserved",  "Cached",    "Dirty",        "Hits",
+                                         "Misses", "Hit ratio", "Evictions", "Write-backs"};
+    RecordPrinter printer(captions.size());
+    printer.print_separator();
+    printer.print_record(captions);
+    printer.print_separator();
+    auto print_file = [&](const std::string &name, int fd) {
+        PfStats stats = pager.file_stats(fd);
+        printer.print_record({name, pager.is_reserved(fd) ? "YES" : "NO", std::to_string(pager.num_file_pages(fd)),
+                              std::to_string(pager.num_dirty_pages(fd)), std::to_string(stats.hits),
+                              std::to_string(stats.misses), hit_ratio(stats), std::to_string(stats.evictions),
+                              std::to_string(stats.write_backs)});
+    };
+    for (auto &entry : fhs) {
+        print_file(entry.first, entry.second->fd);
+    }
+    for (auto &entry : ihs) {
+        print_file(entry.first, entry.second->fd);
+    }
+    printer.print_separator();
+}
+
+void SmManager::reset_status() { PfManager::pager.reset_stats(); }
+
 void SmManager::show_tables() {
     RecordPrinter printer(1);
     printer.print_separator();
@@ -118,7 +266,8 @@ void SmManager::desc_table(const std::string &tab_name) {
     printer.print_separator();
     // Print fields
     for (auto &col : tab.cols) {
-        std::vector<std::string> field_info = {col.name, coltype2str(col.type), col.index ? "YES" : "NO"};
+        std::string type = col.varchar ? "VARCHAR" : coltype2str(col.type);
+        std::vector<std::string> field_info = {col.name, type, col.index ? "YES" : "NO"};
         printer.print_record(field_info);
     }
     // Print footer
@@ -134,31 +283,36 @@ void SmManager::create_table(const std::string &tab_name, const std::vector<ColD
     TabMeta tab;
     tab.name = tab_name;
     for (auto &col_def : col_defs) {
-        ColMeta col(tab_name, col_def.name, col_def.type, col_def.len, curr_offset, false);
+        ColMeta col(tab_name, col_def.name, col_def.type, col_def.len, curr_offset, false, col_def.varchar);
         curr_offset += col_def.len;
         tab.cols.push_back(col);
     }
-    // Create & open record file
-    int record_size = curr_offset;
-    RmManager::create_file(tab_name, record_size);
+    // Create & open record file. Tables with VARCHAR columns store packed records of variable size.
+    if (tab.is_packed()) {
+        RmManager::create_file(tab_name, tab.max_packed_size(), RM_LAYOUT_SLOTTED);
+    } else {
+        RmManager::create_file(tab_name, tab.row_size());
+    }
     db.tabs[tab_name] = tab;
     fhs[tab_name] = RmManager::open_file(tab_name);
+    checkpoint();
 }
 
 void SmManager::drop_table(const std::string &tab_name) {
     // Find table index in db meta
     TabMeta &tab = db.get_table(tab_name);
-    // Close & destroy record file
-    RmManager::close_file(fhs.at(tab_name).get());
-    RmManager::destroy_file(tab_name);
     // Close & destroy index file
     for (auto &col : tab.cols) {
         if (col.index) {
             SmManager::drop_index(tab_name, col.name);
         }
     }
+    // Close & destroy record file
+    RmManager::close_file(fhs.at(tab_name).get());
+    RmManager::destroy_file(tab_name);
     db.tabs.erase(tab_name);
     fhs.erase(tab_name);
+    checkpoint();
 }
 
 void SmManager::create_index(const std::string &tab_name, const std::string &col_name) {
@@ -167,25 +321,16 @@ void SmManager::create_index(const std::string &tab_name, const std::string &col
     if (col->index) {
         throw IndexExistsError(tab_name, col_name);
     }
-    // Create index file
+    // Create index file and index all records
     int col_idx = col - tab.cols.begin();
-    IxManager::create_index(tab_name, col_idx, col->type, col->len);
-    // Open index file
-    auto ih = IxManager::open_index(tab_name, col_idx);
-    // Get record file handle
-    auto fh = fhs.at(tab_name).get();
-    // Index all records into index
-    for (RmScan rm_scan(fh); !rm_scan.is_end(); rm_scan.next()) {
-        auto rec = fh->get_record(rm_scan.rid());
-        const uint8_t *key = rec->data + col->offset;
-        ih->insert_entry(key, rm_scan.rid());
-    }
+    auto ih = build_index(tab, col_idx);
     // Store index handle
     auto index_name = IxManager::get_index_name(tab_name, col_idx);
     assert(ihs.count(index_name) == 0);
     ihs[index_name] = std::move(ih);
     // Mark column index as created
     col->index = true;
+    checkpoint();
 }
 
 void SmManager::drop_index(const std::string &tab_name, const std::string &col_name) {
@@ -200,4 +345,55 @@ void SmManager::drop_index(const std::string &tab_name, const std::string &col_n
     IxManager::destroy_index(tab_name, col_idx);
     ihs.erase(index_name);
     col->index = false;
+    checkpoint();
+}
+
+void SmManager::cache_table(const std::string &tab_name, bool enable) {
+    db.get_table(tab_name);
+    auto fh = fhs.at(tab_name).get();
+    if (enable) {
+        PfManager::pager.reserve_file(fh->fd, fh->hdr.num_pages);
+    } else {
+        PfManager::pager.release_file(fh->fd);
+    }
+}
+
+void SmManager::pin_index(const std::string &tab_name, const std::string &col_name, bool enable) {
+    TabMeta &tab = db.get_table(tab_name);
+    auto col = tab.get_col(col_name);
+    if (!col->index) {
+        throw IndexNotFoundError(tab_name, col_name);
+    }
+    auto ih = ihs.at(IxManager::get_index_name(tab_name, col - tab.cols.begin())).get();
+    if (enable) {
+        PfManager::pager.reserve_file(ih->fd, ih->hdr.num_pages);
+    } else {
+        PfManager::pager.release_file(ih->fd);
+    }
+}
+
+std::unique_ptr<IxIndexHandle> SmManager::build_index(const TabMeta &tab, int col_idx, const std::string &filename) {
+    auto &col = tab.cols[col_idx];
+    // Create & open index file
+    IxManager::create_index(filename, col_idx, col.type, col.len);
+    auto ih = IxManager::open_index(filename, col_idx);
+    // Get record file handle
+    auto fh = fhs.at(tab.name).get();
+    // Index all records into index, gathering their keys to insert them in key order
+    std::vector<uint8_t> keys;
+    std::vector<Rid> rids;
+    bool packed = tab.is_packed();
+    std::vector<uint8_t> row(tab.row_size());
+    for (RmScan rm_scan(fh); !rm_scan.is_end(); rm_scan.next()) {
+        const uint8_t *rec = rm_scan.record().data;
+        if (packed) {
+            tab.unpack(rec, row.data());
+            rec = row.data();
+        }
+        const uint8_t *key = rec + col.offset;
+        keys.insert(keys.end(), key, key + col.len);
+        rids.push_back(rm_scan.rid());
+    }
+    ih->insert_entries(keys.data(), col.len, rids.data(), rids.size());
+    return ih;
 }
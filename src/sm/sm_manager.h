@@ -6,12 +6,14 @@
 #include "sm/sm_meta.h"
 
 struct ColDef {
-    std::string name; // Column name
-    ColType type;     // Type of column
-    int len;          // Length of column
+    std::string name;     // Column name
+    ColType type;         // Type of column
+    int len;              // Length of column
+    bool varchar = false; // VARCHAR rather than CHAR column
 
     ColDef() = default;
-    ColDef(std::string name_, ColType type_, int len_) : name(std::move(name_)), type(type_), len(len_) {}
+    ColDef(std::string name_, ColType type_, int len_, bool varchar_ = false)
+        : name(std::move(name_)), type(type_), len(len_), varchar(varchar_) {}
 };
 
 class SmManager {
@@ -31,6 +33,16 @@ class SmManager {
 
     static void close_db();
 
+    // Write back all changes and the catalog, sync them to disk, and empty the write-ahead log
+    static void checkpoint();
+
+    // Buffer pool activity, as a whole and per table and index file
+    static void show_status();
+
+    static void show_bufferpool();
+
+    static void reset_status();
+
     // Table management
     static void show_tables();
 
@@ -44,4 +56,20 @@ class SmManager {
     static void create_index(const std::string &tab_name, const std::string &col_name);
 
     static void drop_index(const std::string &tab_name, const std::string &col_name);
+
+    // Keep a table or an index in the reserved region of the buffer pool, or return it to the ordinary replacement.
+    // Takes effect until the database is closed.
+    static void cache_table(const std::string &tab_name, bool enable);
+
+    static void pin_index(const std::string &tab_name, const std::string &col_name, bool enable);
+
+  private:
+    static void flush_meta();
+
+    // Create the index of a column and insert all records of the opened table into it. The index is named after
+    // filename, which defaults to the table.
+    static std::unique_ptr<IxIndexHandle> build_index(const TabMeta &tab, int col_idx, const std::string &filename);
+    static std::unique_ptr<IxIndexHandle> build_index(const TabMeta &tab, int col_idx) {
+        return build_index(tab, col_idx, tab.name);
+    }
 };
@@ -3,8 +3,10 @@
 #include "error.h"
 #include "sm/sm_defs.h"
 #include <algorithm>
+#include <cstring>
 #include <iostream>
 #include <map>
+#include <sstream>
 #include <string>
 #include <vector>
 
@@ -15,19 +17,28 @@ struct ColMeta {
     int len;
     int offset;
     bool index;
+    // A VARCHAR column is a string column whose trailing padding is not stored. In rows it takes len bytes at
+    // offset like CHAR, and records of its table are packed, see TabMeta::pack.
+    bool varchar = false;
 
     ColMeta() = default;
-    ColMeta(std::string tab_name_, std::string name_, ColType type_, int len_, int offset_, bool index_)
+    ColMeta(std::string tab_name_, std::string name_, ColType type_, int len_, int offset_, bool index_,
+            bool varchar_ = false)
         : tab_name(std::move(tab_name_)), name(std::move(name_)), type(type_), len(len_), offset(offset_),
-          index(index_) {}
+          index(index_), varchar(varchar_) {}
 
     friend std::ostream &operator<<(std::ostream &os, const ColMeta &col) {
         return os << col.tab_name << ' ' << col.name << ' ' << col.type << ' ' << col.len << ' ' << col.offset << ' '
-                  << col.index;
+                  << col.index << ' ' << col.varchar;
     }
 
     friend std::istream &operator>>(std::istream &is, ColMeta &col) {
-        return is >> col.tab_name >> col.name >> col.type >> col.len >> col.offset >> col.index;
+        is >> col.tab_name >> col.name >> col.type >> col.len >> col.offset >> col.index;
+        // Catalogs written before VARCHAR end the line here
+        std::string rest;
+        std::getline(is, rest);
+        std::istringstream(rest) >> col.varchar;
+        return is;
     }
 };
 
@@ -40,6 +51,63 @@ struct TabMeta {
         return pos != cols.end();
     }
 
+    // Whether records are stored packed, in a slotted file
+    bool is_packed() const {
+        return std::any_of(cols.begin(), cols.end(), [](const ColMeta &col) { return col.varchar; });
+    }
+
+    // Size of a row, with every column at its full length
+    int row_size() const { return cols.back().offset + cols.back().len; }
+
+    // Largest size of a packed record
+    int max_packed_size() const {
+        int size = row_size();
+        for (auto &col : cols) {
+            size += col.varchar ? (int)sizeof(uint16_t) : 0;
+        }
+        return size;
+    }
+
+    // Pack a row into a record and return its size. Columns are stored in order, and a VARCHAR column as its length
+    // in 2 bytes followed by the string without its trailing zeros.
+    int pack(const uint8_t *row, uint8_t *rec) const {
+        uint8_t *dst = rec;
+        for (auto &col : cols) {
+            const uint8_t *src = row + col.offset;
+            if (!col.varchar) {
+                memcpy(dst, src, col.len);
+                dst += col.len;
+                continue;
+            }
+            uint16_t len = col.len;
+            while (len > 0 && src[len - 1] == 0) {
+                len--;
+            }
+            memcpy(dst, &len, sizeof(len));
+            memcpy(dst + sizeof(len), src, len);
+            dst += sizeof(len) + len;
+        }
+        return dst - rec;
+    }
+
+    // Unpack a record made by pack into a row
+    void unpack(const uint8_t *rec, uint8_t *row) const {
+        const uint8_t *src = rec;
+        for (auto &col : cols) {
+            uint8_t *dst = row + col.offset;
+            if (!col.varchar) {
+                memcpy(dst, src, col.len);
+                src += col.len;
+                continue;
+            }
+            uint16_t len;
+            memcpy(&len, src, sizeof(len));
+            memcpy(dst, src + sizeof(len), len);
+            memset(dst + len, 0, col.len - len);
+            src += sizeof(len) + len;
+        }
+    }
+
     std::vector<ColMeta>::iterator get_col(const std::string &col_name) {
         auto pos = std::find_if(cols.begin(), cols.end(), [&](const ColMeta &col) { return col.name == col_name; });
         if (pos == cols.end()) {
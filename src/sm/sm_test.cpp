@@ -48,4 +48,47 @@ TEST(sm, basic) {
     // Clean up
     SmManager::close_db();
     SmManager::drop_db(db);
-}
\ No newline at end of file
+}
+
+TEST(sm, varchar) {
+    std::string db = "db";
+    if (SmManager::is_dir(db)) {
+        SmManager::drop_db(db);
+    }
+    SmManager::create_db(db);
+    SmManager::open_db(db);
+    SmManager::create_table("fixed", {ColDef("a", TYPE_INT, 4), ColDef("b", TYPE_STRING, 16)});
+    SmManager::create_table("packed", {ColDef("a", TYPE_INT, 4), ColDef("b", TYPE_STRING, 16, true)});
+    EXPECT_EQ(SmManager::fhs.at("fixed")->hdr.layout, RM_LAYOUT_FIXED);
+    EXPECT_EQ(SmManager::fhs.at("packed")->hdr.layout, RM_LAYOUT_SLOTTED);
+    EXPECT_EQ(SmManager::fhs.at("packed")->hdr.record_size, 4 + 2 + 16);
+    // The VARCHAR flag survives reopening the database
+    SmManager::close_db();
+    SmManager::open_db(db);
+    TabMeta &tab = SmManager::db.get_table("packed");
+    EXPECT_FALSE(tab.cols[0].varchar);
+    EXPECT_TRUE(tab.cols[1].varchar);
+    EXPECT_FALSE(SmManager::db.get_table("fixed").is_packed());
+    // A packed record keeps the string without its padding
+    uint8_t row[20] = {1, 2, 3, 4, 'a', 'b', 'c'};
+    uint8_t rec[22];
+    EXPECT_EQ(tab.pack(row, rec), 4 + 2 + 3);
+    uint8_t unpacked[20];
+    memset(unpacked, 0xff, sizeof(unpacked));
+    tab.unpack(rec, unpacked);
+    EXPECT_EQ(memcmp(row, unpacked, sizeof(row)), 0);
+    SmManager::close_db();
+    SmManager::drop_db(db);
+
+    // Catalogs written before VARCHAR have no flag
+    std::istringstream legacy("tab a 0 4 0 1\ntab b 2 16 4 0\n");
+    ColMeta col;
+    legacy >> col;
+    EXPECT_EQ(col.name, "a");
+    EXPECT_TRUE(col.index);
+    EXPECT_FALSE(col.varchar);
+    legacy >> col;
+    EXPECT_EQ(col.name, "b");
+    EXPECT_EQ(col.offset, 4);
+    EXPECT_FALSE(col.varchar);
+}